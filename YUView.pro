@@ -31,7 +31,14 @@ SOURCES += main.cpp\
     plistparser.cpp \
     plistserializer.cpp \
     playlistitemdifference.cpp \
-    differenceobject.cpp
+    differenceobject.cpp \
+    chromaupsampling.cpp \
+    rgbconversion.cpp \
+    yuvdifference.cpp \
+    qualitymetrics.cpp \
+    qualitymapobject.cpp \
+    sequencemetrics.cpp \
+    sequencemetricsdialog.cpp
 
 HEADERS  += mainwindow.h \
     yuvfile.h \
@@ -56,10 +63,20 @@ HEADERS  += mainwindow.h \
     plistserializer.h \
     playlistitemdifference.h \
     differenceobject.h \
-    statisticsextensions.h
+    statisticsextensions.h \
+    statslinetokenizer.h \
+    chromaupsampling.h \
+    rgbconversion.h \
+    yuvdifference.h \
+    cpufeatures.h \
+    qualitymetrics.h \
+    qualitymapobject.h \
+    sequencemetrics.h \
+    sequencemetricsdialog.h
 FORMS    += mainwindow.ui \
     settingswindow.ui \
-    edittextdialog.ui
+    edittextdialog.ui \
+    sequencemetricsdialog.ui
 
 RESOURCES += \
     images.qrc \
@@ -0,0 +1,140 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Compares the chroma upsampling kernels of every instruction set supported by this CPU against the scalar
+// reference: sample and hold (8 and 16 bit), bilinear and interstitial rows. The inputs are random, the row
+// lengths cover all lengths up to a few vectors (so every remainder of the vector loops) and some long rows.
+// The sources and destinations are misaligned and the bytes after the destination rows have to stay untouched.
+//
+// usage: chromaupsamplingtest
+// Returns 1 if a kernel differs from the scalar reference.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "chromaupsampling.h"
+
+// the destination rows are followed by GUARD_SIZE guard samples
+#define GUARD_SIZE 64
+#define GUARD_VALUE 0xA5
+
+static unsigned int g_random = 12345;
+static unsigned int nextRandom()
+{
+    g_random = g_random * 1103515245 + 12345;
+    return g_random >> 8;
+}
+
+template<typename T> static void fillRandom(std::vector<T> &samples, unsigned int mask)
+{
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = (T)(nextRandom() & mask);
+}
+
+static bool report(const ChromaUpsamplingKernels *kernels, const char *kernel, int n, int offset)
+{
+    printf("%s %s: differs from the scalar kernel for n=%d (offset %d)\n", kernels->name, kernel, n, offset);
+    return false;
+}
+
+static bool testHoldRow8(const ChromaUpsamplingKernels *kernels, int n, int offset)
+{
+    std::vector<unsigned char> src(n + offset + 1), dstRef(2*n + offset + GUARD_SIZE, GUARD_VALUE), dst(dstRef);
+    fillRandom(src, 0xFF);
+
+    chromaUpsamplingKernelsScalar().holdRow8(&src[offset], &dstRef[offset], n);
+    kernels->holdRow8(&src[offset], &dst[offset], n);
+    return dst == dstRef || report(kernels, "holdRow8", n, offset);
+}
+
+static bool testHoldRow16(const ChromaUpsamplingKernels *kernels, int n, int offset, unsigned int mask)
+{
+    std::vector<unsigned short> src(n + offset + 1), dstRef(2*n + offset + GUARD_SIZE, GUARD_VALUE), dst(dstRef);
+    fillRandom(src, mask);
+
+    chromaUpsamplingKernelsScalar().holdRow16(&src[offset], &dstRef[offset], n);
+    kernels->holdRow16(&src[offset], &dst[offset], n);
+    return dst == dstRef || report(kernels, mask == 0x3FF ? "holdRow16 (10 bit)" : "holdRow16", n, offset);
+}
+
+typedef void (*RowsKernel)(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n);
+
+// the rows kernels read top[n] and bot[n]
+static bool testRows8(const ChromaUpsamplingKernels *kernels, RowsKernel kernel, RowsKernel reference, const char *name, int n, int offset)
+{
+    std::vector<unsigned char> top(n + offset + 1), bot(n + offset + 1);
+    std::vector<unsigned char> dstTopRef(2*n + offset + GUARD_SIZE, GUARD_VALUE), dstBotRef(dstTopRef), dstTop(dstTopRef), dstBot(dstTopRef);
+    fillRandom(top, 0xFF);
+    fillRandom(bot, 0xFF);
+
+    // the extremes are where rounding and saturation errors show up
+    if (n % 3 == 0)
+    {
+        memset(&top[0], 0xFF, top.size());
+        memset(&bot[0], (n % 2) ? 0xFF : 0x00, bot.size());
+    }
+
+    reference(&top[offset], &bot[offset], &dstTopRef[offset], &dstBotRef[offset], n);
+    kernel(&top[offset], &bot[offset], &dstTop[offset], &dstBot[offset], n);
+    return (dstTop == dstTopRef && dstBot == dstBotRef) || report(kernels, name, n, offset);
+}
+
+static bool testKernels(const ChromaUpsamplingKernels *kernels)
+{
+    const ChromaUpsamplingKernels &scalar = chromaUpsamplingKernelsScalar();
+
+    // all lengths up to several AVX2 vectors and some long (odd) rows like the chroma rows of real frames
+    std::vector<int> lengths;
+    for (int n = 0; n <= 160; n++)
+        lengths.push_back(n);
+    lengths.push_back(959);
+    lengths.push_back(960);
+    lengths.push_back(1023);
+    lengths.push_back(1920);
+    lengths.push_back(2047);
+
+    bool ok = true;
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+        const int n = lengths[i];
+        for (int offset = 0; offset < 4; offset++)
+        {
+            ok = testHoldRow8(kernels, n, offset) && ok;
+            ok = testHoldRow16(kernels, n, offset, 0x3FF) && ok;
+            ok = testHoldRow16(kernels, n, offset, 0xFFFF) && ok;
+            ok = testRows8(kernels, kernels->bilinearRows8, scalar.bilinearRows8, "bilinearRows8", n, offset) && ok;
+            ok = testRows8(kernels, kernels->interstitialRows8, scalar.interstitialRows8, "interstitialRows8", n, offset) && ok;
+        }
+    }
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    for (int i = 0; chromaUpsamplingKernelsSupported(i) != NULL; i++)
+    {
+        const ChromaUpsamplingKernels *kernels = chromaUpsamplingKernelsSupported(i);
+        const bool kernelsOk = testKernels(kernels);
+        printf("%-8s %s\n", kernels->name, kernelsOk ? "passed" : "FAILED");
+        ok = kernelsOk && ok;
+    }
+    return ok ? 0 : 1;
+}
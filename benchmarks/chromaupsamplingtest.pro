@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# SIMD chroma upsampling kernels against the scalar reference (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = chromaupsamplingtest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += chromaupsamplingtest.cpp \
+    ../chromaupsampling.cpp
+
+HEADERS += ../chromaupsampling.h \
+    ../cpufeatures.h
@@ -0,0 +1,215 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Compares the sum of squared differences kernels of every instruction set supported by this CPU against the
+// scalar reference: sse8 with 8 bit samples, sse16 with 10 bit and 16 bit samples. The inputs are random, the
+// lengths cover every remainder of the vector loops and some long rows. Long runs of the largest differences
+// check that the 32 bit lanes of sse8 are flushed before they overflow. The sources are misaligned.
+// The float kernels of MS-SSIM (gaussianRow, gaussianColumn and ssimRow) have to give bit identical results.
+//
+// usage: qualitymetricstest
+// Returns 1 if a kernel differs from the scalar reference.
+
+#include <cstdio>
+#include <cstring>
+#include <math.h>
+#include <vector>
+
+#include "qualitymetrics.h"
+
+static unsigned int g_random = 12345;
+static unsigned int nextRandom()
+{
+    g_random = g_random * 1103515245 + 12345;
+    return g_random >> 8;
+}
+
+template<typename T> static void fillRandom(std::vector<T> &samples, unsigned int mask)
+{
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = (T)(nextRandom() & mask);
+}
+
+// maxDiff: srcA is all mask and srcB all 0
+static bool testSSE8(const QualityMetricKernels *kernels, int n, int offset, bool maxDiff)
+{
+    std::vector<unsigned char> srcA(n + offset, 0xFF), srcB(n + offset, 0);
+    if (!maxDiff)
+    {
+        fillRandom(srcA, 0xFF);
+        fillRandom(srcB, 0xFF);
+    }
+
+    const quint64 reference = qualityMetricKernelsScalar().sse8(&srcA[offset], &srcB[offset], n);
+    const quint64 result = kernels->sse8(&srcA[offset], &srcB[offset], n);
+    if (result == reference)
+        return true;
+
+    printf("%s sse8: %llu instead of %llu for n=%d (offset %d)\n", kernels->name, (unsigned long long)result, (unsigned long long)reference, n, offset);
+    return false;
+}
+
+static bool testSSE16(const QualityMetricKernels *kernels, int n, int offset, unsigned int mask, bool maxDiff)
+{
+    std::vector<unsigned short> srcA(n + offset, (unsigned short)mask), srcB(n + offset, 0);
+    if (!maxDiff)
+    {
+        fillRandom(srcA, mask);
+        fillRandom(srcB, mask);
+    }
+
+    const quint64 reference = qualityMetricKernelsScalar().sse16(&srcA[offset], &srcB[offset], n);
+    const quint64 result = kernels->sse16(&srcA[offset], &srcB[offset], n);
+    if (result == reference)
+        return true;
+
+    printf("%s sse16 (mask 0x%x): %llu instead of %llu for n=%d (offset %d)\n", kernels->name, mask, (unsigned long long)result, (unsigned long long)reference, n, offset);
+    return false;
+}
+
+// random floats of 16 bit samples (mask 0xFFFF) or their products (mask 0xFFFFFFFF)
+static void fillRandomFloats(std::vector<float> &values, bool products)
+{
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        const float a = (float)(nextRandom() & 0xFFFF);
+        values[i] = products ? a * (float)(nextRandom() & 0xFFFF) : a;
+    }
+}
+
+static bool sameFloats(const std::vector<float> &a, const std::vector<float> &b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0);
+}
+
+static void gaussianWeights(float *weights)
+{
+    double sum = 0.0;
+    double window[11];
+    for (int i = 0; i < 11; i++)
+    {
+        window[i] = exp(-(i - 5) * (i - 5) / (2.0 * 1.5 * 1.5));
+        sum += window[i];
+    }
+    for (int i = 0; i < 11; i++)
+        weights[i] = (float)(window[i] / sum);
+}
+
+static bool testGaussian(const QualityMetricKernels *kernels, int n, int offset)
+{
+    float weights[11];
+    gaussianWeights(weights);
+
+    std::vector<float> src(n + 10 + offset);
+    fillRandomFloats(src, false);
+    std::vector<float> reference(n), result(n);
+    qualityMetricKernelsScalar().gaussianRow(&src[offset], n ? &reference[0] : NULL, n, weights);
+    kernels->gaussianRow(&src[offset], n ? &result[0] : NULL, n, weights);
+    bool ok = sameFloats(result, reference);
+
+    std::vector< std::vector<float> > rowBuffers(11, std::vector<float>(n + offset));
+    const float *rows[11];
+    for (int k = 0; k < 11; k++)
+    {
+        fillRandomFloats(rowBuffers[k], true);
+        rows[k] = &rowBuffers[k][offset];
+    }
+    std::vector<float> columnReference(n), columnResult(n);
+    qualityMetricKernelsScalar().gaussianColumn(rows, n ? &columnReference[0] : NULL, n, weights);
+    kernels->gaussianColumn(rows, n ? &columnResult[0] : NULL, n, weights);
+    ok = sameFloats(columnResult, columnReference) && ok;
+
+    if (!ok)
+        printf("%s gaussianRow/gaussianColumn: results differ for n=%d (offset %d)\n", kernels->name, n, offset);
+    return ok;
+}
+
+// means of a and b with a*a + b*b and a*b of the same values, so the variances are small against the means
+static bool testSSIMRow(const QualityMetricKernels *kernels, int n, int offset, float maxValue)
+{
+    std::vector<float> meanBuffers[4];
+    for (int m = 0; m < 4; m++)
+        meanBuffers[m].resize(n + offset);
+    for (int x = 0; x < n + offset; x++)
+    {
+        const float a = (float)(nextRandom() % ((unsigned int)maxValue + 1));
+        const float b = (float)(nextRandom() % ((unsigned int)maxValue + 1));
+        meanBuffers[0][x] = a;
+        meanBuffers[1][x] = b;
+        meanBuffers[2][x] = a*a + b*b + (float)(nextRandom() & 0xFFF);
+        meanBuffers[3][x] = a*b + (float)(nextRandom() & 0x7FF) - 1024.0f;
+    }
+    const float *means[4] = { &meanBuffers[0][offset], &meanBuffers[1][offset], &meanBuffers[2][offset], &meanBuffers[3][offset] };
+    const float c1 = (0.01f * maxValue) * (0.01f * maxValue);
+    const float c2 = (0.03f * maxValue) * (0.03f * maxValue);
+
+    std::vector<float> ssimReference(n), csReference(n), ssimResult(n), csResult(n);
+    qualityMetricKernelsScalar().ssimRow(means, n ? &ssimReference[0] : NULL, n ? &csReference[0] : NULL, n, c1, c2);
+    kernels->ssimRow(means, n ? &ssimResult[0] : NULL, n ? &csResult[0] : NULL, n, c1, c2);
+    if (sameFloats(ssimResult, ssimReference) && sameFloats(csResult, csReference))
+        return true;
+
+    printf("%s ssimRow (max %g): results differ for n=%d (offset %d)\n", kernels->name, maxValue, n, offset);
+    return false;
+}
+
+static bool testKernels(const QualityMetricKernels *kernels)
+{
+    // all lengths up to several AVX2 vectors and some long rows which are not a multiple of the vector width
+    std::vector<int> lengths;
+    for (int n = 0; n <= 100; n++)
+        lengths.push_back(n);
+    lengths.push_back(1917);
+    lengths.push_back(3840);
+
+    bool ok = true;
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+        const int n = lengths[i];
+        for (int offset = 0; offset < 4; offset++)
+        {
+            ok = testSSE8(kernels, n, offset, false) && ok;
+            ok = testSSE16(kernels, n, offset, 0x3FF, false) && ok;
+            ok = testSSE16(kernels, n, offset, 0xFFFF, false) && ok;
+            ok = testGaussian(kernels, n, offset) && ok;
+            ok = testSSIMRow(kernels, n, offset, 255.0f) && ok;
+            ok = testSSIMRow(kernels, n, offset, 1023.0f) && ok;
+        }
+    }
+
+    // more than 4096 iterations of the widest sse8 loop with the largest squares, like a whole 8 bit UHD plane
+    const int planeSize = 3840*2160 + 7;
+    ok = testSSE8(kernels, planeSize, 1, true) && ok;
+    ok = testSSE8(kernels, planeSize, 0, false) && ok;
+    ok = testSSE16(kernels, planeSize, 1, 0xFFFF, true) && ok;
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    for (int i = 0; qualityMetricKernelsSupported(i) != NULL; i++)
+    {
+        const QualityMetricKernels *kernels = qualityMetricKernelsSupported(i);
+        const bool kernelsOk = testKernels(kernels);
+        printf("%-8s %s\n", kernels->name, kernelsOk ? "passed" : "FAILED");
+        ok = kernelsOk && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# SIMD quality metric kernels against the scalar reference (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = qualitymetricstest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += qualitymetricstest.cpp \
+    ../qualitymetrics.cpp
+
+HEADERS += ../qualitymetrics.h \
+    ../cpufeatures.h
@@ -0,0 +1,165 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Compares the YUV to RGB conversion kernels of every instruction set supported by this CPU against the
+// scalar reference for the BT.601, BT.709 and BT.2020 matrices with 8, 10 and 12 bit samples. The inputs are
+// random, the lengths cover every remainder of the vector loops and some long rows. The sources and the
+// destination are misaligned and the bytes after the destination have to stay untouched.
+//
+// usage: rgbconversiontest
+// Returns 1 if a kernel differs from the scalar reference.
+
+#include <cstdio>
+#include <vector>
+
+#include "rgbconversion.h"
+
+// the destination is followed by GUARD_SIZE guard bytes
+#define GUARD_SIZE 64
+#define GUARD_VALUE 0xA5
+
+#define NUM_MATRICES 3
+static const char *matrixNames[NUM_MATRICES] = { "601", "709", "2020" };
+
+// the coefficients of FrameObject::conversionCoefficients for 8 bit
+static const YUV2RGBCoefficients coefficients8[NUM_MATRICES] = {
+    { 76309, 104597, -25675, -53279, 132201 },
+    { 76309, 117489, -13975, -34925, 138438 },
+    { 76309, 110013, -12276, -42626, 140363 }
+};
+
+// The 16 bit coefficients of FrameObject::conversionCoefficients for more than 8 bit. There are none for
+// BT.2020, the 8 bit ones are scaled instead. The kernels only have to agree for coefficients of this size.
+static const YUV2RGBCoefficients coefficients16[NUM_MATRICES] = {
+    { 19535114, 26776886,  -6572681, -13639334, 33843539 },
+    { 19535114, 30077204,  -3577718,  -8940735, 35440221 },
+    { 76309*256, 110013*256, -12276*256, -42626*256, 140363*256 }
+};
+
+// the same rounding as FrameObject::conversionCoefficients
+static int scaleCoefficient(int mult, int bps)
+{
+    return (bps < 16) ? ((mult + (1<<(15-bps))) >> (16-bps)) : mult;
+}
+
+static YUV2RGBCoefficients coefficientsFor(int matrix, int bps)
+{
+    if (bps == 8)
+        return coefficients8[matrix];
+
+    const YUV2RGBCoefficients &c = coefficients16[matrix];
+    YUV2RGBCoefficients coef = { scaleCoefficient(c.yMult, bps), scaleCoefficient(c.rvMult, bps), scaleCoefficient(c.guMult, bps),
+                                 scaleCoefficient(c.gvMult, bps), scaleCoefficient(c.buMult, bps) };
+    return coef;
+}
+
+static unsigned int g_random = 12345;
+static unsigned int nextRandom()
+{
+    g_random = g_random * 1103515245 + 12345;
+    return g_random >> 8;
+}
+
+// Random samples of bps bits. Every fourth row also has a few samples above the bit depth,
+// which the SIMD kernels pass to the scalar code.
+template<typename T> static void fillRandom(std::vector<T> &samples, int bps, bool outOfRange)
+{
+    const unsigned int mask = (1u << bps) - 1;
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = (T)(nextRandom() & mask);
+    if (outOfRange && !samples.empty())
+        samples[nextRandom() % samples.size()] = (T)(nextRandom() | (mask + 1));
+}
+
+static bool testConvert8(const RGBConversionKernels *kernels, int matrix, int n, int offset)
+{
+    std::vector<unsigned char> srcY(n + offset), srcU(n + offset), srcV(n + offset);
+    std::vector<unsigned char> dstRef(3*n + offset + GUARD_SIZE, GUARD_VALUE), dst(dstRef);
+    fillRandom(srcY, 8, false);
+    fillRandom(srcU, 8, false);
+    fillRandom(srcV, 8, false);
+
+    const YUV2RGBCoefficients coef = coefficientsFor(matrix, 8);
+    rgbConversionKernelsScalar().convert8(&srcY[offset], &srcU[offset], &srcV[offset], &dstRef[offset], n, coef);
+    kernels->convert8(&srcY[offset], &srcU[offset], &srcV[offset], &dst[offset], n, coef);
+    if (dst == dstRef)
+        return true;
+
+    printf("%s convert8 (%s): differs from the scalar kernel for n=%d (offset %d)\n", kernels->name, matrixNames[matrix], n, offset);
+    return false;
+}
+
+static bool testConvert16(const RGBConversionKernels *kernels, int matrix, int bps, int n, int offset)
+{
+    std::vector<unsigned short> srcY(n + offset), srcU(n + offset), srcV(n + offset);
+    std::vector<unsigned char> dstRef(3*n + offset + GUARD_SIZE, GUARD_VALUE), dst(dstRef);
+    const bool outOfRange = (bps < 16) && (n % 4 == 3);
+    fillRandom(srcY, bps, outOfRange);
+    fillRandom(srcU, bps, outOfRange);
+    fillRandom(srcV, bps, outOfRange);
+
+    const YUV2RGBCoefficients coef = coefficientsFor(matrix, bps);
+    rgbConversionKernelsScalar().convert16(&srcY[offset], &srcU[offset], &srcV[offset], &dstRef[offset], n, coef, bps);
+    kernels->convert16(&srcY[offset], &srcU[offset], &srcV[offset], &dst[offset], n, coef, bps);
+    if (dst == dstRef)
+        return true;
+
+    printf("%s convert16 (%s, %d bit): differs from the scalar kernel for n=%d (offset %d)\n", kernels->name, matrixNames[matrix], bps, n, offset);
+    return false;
+}
+
+static bool testKernels(const RGBConversionKernels *kernels)
+{
+    // all lengths up to several AVX2 vectors and some long rows which are not a multiple of the vector width
+    std::vector<int> lengths;
+    for (int n = 0; n <= 100; n++)
+        lengths.push_back(n);
+    lengths.push_back(1917);
+    lengths.push_back(1920);
+    lengths.push_back(4099);
+
+    bool ok = true;
+    for (int matrix = 0; matrix < NUM_MATRICES; matrix++)
+    {
+        for (size_t i = 0; i < lengths.size(); i++)
+        {
+            const int n = lengths[i];
+            for (int offset = 0; offset < 4; offset++)
+            {
+                ok = testConvert8(kernels, matrix, n, offset) && ok;
+                ok = testConvert16(kernels, matrix, 10, n, offset) && ok;
+                ok = testConvert16(kernels, matrix, 12, n, offset) && ok;
+            }
+        }
+    }
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    for (int i = 0; rgbConversionKernelsSupported(i) != NULL; i++)
+    {
+        const RGBConversionKernels *kernels = rgbConversionKernelsSupported(i);
+        const bool kernelsOk = testKernels(kernels);
+        printf("%-8s %s\n", kernels->name, kernelsOk ? "passed" : "FAILED");
+        ok = kernelsOk && ok;
+    }
+    return ok ? 0 : 1;
+}
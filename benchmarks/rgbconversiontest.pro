@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# SIMD YUV to RGB conversion kernels against the scalar reference (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = rgbconversiontest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += rgbconversiontest.cpp \
+    ../rgbconversion.cpp
+
+HEADERS += ../rgbconversion.h \
+    ../cpufeatures.h
@@ -0,0 +1,217 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Throughput of the sequence metrics against reading the frames: all frames of two 4:2:0 8 bit files are read with
+// YUVFile::getPlanes (every sample is touched), then PSNR, SSIM and MS-SSIM of the Y, U and V planes are timed
+// separately on one thread and together on all threads over the frames like SequenceMetrics does.
+//
+// usage: sequencemetricsbench [width height frames [fileA fileB]]
+// Without files two synthetic sequences of width x height (default 1920x1080) and frames (default 50) are written
+// to the temp directory and removed afterwards. They are read from the page cache then, so the read throughput is
+// the upper bound of the one of a disk. Drop the caches and give the files to measure a disk.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <cstdio>
+
+#include "yuvfile.h"
+#include "qualitymetrics.h"
+
+// B is A with noise of +-8, so the metrics do not take a shortcut for identical planes
+static bool writeSyntheticFiles(const QString &pathA, const QString &pathB, int width, int height, int frames)
+{
+    QFile fileA(pathA);
+    QFile fileB(pathB);
+    if (!fileA.open(QIODevice::WriteOnly | QIODevice::Truncate) || !fileB.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const qint64 bpf = YUVFile::bytesPerFrame(width, height, YUVC_420YpCbCr8PlanarPixelFormat);
+    QByteArray frameA(bpf, 0);
+    QByteArray frameB(bpf, 0);
+    quint32 random = 12345;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        unsigned char *a = (unsigned char*)frameA.data();
+        unsigned char *b = (unsigned char*)frameB.data();
+        const int lumaLength = width*height;
+        for (qint64 i = 0; i < bpf; i++)
+        {
+            random = random * 1664525 + 1013904223;
+            const int pos = (i < lumaLength) ? (int)i : (int)((i - lumaLength) % (lumaLength/4));
+            const int x = pos % ((i < lumaLength) ? width : width/2);
+            const int y = pos / ((i < lumaLength) ? width : width/2);
+            a[i] = (unsigned char)(x + 2*y + frame + ((random >> 24) & 31));
+            const int noisy = (int)a[i] + (int)((random >> 16) & 15) - 8;
+            b[i] = (unsigned char)qBound(0, noisy, 255);
+        }
+        if (fileA.write(frameA) != bpf || fileB.write(frameB) != bpf)
+            return false;
+    }
+    return true;
+}
+
+// sum of all samples, so every page of a mapped file is read
+static quint64 touchPlanes(const YUVPlanes &planes)
+{
+    quint64 sum = 0;
+    for (int c = 0; c < 3; c++)
+    {
+        if (planes.data[c] == NULL)
+            continue;
+        const unsigned char *src = (const unsigned char*)planes.data[c];
+        const qint64 length = (qint64)planes.width[c] * planes.height[c] * planes.bytesPerSample;
+        for (qint64 i = 0; i < length; i++)
+            sum += src[i];
+    }
+    return sum;
+}
+
+enum BenchMetric { BENCH_PSNR, BENCH_SSIM, BENCH_MSSSIM, BENCH_NUM_METRICS };
+static const char *metricNames[BENCH_NUM_METRICS] = { "PSNR", "SSIM", "MS-SSIM" };
+
+// the metric of the three planes of a frame, the result keeps the computation from being optimized away
+static double computeMetric(BenchMetric metric, const YUVPlanes &a, const YUVPlanes &b)
+{
+    double sum = 0.0;
+    for (int c = 0; c < 3; c++)
+    {
+        if (a.data[c] == NULL || b.data[c] == NULL)
+            continue;
+        if (metric == BENCH_PSNR)
+            sum += (double)planeSSE(a.data[c], b.data[c], a.width[c], a.height[c], a.bytesPerSample);
+        else if (metric == BENCH_SSIM)
+            sum += planeSSIM(a.data[c], b.data[c], a.width[c], a.height[c], a.bytesPerSample, 8);
+        else
+            sum += planeMSSSIM(a.data[c], b.data[c], a.width[c], a.height[c], a.bytesPerSample, 8);
+    }
+    return sum;
+}
+
+static void printThroughput(const char *name, double seconds, int frames, qint64 bytes)
+{
+    printf("%-28s %8.3f s %8.1f frames/s %8.1f MB/s\n", name, seconds, frames / seconds, bytes / seconds / (1 << 20));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int width = (argc > 3) ? QString(argv[1]).toInt() : 1920;
+    const int height = (argc > 3) ? QString(argv[2]).toInt() : 1080;
+    const int frames = (argc > 3) ? QString(argv[3]).toInt() : 50;
+    const bool synthetic = (argc <= 5);
+    const QString pathA = synthetic ? QDir::temp().filePath("sequencemetricsbench_a.yuv") : QString(argv[4]);
+    const QString pathB = synthetic ? QDir::temp().filePath("sequencemetricsbench_b.yuv") : QString(argv[5]);
+    if (width <= 0 || height <= 0 || (width % 2) != 0 || (height % 2) != 0 || frames <= 0)
+    {
+        printf("invalid size %dx%d or %d frames\n", width, height, frames);
+        return 1;
+    }
+
+    if (synthetic && !writeSyntheticFiles(pathA, pathB, width, height, frames))
+    {
+        printf("could not write %s and %s\n", qPrintable(pathA), qPrintable(pathB));
+        QFile::remove(pathA);
+        QFile::remove(pathB);
+        return 1;
+    }
+
+    bool ok = true;
+    {
+        YUVFile fileA(pathA);
+        YUVFile fileB(pathB);
+        fileA.setSrcPixelFormat(YUVC_420YpCbCr8PlanarPixelFormat);
+        fileB.setSrcPixelFormat(YUVC_420YpCbCr8PlanarPixelFormat);
+        const int numFrames = qMin(frames, qMin(fileA.getNumberFrames(width, height), fileB.getNumberFrames(width, height)));
+        const qint64 bytes = 2 * YUVFile::bytesPerFrame(width, height, YUVC_420YpCbCr8PlanarPixelFormat) * numFrames;
+        printf("%dx%d, %d frames of two files (%s)\n", width, height, numFrames, (fileA.isMapped() && fileB.isMapped()) ? "mapped" : "not mapped");
+
+        QElapsedTimer timer;
+        QByteArray buffers[2];
+        YUVPlanes planes[2];
+
+        // reading
+        quint64 checksum = 0;
+        timer.start();
+        for (int i = 0; i < numFrames; i++)
+        {
+            if (!fileA.getPlanes(&buffers[0], i, width, height, &planes[0]) || !fileB.getPlanes(&buffers[1], i, width, height, &planes[1]))
+            {
+                printf("could not read frame %d\n", i);
+                ok = false;
+                break;
+            }
+            checksum += touchPlanes(planes[0]) + touchPlanes(planes[1]);
+        }
+        const double readSeconds = timer.nsecsElapsed() * 1e-9;
+        printThroughput("read", readSeconds, numFrames, bytes);
+
+        // each metric on one thread (the frames are read again, the time of reading is not counted)
+        double result = 0.0;
+        double metricSeconds[BENCH_NUM_METRICS] = { 0.0, 0.0, 0.0 };
+        for (int i = 0; i < numFrames && ok; i++)
+        {
+            fileA.getPlanes(&buffers[0], i, width, height, &planes[0]);
+            fileB.getPlanes(&buffers[1], i, width, height, &planes[1]);
+            for (int m = 0; m < BENCH_NUM_METRICS; m++)
+            {
+                timer.start();
+                result += computeMetric((BenchMetric)m, planes[0], planes[1]);
+                metricSeconds[m] += timer.nsecsElapsed() * 1e-9;
+            }
+        }
+        for (int m = 0; m < BENCH_NUM_METRICS && ok; m++)
+            printThroughput(metricNames[m], metricSeconds[m], numFrames, bytes);
+
+        // reading and all metrics over the frames on all threads, like SequenceMetrics::worker
+        YUVFile *files[2] = { &fileA, &fileB };
+        int frameWidth = width;
+        int frameHeight = height;
+        int parallelFrames = numFrames;
+        int i;
+        timer.start();
+#pragma omp parallel for default(none) private(i) shared(files,frameWidth,frameHeight,parallelFrames) reduction(+:result) schedule(dynamic)
+        for (i = 0; i < parallelFrames; i++)
+        {
+            QByteArray frameBuffers[2];
+            YUVPlanes framePlanes[2];
+            if (!files[0]->getPlanes(&frameBuffers[0], i, frameWidth, frameHeight, &framePlanes[0]) ||
+                !files[1]->getPlanes(&frameBuffers[1], i, frameWidth, frameHeight, &framePlanes[1]))
+                continue;
+            for (int m = 0; m < BENCH_NUM_METRICS; m++)
+                result += computeMetric((BenchMetric)m, framePlanes[0], framePlanes[1]);
+        }
+        const double parallelSeconds = timer.nsecsElapsed() * 1e-9;
+        if (ok)
+        {
+            printThroughput("read and all metrics (omp)", parallelSeconds, numFrames, bytes);
+            printf("all metrics take %.2fx the time of reading (checksums %llu %g)\n", parallelSeconds / readSeconds,
+                   (unsigned long long)checksum, result);
+        }
+    }
+
+    if (synthetic)
+    {
+        QFile::remove(pathA);
+        QFile::remove(pathB);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# Throughput of the sequence metrics against reading the frames (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = sequencemetricsbench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+linux|win32-g++ {
+    QMAKE_CXXFLAGS += -fopenmp
+    QMAKE_LFLAGS *= -fopenmp
+}
+win32-msvc* {
+    QMAKE_CXXFLAGS += -openmp
+    QMAKE_LFLAGS += -openmp
+}
+
+SOURCES += sequencemetricsbench.cpp \
+    ../yuvfile.cpp \
+    ../chromaupsampling.cpp \
+    ../qualitymetrics.cpp
+
+HEADERS += ../yuvfile.h \
+    ../chromaupsampling.h \
+    ../qualitymetrics.h \
+    ../cpufeatures.h \
+    ../typedef.h
@@ -0,0 +1,232 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Memory of the parsed statistics of a CSV statistics file (e.g. an HM/VTM dump): the list of StatisticsItem
+// structs that was used before StatisticsItemList against the packed StatisticsItemList with its spatial index.
+// All POCs and types of the file are parsed into the representation. Reported are the bytes computed from the
+// container layouts (for StatisticsItemList the size StatisticsObject::statisticsCacheCost is based on) and the
+// growth of the resident memory of the process (Linux only, includes the allocator overhead).
+//
+// usage: statsmemory file
+// Both representations are built in their own process (statsmemory file old|new), so the memory
+// that is freed after the first one can not be reused by the second one.
+
+#include <QCoreApplication>
+#include <QColor>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QProcess>
+#include <QRect>
+#include <QSet>
+#include <cstdio>
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+#include "statslinetokenizer.h"
+#include "statisticsextensions.h"
+
+// the item of a statistics block before StatisticsItemList (a QList of these per POC/type)
+enum LegacyStatisticsType { legacyArrowType = 0, legacyBlockType };
+struct LegacyStatisticsItem
+{
+    LegacyStatisticsType type;
+    QColor color;
+    QColor gridColor;
+    QRect positionRect;
+    float vector[2];
+    int rawValues[2];
+};
+typedef QList<LegacyStatisticsItem> LegacyStatisticsItemList;
+
+struct MemoryResult
+{
+    qint64 blocks;
+    qint64 computedBytes;
+    qint64 residentBytes;   // -1 if not available
+};
+
+static qint64 residentBytes()
+{
+#if defined(Q_OS_LINUX)
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const QList<QByteArray> pages = statm.readAll().split(' ');
+    return (pages.count() > 1) ? pages[1].toLongLong() * sysconf(_SC_PAGESIZE) : -1;
+#else
+    return -1;
+#endif
+}
+
+// the frame size and the vector types from the header of the file
+static bool readHeader(QFile &file, int *width, int *height, QSet<int> *vectorTypes)
+{
+    *width = *height = 0;
+    char lineBuffer[STATS_LINE_BUFFER_SIZE];
+    qint64 lineLength;
+    while ((lineLength = readStatsLine(&file, lineBuffer)) >= 0)
+    {
+        const QStringList row = parseStatsCSVLine(QString::fromLatin1(lineBuffer, lineLength), ';');
+        if (row[0].isEmpty())
+            continue;
+        if (row[0][0] != '%')
+            break;
+
+        if (row.count() >= 5 && row[1] == "type" && row[4] == "vector")
+            vectorTypes->insert(row[2].toInt());
+        else if (row.count() >= 6 && row[1] == "seq-specs")
+        {
+            *width = row[4].toInt();
+            *height = row[5].toInt();
+        }
+    }
+    file.seek(0);
+    return *width > 0 && *height > 0;
+}
+
+static MemoryResult measure(const QString &path, bool packed)
+{
+    MemoryResult result = { 0, 0, -1 };
+
+    QFile file(path);
+    int width, height;
+    QSet<int> vectorTypes;
+    if (!file.open(QIODevice::ReadOnly) || !readHeader(file, &width, &height, &vectorTypes))
+    {
+        printf("could not read the header of %s\n", qPrintable(path));
+        return result;
+    }
+
+    const qint64 residentBefore = residentBytes();
+
+    // [POC][type] like the statistics cache
+    QHash<int, QHash<int, LegacyStatisticsItemList> > legacyStats;
+    QHash<int, QHash<int, StatisticsItemList> > packedStats;
+
+    char lineBuffer[STATS_LINE_BUFFER_SIZE];
+    StatsLineFields fields;
+    qint64 lineLength;
+    while ((lineLength = readStatsLine(&file, lineBuffer)) >= 0)
+    {
+        tokenizeStatsLine(lineBuffer, lineLength, fields);
+        if (fields.isEmpty() || fields.isHeader() || fields.count < 7)
+            continue;
+
+        const int poc = fields.toInt(0);
+        const int type = fields.toInt(5);
+        const bool isVector = vectorTypes.contains(type);
+        const int value1 = fields.toInt(6);
+        const int value2 = (fields.count >= 8) ? fields.toInt(7) : 0;
+
+        if (packed)
+            packedStats[poc][type].append(fields.toInt(1), fields.toInt(2), fields.toUInt(3), fields.toUInt(4), value1, value2, isVector);
+        else
+        {
+            LegacyStatisticsItem item;
+            item.type = isVector ? legacyArrowType : legacyBlockType;
+            item.positionRect = QRect(fields.toInt(1), fields.toInt(2), fields.toUInt(3), fields.toUInt(4));
+            item.vector[0] = (float)value1;
+            item.vector[1] = (float)value2;
+            item.rawValues[0] = value1;
+            item.rawValues[1] = value2;
+            legacyStats[poc][type].append(item);
+        }
+        result.blocks++;
+    }
+
+    if (packed)
+    {
+        QHash<int, QHash<int, StatisticsItemList> >::iterator poc;
+        for (poc = packedStats.begin(); poc != packedStats.end(); poc++)
+        {
+            QHash<int, StatisticsItemList>::iterator type;
+            for (type = poc.value().begin(); type != poc.value().end(); type++)
+            {
+                type.value().buildIndex(width, height);
+                result.computedBytes += type.value().memorySize() * sizeof(int);
+            }
+        }
+    }
+    else
+    {
+        // QList keeps items of this size in heap nodes and stores a pointer per item
+        result.computedBytes = result.blocks * (qint64)(sizeof(LegacyStatisticsItem) + sizeof(void*));
+    }
+
+    if (residentBefore >= 0)
+        result.residentBytes = residentBytes() - residentBefore;
+    return result;
+}
+
+static void printResult(const char *name, const MemoryResult &result, const MemoryResult &reference)
+{
+    const double mb = 1024.0 * 1024.0;
+    printf("%-22s %10.1f MB computed  %6.1f bytes/block", name, result.computedBytes / mb, (double)result.computedBytes / qMax(result.blocks, (qint64)1));
+    if (result.residentBytes >= 0)
+        printf("  %10.1f MB resident", result.residentBytes / mb);
+    if (&result != &reference)
+        printf("  %5.2fx less", (double)reference.computedBytes / qMax(result.computedBytes, (qint64)1));
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    if (argc < 2)
+    {
+        printf("usage: statsmemory file\n");
+        return 1;
+    }
+    const QString path = QString(argv[1]);
+
+    // child process: build one representation and print the result in one line
+    if (argc > 2)
+    {
+        const MemoryResult result = measure(path, QString(argv[2]) == "new");
+        printf("%lld %lld %lld\n", (long long)result.blocks, (long long)result.computedBytes, (long long)result.residentBytes);
+        return result.blocks > 0 ? 0 : 1;
+    }
+
+    MemoryResult results[2];
+    const char *modes[2] = { "old", "new" };
+    for (int i = 0; i < 2; i++)
+    {
+        QProcess child;
+        child.start(QCoreApplication::applicationFilePath(), QStringList() << path << modes[i]);
+        if (!child.waitForFinished(-1) || child.exitCode() != 0)
+        {
+            printf("measuring the %s representation failed: %s\n", modes[i], child.readAllStandardOutput().constData());
+            return 1;
+        }
+        const QList<QByteArray> values = child.readAllStandardOutput().trimmed().split(' ');
+        if (values.count() != 3)
+            return 1;
+        results[i].blocks = values[0].toLongLong();
+        results[i].computedBytes = values[1].toLongLong();
+        results[i].residentBytes = values[2].toLongLong();
+    }
+
+    printf("%s: %lld blocks\n", qPrintable(path), (long long)results[0].blocks);
+    printResult("QList<StatisticsItem>", results[0], results[0]);
+    printResult("StatisticsItemList", results[1], results[0]);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Memory of the parsed statistics before and after StatisticsItemList (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = statsmemory
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += statsmemory.cpp
+
+HEADERS += ../statslinetokenizer.h \
+    ../statisticsextensions.h
@@ -0,0 +1,316 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Throughput of the parsers of the data lines of CSV statistics files:
+// the QString based parser (parseStatsCSVLine and QString::toInt for every field) against the
+// in place tokenizer (tokenizeStatsLine) that is used by StatisticsObject. Both are also run with the
+// colors of the color range types: ColorRange::getColor for every block against the lookup tables.
+//
+// usage: statsparsebench [sizeInMB [file]]
+// A synthetic statistics file of sizeInMB (default 1024) is written to file (default in the temp
+// directory) if it does not exist yet. Both parsers read the whole file, the results are compared.
+// Before, the colors of the lookup tables are checked against getColor within [rangeMin, rangeMax].
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <cstdio>
+
+#include "statslinetokenizer.h"
+#include "statisticsextensions.h"
+
+// types of the synthetic file, NULL for the vector type
+#define BENCH_NUM_TYPES 4
+typedef ColorRange *BenchColorRanges[BENCH_NUM_TYPES];
+
+// result of a parser run, the sums make sure that both parsers read the same values
+struct ParseResult
+{
+    qint64 lines;
+    qint64 valueSum;
+    quint32 colorSum;   // keeps the colors from being optimized away (the lookup tables sample wide ranges)
+    double seconds;
+};
+
+static const char *syntheticHeader =
+        "%;syntax-version;v1.01\n"
+        "%;seq-specs;synthetic;layer0;1920;1080;50\n"
+        "%;type;0;Range;range\n"
+        "%;range;0;255;0;255;0;0;0;0;255;255\n"
+        "%;type;1;Jet;range\n"
+        "%;defaultRange;-128;127;jet\n"
+        "%;type;2;Heat;range\n"
+        "%;defaultRange;0;4095;heat\n"
+        "%;type;3;MVs;vector\n"
+        "%;vectorColor;255;0;0;255\n";
+
+// Blocks of 8x8 to 64x64 over 1920x1080 frames. Types 0-2 have one value, type 3 is a vector.
+static bool writeSyntheticFile(const QString &path, qint64 size)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    QByteArray chunk(syntheticHeader);
+    quint32 random = 12345;
+    qint64 written = 0;
+    for (int poc = 0; written < size; poc++)
+    {
+        for (int type = 0; type < 4 && written < size; type++)
+        {
+            for (int y = 0; y < 1080; y += 64)
+            {
+                for (int x = 0; x < 1920; x += 64)
+                {
+                    random = random * 1664525 + 1013904223;
+                    const int blockSize = 8 << ((random >> 8) & 3);
+                    char line[128];
+                    int length;
+                    if (type == 3)
+                        length = qsnprintf(line, sizeof(line), "%d;%d;%d;%d;%d;%d;%d;%d\n", poc, x, y, blockSize, blockSize, type, (int)((random >> 12) & 255) - 128, (int)((random >> 20) & 255) - 128);
+                    else if (type == 2)
+                        length = qsnprintf(line, sizeof(line), "%d;%d;%d;%d;%d;%d;%d\n", poc, x, y, blockSize, blockSize, type, (int)((random >> 12) & 4095));
+                    else
+                        length = qsnprintf(line, sizeof(line), "%d;%d;%d;%d;%d;%d;%d\n", poc, x, y, blockSize, blockSize, type, (type == 0) ? (int)((random >> 12) & 255) : (int)((random >> 12) & 255) - 128);
+                    chunk.append(line, length);
+                }
+            }
+
+            if (chunk.size() >= (1 << 20))
+            {
+                if (file.write(chunk) != chunk.size())
+                    return false;
+                written += chunk.size();
+                chunk.clear();
+            }
+        }
+    }
+    return file.write(chunk) == chunk.size();
+}
+
+// the color ranges of the header of the synthetic file, created like StatisticsObject::readHeaderFromDevice does
+static void createColorRanges(BenchColorRanges ranges)
+{
+    for (int i = 0; i < BENCH_NUM_TYPES; i++)
+        ranges[i] = NULL;
+
+    int typeID = INT_INVALID;
+    foreach (const QString &line, QString(syntheticHeader).split('\n'))
+    {
+        QStringList rowItemList = parseStatsCSVLine(line, ';');
+        if (rowItemList.count() < 3)
+            continue;
+        if (rowItemList[1] == "type")
+            typeID = rowItemList[2].toInt();
+        else if (rowItemList[1] == "range" && typeID >= 0 && typeID < BENCH_NUM_TYPES)
+            ranges[typeID] = new ColorRange(rowItemList);
+        else if (rowItemList[1] == "defaultRange" && typeID >= 0 && typeID < BENCH_NUM_TYPES)
+            ranges[typeID] = new DefaultColorRange(rowItemList);
+    }
+}
+
+// The lookup table of range must give the color of getColor for every integer value of the range. Tables of
+// wide ranges hold equally spaced samples, their colors must be the ones of the nearest sample.
+// Returns the number of wrong colors, the largest difference to getColor(value) is returned in maxDeviation.
+static int checkLUT(ColorRange *range, int *maxDeviation)
+{
+    range->buildLUT();
+    const int span = range->rangeMax - range->rangeMin;
+    const int n = (span <= 0) ? 1 : qMin(span + 1, COLOR_RANGE_LUT_SIZE);
+
+    int errors = 0;
+    *maxDeviation = 0;
+    for (int value = range->rangeMin; value <= range->rangeMax; value++)
+    {
+        const QRgb lutColor = range->lookupColor((float)value);
+        const QRgb exactColor = range->getColor((float)value).rgba();
+
+        QRgb expectedColor = exactColor;
+        if (n < span + 1)
+        {
+            const int k = (int)floor((float)(value - range->rangeMin) * (n-1) / (float)span + 0.5f);
+            expectedColor = range->getColor(range->rangeMin + (float)k * span / (n-1)).rgba();
+        }
+        if (lutColor != expectedColor)
+            errors++;
+
+        const int deviation = qMax(qMax(qAbs(qRed(lutColor) - qRed(exactColor)), qAbs(qGreen(lutColor) - qGreen(exactColor))),
+                                   qMax(qAbs(qBlue(lutColor) - qBlue(exactColor)), qAbs(qAlpha(lutColor) - qAlpha(exactColor))));
+        *maxDeviation = qMax(*maxDeviation, deviation);
+    }
+    return errors;
+}
+
+static bool checkColorRangeLUTs()
+{
+    static const char *colormaps[] = { "jet", "heat", "hsv", "hot", "cool", "spring", "summer", "autumn", "winter",
+                                       "gray", "bone", "copper", "pink", "lines" };
+    static const int ranges[][2] = { {0, 255}, {-128, 127}, {0, COLOR_RANGE_LUT_SIZE-1}, {0, 6000}, {-32768, 32767} };
+
+    int totalErrors = 0;
+    for (unsigned int r = 0; r < sizeof(ranges)/sizeof(ranges[0]); r++)
+    {
+        QList<ColorRange*> colorRanges;
+
+        ColorRange *colorRange = new ColorRange();
+        colorRange->rangeMin = ranges[r][0];
+        colorRange->rangeMax = ranges[r][1];
+        colorRange->minColor = QColor(0, 0, 255, 0);
+        colorRange->maxColor = QColor(255, 128, 0, 255);
+        colorRanges.append(colorRange);
+
+        for (unsigned int c = 0; c < sizeof(colormaps)/sizeof(colormaps[0]); c++)
+        {
+            QStringList row;
+            row << "%" << "defaultRange" << QString::number(ranges[r][0]) << QString::number(ranges[r][1]) << colormaps[c];
+            colorRanges.append(new DefaultColorRange(row));
+        }
+
+        for (int i = 0; i < colorRanges.count(); i++)
+        {
+            int maxDeviation;
+            const int errors = checkLUT(colorRanges[i], &maxDeviation);
+            totalErrors += errors;
+            if (errors > 0 || maxDeviation > 0)
+                printf("range [%d, %d] %-6s %d wrong colors, largest difference to getColor %d\n", ranges[r][0], ranges[r][1],
+                       (i == 0) ? "range" : colormaps[i-1], errors, maxDeviation);
+        }
+        qDeleteAll(colorRanges);
+    }
+
+    printf("color lookup tables: %s\n", (totalErrors == 0) ? "OK" : "FAILED");
+    return totalErrors == 0;
+}
+
+// the parser of StatisticsObject::readStatisticsFromFile before the tokenizer, with the colors of getColor
+static ParseResult parseWithQString(const QString &path, BenchColorRanges colorRanges)
+{
+    ParseResult result = { 0, 0, 0, 0.0 };
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString aLine = in.readLine();
+        QStringList rowItemList = parseStatsCSVLine(aLine, ';');
+        if (rowItemList[0].isEmpty() || rowItemList[0][0] == '%')
+            continue;
+
+        for (int i = 0; i < rowItemList.count(); i++)
+            result.valueSum += rowItemList[i].toInt();
+        result.lines++;
+
+        const int type = rowItemList[5].toInt();
+        if (colorRanges != NULL && type >= 0 && type < BENCH_NUM_TYPES && colorRanges[type] != NULL)
+            result.colorSum += colorRanges[type]->getColor((float)rowItemList[6].toInt()).rgba();
+    }
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    return result;
+}
+
+// the parser of StatisticsObject, with the colors of the lookup tables
+static ParseResult parseWithTokenizer(const QString &path, BenchColorRanges colorRanges)
+{
+    ParseResult result = { 0, 0, 0, 0.0 };
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+
+    QElapsedTimer timer;
+    timer.start();
+    char lineBuffer[STATS_LINE_BUFFER_SIZE];
+    StatsLineFields fields;
+    qint64 lineLength;
+    while ((lineLength = readStatsLine(&file, lineBuffer)) >= 0)
+    {
+        tokenizeStatsLine(lineBuffer, lineLength, fields);
+        if (fields.isEmpty() || fields.isHeader())
+            continue;
+
+        for (int i = 0; i < fields.count; i++)
+            result.valueSum += fields.toInt(i);
+        result.lines++;
+
+        const int type = fields.toInt(5);
+        if (colorRanges != NULL && type >= 0 && type < BENCH_NUM_TYPES && colorRanges[type] != NULL)
+            result.colorSum += colorRanges[type]->lookupColor((float)fields.toInt(6));
+    }
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    return result;
+}
+
+static void printResult(const char *name, const ParseResult &result, const ParseResult &reference)
+{
+    printf("%-12s %10lld lines  %8.2f s  %12.0f lines/s  %6.2fx\n", name, (long long)result.lines, result.seconds,
+           result.lines / result.seconds, reference.seconds / result.seconds);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const qint64 sizeInMB = (argc > 1) ? QString(argv[1]).toLongLong() : 1024;
+    const QString path = (argc > 2) ? QString(argv[2]) : QDir::temp().filePath(QString("statsparsebench_%1MB.csv").arg(sizeInMB));
+
+    if (!QFile::exists(path))
+    {
+        printf("writing %s\n", qPrintable(path));
+        if (!writeSyntheticFile(path, sizeInMB << 20))
+        {
+            printf("could not write %s\n", qPrintable(path));
+            return 1;
+        }
+    }
+
+    if (!checkColorRangeLUTs())
+        return 1;
+
+    // the first run reads the file into the page cache of the OS, so both parsers read from memory
+    parseWithTokenizer(path, NULL);
+
+    const ParseResult oldResult = parseWithQString(path, NULL);
+    const ParseResult newResult = parseWithTokenizer(path, NULL);
+
+    printf("%s (%lld MB)\n", qPrintable(path), (long long)(QFile(path).size() >> 20));
+    printResult("QString", oldResult, oldResult);
+    printResult("tokenizer", newResult, oldResult);
+
+    // three of the four types of the synthetic file are color ranges
+    BenchColorRanges colorRanges;
+    createColorRanges(colorRanges);
+    const ParseResult oldColorResult = parseWithQString(path, colorRanges);
+    const ParseResult newColorResult = parseWithTokenizer(path, colorRanges);
+    printResult("getColor", oldColorResult, oldColorResult);
+    printResult("LUT", newColorResult, oldColorResult);
+    for (int i = 0; i < BENCH_NUM_TYPES; i++)
+        delete colorRanges[i];
+
+    if (oldResult.lines != newResult.lines || oldResult.valueSum != newResult.valueSum ||
+        oldColorResult.valueSum != newColorResult.valueSum)
+    {
+        printf("the parsers read different values\n");
+        return 1;
+    }
+    return 0;
+}
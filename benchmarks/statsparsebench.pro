@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Throughput of the statistics line parsers and color ranges (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = statsparsebench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += statsparsebench.cpp
+
+HEADERS += ../statslinetokenizer.h \
+    ../statisticsextensions.h
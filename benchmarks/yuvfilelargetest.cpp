@@ -0,0 +1,168 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Frame offsets beyond 4 GB in YUVFile: a sparse 1920x1080 4:2:0 8 bit file of sizeInGB (default 20) is created
+// with QFile::resize and only the last frame is written. getNumberFrames has to count all frames and getOneFrame
+// and getSampleValues have to return the pattern of the last frame, the frames before it are zero.
+//
+// usage: yuvfilelargetest [sizeInGB [file]]
+// The file (default in the temp directory) is removed afterwards. It only occupies the size of one frame on file
+// systems with sparse files. Returns 1 if a check fails.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <cstdio>
+#include <limits>
+
+#include "yuvfile.h"
+
+#define TEST_WIDTH 1920
+#define TEST_HEIGHT 1080
+
+static unsigned char patternY(int x, int y) { return (unsigned char)(x + 3*y + 1); }
+static unsigned char patternU(int cx, int cy) { return (unsigned char)(5*cx + cy + 7); }
+static unsigned char patternV(int cx, int cy) { return (unsigned char)(255 - 5*cx - cy); }
+
+static bool writeSparseFile(const QString &path, qint64 fileSize, qint64 lastFrameOffset)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    if (!file.resize(fileSize))
+        return false;
+
+    const int lumaLength = TEST_WIDTH*TEST_HEIGHT;
+    const int chromaWidth = TEST_WIDTH/2;
+    const int chromaLength = chromaWidth*(TEST_HEIGHT/2);
+    QByteArray frame(lumaLength + 2*chromaLength, 0);
+    unsigned char *dst = (unsigned char*)frame.data();
+    for (int y = 0; y < TEST_HEIGHT; y++)
+        for (int x = 0; x < TEST_WIDTH; x++)
+            dst[y*TEST_WIDTH + x] = patternY(x, y);
+    for (int cy = 0; cy < TEST_HEIGHT/2; cy++)
+    {
+        for (int cx = 0; cx < chromaWidth; cx++)
+        {
+            dst[lumaLength + cy*chromaWidth + cx] = patternU(cx, cy);
+            dst[lumaLength + chromaLength + cy*chromaWidth + cx] = patternV(cx, cy);
+        }
+    }
+
+    return file.seek(lastFrameOffset) && file.write(frame) == frame.size();
+}
+
+// the YUV444 frame of getOneFrame (8 bit, nearest neighbor upsampling)
+static bool checkFrame(const QByteArray &frame, bool pattern)
+{
+    const int lumaLength = TEST_WIDTH*TEST_HEIGHT;
+    if (frame.size() != 3*lumaLength)
+    {
+        printf("getOneFrame returned %d bytes instead of %d\n", frame.size(), 3*lumaLength);
+        return false;
+    }
+
+    const unsigned char *src = (const unsigned char*)frame.constData();
+    for (int y = 0; y < TEST_HEIGHT; y++)
+    {
+        for (int x = 0; x < TEST_WIDTH; x++)
+        {
+            const int pos = y*TEST_WIDTH + x;
+            const int expectedY = pattern ? patternY(x, y) : 0;
+            const int expectedU = pattern ? patternU(x/2, y/2) : 0;
+            const int expectedV = pattern ? patternV(x/2, y/2) : 0;
+            if (src[pos] != expectedY || src[lumaLength + pos] != expectedU || src[2*lumaLength + pos] != expectedV)
+            {
+                printf("getOneFrame: wrong sample at (%d, %d): %d %d %d instead of %d %d %d\n", x, y,
+                       src[pos], src[lumaLength + pos], src[2*lumaLength + pos], expectedY, expectedU, expectedV);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool checkSampleValues(YUVFile *file, unsigned int frameIdx)
+{
+    const int points[][2] = { {0, 0}, {1, 1}, {TEST_WIDTH-1, 0}, {977, 541}, {TEST_WIDTH-1, TEST_HEIGHT-1} };
+    for (unsigned int i = 0; i < sizeof(points)/sizeof(points[0]); i++)
+    {
+        const int x = points[i][0];
+        const int y = points[i][1];
+        int valY, valU, valV;
+        if (!file->getSampleValues(frameIdx, TEST_WIDTH, TEST_HEIGHT, x, y, &valY, &valU, &valV) ||
+            valY != patternY(x, y) || valU != patternU(x/2, y/2) || valV != patternV(x/2, y/2))
+        {
+            printf("getSampleValues: wrong values at (%d, %d)\n", x, y);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const qint64 sizeInGB = (argc > 1) ? QString(argv[1]).toLongLong() : 20;
+    const QString path = (argc > 2) ? QString(argv[2]) : QDir::temp().filePath("yuvfilelargetest_1920x1080.yuv");
+
+    const qint64 fileSize = sizeInGB << 30;
+    const qint64 bpf = YUVFile::bytesPerFrame(TEST_WIDTH, TEST_HEIGHT, YUVC_420YpCbCr8PlanarPixelFormat);
+    const qint64 numFrames = fileSize / bpf;
+    const unsigned int lastFrame = (unsigned int)(numFrames - 1);
+    if (numFrames < 2 || numFrames > std::numeric_limits<int>::max())
+    {
+        printf("invalid size %lld GB\n", (long long)sizeInGB);
+        return 1;
+    }
+
+    if (!writeSparseFile(path, fileSize, lastFrame*bpf))
+    {
+        printf("could not write %s\n", qPrintable(path));
+        QFile::remove(path);
+        return 1;
+    }
+
+    bool ok = true;
+    {
+        YUVFile file(path);
+        file.setSrcPixelFormat(YUVC_420YpCbCr8PlanarPixelFormat);
+        printf("%s: %lld GB, %lld frames, last frame at %lld bytes, %s\n", qPrintable(path), (long long)sizeInGB,
+               (long long)numFrames, (long long)(lastFrame*bpf), file.isMapped() ? "mapped" : "not mapped");
+
+        const int countedFrames = file.getNumberFrames(TEST_WIDTH, TEST_HEIGHT);
+        if (countedFrames != numFrames)
+        {
+            printf("getNumberFrames returned %d instead of %lld\n", countedFrames, (long long)numFrames);
+            ok = false;
+        }
+
+        QByteArray frame;
+        file.getOneFrame(&frame, lastFrame, TEST_WIDTH, TEST_HEIGHT);
+        ok = checkFrame(frame, true) && ok;
+        file.getOneFrame(&frame, lastFrame - 1, TEST_WIDTH, TEST_HEIGHT);
+        ok = checkFrame(frame, false) && ok;
+        ok = checkSampleValues(&file, lastFrame) && ok;
+    }
+
+    QFile::remove(path);
+    printf("%s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Frame offsets beyond 4 GB in YUVFile (not part of YUView)
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = yuvfilelargetest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += yuvfilelargetest.cpp \
+    ../yuvfile.cpp \
+    ../chromaupsampling.cpp
+
+HEADERS += ../yuvfile.h \
+    ../chromaupsampling.h \
+    ../cpufeatures.h \
+    ../typedef.h
@@ -0,0 +1,292 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "chromaupsampling.h"
+#include "cpufeatures.h"
+#include <cstddef>
+
+/////////////////////////////////////////////////////////////////////////////
+// scalar reference
+
+static void holdRow8_c(const unsigned char *src, unsigned char *dst, int n)
+{
+    for (int i = 0; i < n; i++)
+        dst[2*i] = dst[2*i+1] = src[i];
+}
+
+static void holdRow16_c(const unsigned short *src, unsigned short *dst, int n)
+{
+    for (int i = 0; i < n; i++)
+        dst[2*i] = dst[2*i+1] = src[i];
+}
+
+static void bilinearRows8_c(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n)
+{
+    for (int i = 0; i < n; i++) {
+        const int tl = top[i];
+        const int tr = top[i+1];
+        const int bl = bot[i];
+        const int br = bot[i+1];
+        dstTop[i*2]   = (( 6*tl + 6*tr + 2*bl + 2*br + 8 ) >> 4);
+        dstBot[i*2]   = (( 2*tl + 2*tr + 6*bl + 6*br + 8 ) >> 4);
+        dstTop[i*2+1] = ((        3*tr +          br + 2 ) >> 2);
+        dstBot[i*2+1] = ((          tr +        3*br + 2 ) >> 2);
+    }
+}
+
+static void interstitialRows8_c(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n)
+{
+    for (int i = 0; i < n; i++) {
+        const int tl = top[i];
+        const int tr = top[i+1];
+        const int bl = bot[i];
+        const int br = bot[i+1];
+        dstTop[i*2]   = (9*tl + 3*tr + 3*bl +   br + 8) >> 4;
+        dstBot[i*2]   = (3*tl +   tr + 9*bl + 3*br + 8) >> 4;
+        dstTop[i*2+1] = (3*tl + 9*tr +   bl + 3*br + 8) >> 4;
+        dstBot[i*2+1] = (  tl + 3*tr + 3*bl + 9*br + 8) >> 4;
+    }
+}
+
+#if YUVIEW_X86_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// SSE4.1 - 8 chroma samples per iteration (16 for sample and hold)
+
+YUVIEW_TARGET_SSE41 static void holdRow8_sse41(const unsigned char *src, unsigned char *dst, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + 2*i),      _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128((__m128i*)(dst + 2*i + 16), _mm_unpackhi_epi8(v, v));
+    }
+    holdRow8_c(src + i, dst + 2*i, n - i);
+}
+
+YUVIEW_TARGET_SSE41 static void holdRow16_sse41(const unsigned short *src, unsigned short *dst, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + 2*i),     _mm_unpacklo_epi16(v, v));
+        _mm_storeu_si128((__m128i*)(dst + 2*i + 8), _mm_unpackhi_epi16(v, v));
+    }
+    holdRow16_c(src + i, dst + 2*i, n - i);
+}
+
+// store the interleaved 16 bit results a[0] b[0] a[1] b[1] ... as 16 bytes
+YUVIEW_TARGET_SSE41 static inline void storeInterleaved8_sse41(unsigned char *dst, __m128i a, __m128i b)
+{
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(_mm_packus_epi16(a, a), _mm_packus_epi16(b, b)));
+}
+
+YUVIEW_TARGET_SSE41 static void bilinearRows8_sse41(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n)
+{
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i three = _mm_set1_epi16(3);
+    const __m128i six = _mm_set1_epi16(6);
+    const __m128i eight = _mm_set1_epi16(8);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i tl = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(top + i)));
+        const __m128i tr = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(top + i + 1)));
+        const __m128i bl = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(bot + i)));
+        const __m128i br = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(bot + i + 1)));
+        const __m128i t = _mm_add_epi16(tl, tr);
+        const __m128i b = _mm_add_epi16(bl, br);
+
+        const __m128i top0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(t, six), _mm_mullo_epi16(b, two)), eight), 4);
+        const __m128i bot0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(t, two), _mm_mullo_epi16(b, six)), eight), 4);
+        const __m128i top1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(tr, three), br), two), 2);
+        const __m128i bot1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(br, three), tr), two), 2);
+
+        storeInterleaved8_sse41(dstTop + 2*i, top0, top1);
+        storeInterleaved8_sse41(dstBot + 2*i, bot0, bot1);
+    }
+    bilinearRows8_c(top + i, bot + i, dstTop + 2*i, dstBot + 2*i, n - i);
+}
+
+YUVIEW_TARGET_SSE41 static void interstitialRows8_sse41(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n)
+{
+    const __m128i three = _mm_set1_epi16(3);
+    const __m128i eight = _mm_set1_epi16(8);
+    const __m128i nine = _mm_set1_epi16(9);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i tl = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(top + i)));
+        const __m128i tr = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(top + i + 1)));
+        const __m128i bl = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(bot + i)));
+        const __m128i br = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(bot + i + 1)));
+        const __m128i diag0 = _mm_mullo_epi16(_mm_add_epi16(tr, bl), three);  // 3*tr + 3*bl
+        const __m128i diag1 = _mm_mullo_epi16(_mm_add_epi16(tl, br), three);  // 3*tl + 3*br
+
+        const __m128i top0 = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(tl, nine), diag0), _mm_add_epi16(br, eight));
+        const __m128i bot0 = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(bl, nine), diag1), _mm_add_epi16(tr, eight));
+        const __m128i top1 = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(tr, nine), diag1), _mm_add_epi16(bl, eight));
+        const __m128i bot1 = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(br, nine), diag0), _mm_add_epi16(tl, eight));
+
+        storeInterleaved8_sse41(dstTop + 2*i, _mm_srli_epi16(top0, 4), _mm_srli_epi16(top1, 4));
+        storeInterleaved8_sse41(dstBot + 2*i, _mm_srli_epi16(bot0, 4), _mm_srli_epi16(bot1, 4));
+    }
+    interstitialRows8_c(top + i, bot + i, dstTop + 2*i, dstBot + 2*i, n - i);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AVX2 - 16 chroma samples per iteration (32 for sample and hold)
+
+YUVIEW_TARGET_AVX2 static void holdRow8_avx2(const unsigned char *src, unsigned char *dst, int n)
+{
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        // unpack works per 128 bit lane, so reorder the lanes afterwards
+        const __m256i lo = _mm256_unpacklo_epi8(v, v);
+        const __m256i hi = _mm256_unpackhi_epi8(v, v);
+        _mm256_storeu_si256((__m256i*)(dst + 2*i),      _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + 2*i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    holdRow8_sse41(src + i, dst + 2*i, n - i);
+}
+
+YUVIEW_TARGET_AVX2 static void holdRow16_avx2(const unsigned short *src, unsigned short *dst, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        const __m256i lo = _mm256_unpacklo_epi16(v, v);
+        const __m256i hi = _mm256_unpackhi_epi16(v, v);
+        _mm256_storeu_si256((__m256i*)(dst + 2*i),      _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + 2*i + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    holdRow16_sse41(src + i, dst + 2*i, n - i);
+}
+
+// Packing per lane gives [a0..a7 a0..a7 | a8..a15 a8..a15], so the per lane unpack already yields
+// a0 b0 ... a7 b7 | a8 b8 ... a15 b15 in memory order.
+YUVIEW_TARGET_AVX2 static inline void storeInterleaved8_avx2(unsigned char *dst, __m256i a, __m256i b)
+{
+    _mm256_storeu_si256((__m256i*)dst, _mm256_unpacklo_epi8(_mm256_packus_epi16(a, a), _mm256_packus_epi16(b, b)));
+}
+
+YUVIEW_TARGET_AVX2 static inline __m256i load16x8_avx2(const unsigned char *src)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)src));
+}
+
+YUVIEW_TARGET_AVX2 static void bilinearRows8_avx2(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n)
+{
+    const __m256i two = _mm256_set1_epi16(2);
+    const __m256i three = _mm256_set1_epi16(3);
+    const __m256i six = _mm256_set1_epi16(6);
+    const __m256i eight = _mm256_set1_epi16(8);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i tl = load16x8_avx2(top + i);
+        const __m256i tr = load16x8_avx2(top + i + 1);
+        const __m256i bl = load16x8_avx2(bot + i);
+        const __m256i br = load16x8_avx2(bot + i + 1);
+        const __m256i t = _mm256_add_epi16(tl, tr);
+        const __m256i b = _mm256_add_epi16(bl, br);
+
+        const __m256i top0 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(t, six), _mm256_mullo_epi16(b, two)), eight), 4);
+        const __m256i bot0 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(t, two), _mm256_mullo_epi16(b, six)), eight), 4);
+        const __m256i top1 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(tr, three), br), two), 2);
+        const __m256i bot1 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(br, three), tr), two), 2);
+
+        storeInterleaved8_avx2(dstTop + 2*i, top0, top1);
+        storeInterleaved8_avx2(dstBot + 2*i, bot0, bot1);
+    }
+    bilinearRows8_sse41(top + i, bot + i, dstTop + 2*i, dstBot + 2*i, n - i);
+}
+
+YUVIEW_TARGET_AVX2 static void interstitialRows8_avx2(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n)
+{
+    const __m256i three = _mm256_set1_epi16(3);
+    const __m256i eight = _mm256_set1_epi16(8);
+    const __m256i nine = _mm256_set1_epi16(9);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i tl = load16x8_avx2(top + i);
+        const __m256i tr = load16x8_avx2(top + i + 1);
+        const __m256i bl = load16x8_avx2(bot + i);
+        const __m256i br = load16x8_avx2(bot + i + 1);
+        const __m256i diag0 = _mm256_mullo_epi16(_mm256_add_epi16(tr, bl), three);
+        const __m256i diag1 = _mm256_mullo_epi16(_mm256_add_epi16(tl, br), three);
+
+        const __m256i top0 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(tl, nine), diag0), _mm256_add_epi16(br, eight));
+        const __m256i bot0 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(bl, nine), diag1), _mm256_add_epi16(tr, eight));
+        const __m256i top1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(tr, nine), diag1), _mm256_add_epi16(bl, eight));
+        const __m256i bot1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(br, nine), diag0), _mm256_add_epi16(tl, eight));
+
+        storeInterleaved8_avx2(dstTop + 2*i, _mm256_srli_epi16(top0, 4), _mm256_srli_epi16(top1, 4));
+        storeInterleaved8_avx2(dstBot + 2*i, _mm256_srli_epi16(bot0, 4), _mm256_srli_epi16(bot1, 4));
+    }
+    interstitialRows8_sse41(top + i, bot + i, dstTop + 2*i, dstBot + 2*i, n - i);
+}
+
+#endif // YUVIEW_X86_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// dispatch
+
+static const ChromaUpsamplingKernels g_kernelsScalar = { holdRow8_c, holdRow16_c, bilinearRows8_c, interstitialRows8_c, "scalar" };
+#if YUVIEW_X86_SIMD
+static const ChromaUpsamplingKernels g_kernelsSSE41 = { holdRow8_sse41, holdRow16_sse41, bilinearRows8_sse41, interstitialRows8_sse41, "SSE4.1" };
+static const ChromaUpsamplingKernels g_kernelsAVX2 = { holdRow8_avx2, holdRow16_avx2, bilinearRows8_avx2, interstitialRows8_avx2, "AVX2" };
+#endif
+
+static const ChromaUpsamplingKernels &selectKernels()
+{
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsAVX2())
+        return g_kernelsAVX2;
+    if (cpuSupportsSSE41())
+        return g_kernelsSSE41;
+#endif
+    return g_kernelsScalar;
+}
+
+const ChromaUpsamplingKernels &chromaUpsamplingKernels()
+{
+    static const ChromaUpsamplingKernels &kernels = selectKernels();
+    return kernels;
+}
+
+const ChromaUpsamplingKernels &chromaUpsamplingKernelsScalar()
+{
+    return g_kernelsScalar;
+}
+
+const ChromaUpsamplingKernels *chromaUpsamplingKernelsSupported(int i)
+{
+    const ChromaUpsamplingKernels *supported[3];
+    int count = 0;
+    supported[count++] = &g_kernelsScalar;
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsSSE41())
+        supported[count++] = &g_kernelsSSE41;
+    if (cpuSupportsAVX2())
+        supported[count++] = &g_kernelsAVX2;
+#endif
+    return (i >= 0 && i < count) ? supported[i] : NULL;
+}
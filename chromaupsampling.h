@@ -0,0 +1,48 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHROMAUPSAMPLING_H
+#define CHROMAUPSAMPLING_H
+
+// Row kernels for horizontal and vertical 2:1 chroma upsampling (4:2:0 -> 4:4:4).
+// All implementations of a kernel produce bit identical results. The scalar versions are the reference.
+struct ChromaUpsamplingKernels
+{
+    // sample and hold: dst[2*i] = dst[2*i+1] = src[i] for i < n
+    void (*holdRow8)(const unsigned char *src, unsigned char *dst, int n);
+    void (*holdRow16)(const unsigned short *src, unsigned short *dst, int n);
+
+    // Interior of two output lines between the chroma lines top and bot. For i < n the kernels
+    // write dstTop[2*i], dstTop[2*i+1], dstBot[2*i] and dstBot[2*i+1] from top[i], top[i+1], bot[i] and bot[i+1].
+    void (*bilinearRows8)(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n);
+    void (*interstitialRows8)(const unsigned char *top, const unsigned char *bot, unsigned char *dstTop, unsigned char *dstBot, int n);
+
+    const char *name;
+};
+
+// kernels for the best instruction set supported by this CPU (selected once at first call)
+const ChromaUpsamplingKernels &chromaUpsamplingKernels();
+
+// scalar reference kernels
+const ChromaUpsamplingKernels &chromaUpsamplingKernelsScalar();
+
+// The kernels of every instruction set supported by this CPU, starting with the scalar reference (for tests).
+// Returns NULL if i is not smaller than the number of supported instruction sets.
+const ChromaUpsamplingKernels *chromaUpsamplingKernelsSupported(int i);
+
+#endif // CHROMAUPSAMPLING_H
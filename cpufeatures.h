@@ -0,0 +1,94 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Runtime detection of SIMD instruction sets. The SIMD kernels are compiled with per function
+// target attributes (GCC/Clang) so that the rest of the program does not require these instructions.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define YUVIEW_X86_SIMD 1
+#endif
+
+#if YUVIEW_X86_SIMD
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define YUVIEW_TARGET_SSE41
+#define YUVIEW_TARGET_AVX2
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define YUVIEW_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define YUVIEW_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+inline void cpuidQuery(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int tmp[4];
+    __cpuidex(tmp, leaf, subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (unsigned int)tmp[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+inline bool cpuSupportsSSE41()
+{
+    unsigned int regs[4];
+    cpuidQuery(1, 0, regs);
+    return (regs[2] & (1u << 19)) != 0;
+}
+
+inline bool cpuSupportsAVX2()
+{
+    unsigned int regs[4];
+    cpuidQuery(0, 0, regs);
+    if (regs[0] < 7)
+        return false;
+
+    // the OS has to save the YMM registers (OSXSAVE and XCR0 bits 1 and 2)
+    cpuidQuery(1, 0, regs);
+    if ((regs[2] & (1u << 27)) == 0 || (regs[2] & (1u << 28)) == 0)
+        return false;
+#if defined(_MSC_VER)
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcrLow, xcrHigh;
+    __asm__ ("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)xcrHigh << 32) | xcrLow;
+#endif
+    if ((xcr0 & 6) != 6)
+        return false;
+
+    cpuidQuery(7, 0, regs);
+    return (regs[1] & (1u << 5)) != 0;
+}
+
+#else
+
+inline bool cpuSupportsSSE41() { return false; }
+inline bool cpuSupportsAVX2() { return false; }
+
+#endif // YUVIEW_X86_SIMD
+
+#endif // CPUFEATURES_H
@@ -23,24 +23,13 @@
 #define MIN(a,b) ((a)<(b)?(a):(b))
 #define MAX(a,b) ((a)>(b)?(a):(b))
 
-#if __STDC__ != 1
-#    define restrict __restrict /* use implementation __ format */
-#else
-#    ifndef __STDC_VERSION__
-#        define restrict __restrict /* use implementation __ format */
-#    else
-#        if __STDC_VERSION__ < 199901L
-#            define restrict __restrict /* use implementation __ format */
-#        else
-#            /* all ok */
-#        endif
-#    endif
-#endif
-
 DifferenceObject::DifferenceObject(QObject* parent) : FrameObject("", parent)
 {
     p_frameObjects[0] = NULL;
     p_frameObjects[1] = NULL;
+
+    p_differenceMode = SignedDifferenceMode;
+    p_amplification = DIFFERENCE_DEFAULT_AMPLIFICATION;
 }
 
 DifferenceObject::~DifferenceObject()
@@ -78,6 +67,96 @@ void DifferenceObject::setFrameObjects(FrameObject* firstObject, FrameObject* se
     emit informationChanged();
 }
 
+void DifferenceObject::setDifferenceMode(DifferenceMode mode, int amplification)
+{
+    p_differenceMode = mode;
+    p_amplification = MAX(1, MIN(YUV_DIFFERENCE_MAX_SCALE, amplification));
+
+    emit informationChanged();
+}
+
+YUVDifferenceParameters DifferenceObject::differenceParameters(bool chroma, int bps)
+{
+    const int diffZero = 128<<(bps-8);
+
+    YUVDifferenceParameters params;
+    params.offset = diffZero;
+    params.scale = 1;
+    params.absolute = false;
+
+    if( p_differenceMode == AbsoluteDifferenceMode )
+    {
+        if( chroma )
+        {
+            // neutral chroma, the absolute difference is shown as gray levels
+            params.scale = 0;
+        }
+        else
+        {
+            params.offset = 0;
+            params.absolute = true;
+        }
+    }
+    else if( p_differenceMode == AmplifiedDifferenceMode )
+    {
+        params.scale = p_amplification;
+    }
+
+    return params;
+}
+
+// Difference of two sample arrays. The arrays are split into chunks so that the SIMD kernels run on all threads.
+static void subtractSamples(const char *srcA, const char *srcB, char *dst, int numSamples, int bps, YUVDifferenceParameters params)
+{
+    const YUVDifferenceKernels *kernels = &yuvDifferenceKernels();
+    int chunkSize = 16384;
+    int numChunks = (numSamples + chunkSize - 1) / chunkSize;
+
+    int chunk;
+#pragma omp parallel for default(none) private(chunk) shared(srcA,srcB,dst,numSamples,bps,params,kernels,chunkSize,numChunks)
+    for (chunk = 0; chunk < numChunks; ++chunk) {
+        const int first = chunk * chunkSize;
+        const int n = MIN(chunkSize, numSamples - first);
+        if (bps == 8)
+            kernels->difference8((const unsigned char*)srcA + first, (const unsigned char*)srcB + first, (unsigned char*)dst + first, n, params);
+        else
+            kernels->difference16((const unsigned short*)srcA + first, (const unsigned short*)srcB + first, (unsigned short*)dst + first, n, params, bps);
+    }
+}
+
+bool DifferenceObject::useNativeDifference(int width, int height)
+{
+    YUVFile *file0 = p_frameObjects[0]->getYUVFile();
+    YUVFile *file1 = p_frameObjects[1]->getYUVFile();
+
+    // both frames must have the same size and layout
+    if( file0->pixelFormat() != file1->pixelFormat() )
+        return false;
+    if( p_frameObjects[0]->width() != width || p_frameObjects[0]->height() != height || p_frameObjects[1]->width() != width || p_frameObjects[1]->height() != height )
+        return false;
+    if( !file0->canUpsampleChromaBands(width, height) )
+        return false;
+
+    // YUV math is only implemented for 8 bit samples in the fused conversion
+    return YUVFile::bitsPerSample(file0->pixelFormat()) == 8 || !doApplyYUVMath();
+}
+
+void DifferenceObject::subtractFrame420(const char *srcFrame0, const char *srcFrame1, QByteArray *outBuffer, int width, int height, int bps)
+{
+    const int bytesPerSample = (bps > 8) ? 2 : 1;
+    const int lumaLength = width*height;
+    const int chromaLength = 2*(width/2)*(height/2);
+
+    if( outBuffer->size() != (lumaLength + chromaLength)*bytesPerSample )
+        outBuffer->resize((lumaLength + chromaLength)*bytesPerSample);
+    char *dst = outBuffer->data();
+
+    // the U and V planes follow each other and are subtracted in one pass
+    subtractSamples(srcFrame0, srcFrame1, dst, lumaLength, bps, differenceParameters(false, bps));
+    const int chromaStart = lumaLength*bytesPerSample;
+    subtractSamples(srcFrame0 + chromaStart, srcFrame1 + chromaStart, dst + chromaStart, chromaLength, bps, differenceParameters(true, bps));
+}
+
 void DifferenceObject::loadImage(int frameIdx)
 {
     if (frameIdx==INT_INVALID || frameIdx >= numFrames())
@@ -106,6 +185,24 @@ void DifferenceObject::loadImage(int frameIdx)
     const int width = MIN(p_frameObjects[0]->width(), p_frameObjects[1]->width());
     const int height = MIN(p_frameObjects[0]->height(), p_frameObjects[1]->height());
 
+    if( useNativeDifference(width, height) )
+    {
+        // the buffers only hold the raw frames if the files are not mapped
+        QByteArray sourceFrames[2];
+        const char *srcFrame0 = p_frameObjects[0]->getYUVFile()->getRawFrame(&sourceFrames[0], frameIdx, width, height);
+        const char *srcFrame1 = p_frameObjects[1]->getYUVFile()->getRawFrame(&sourceFrames[1], frameIdx, width, height);
+
+        const int bps = YUVFile::bitsPerSample(p_frameObjects[0]->pixelFormat());
+        subtractFrame420(srcFrame0, srcFrame1, &p_tmpBufferYUV444, width, height, bps);
+
+        // chroma upsampling of the difference, YUV math and conversion to RGB in one pass
+        QImage tmpImage = convertFrameFused(p_frameObjects[0]->getYUVFile(), p_tmpBufferYUV444.constData(), width, height, &p_PixmapConversionBuffer, conversionParameters());
+        p_displayImage.convertFromImage(tmpImage);
+
+        p_lastIdx = frameIdx;
+        return;
+    }
+
     // load both YUV444 buffers
     QByteArray yuv444Arrays[2];
     p_frameObjects[0]->getYUVFile()->getOneFrame(&yuv444Arrays[0], frameIdx, width, height);
@@ -144,56 +241,17 @@ void DifferenceObject::subtractYUV444(QByteArray *srcBuffer0, QByteArray *srcBuf
     const int componentLength = srcBufferLength0/3;
 
     const int bps = YUVFile::bitsPerSample(srcPixelFormat);
-
-    const int diffZero = 128<<(bps-8);
-
-    // compute difference in YUV444 domain
-    if (bps == 8)
-    {
-        const unsigned char * restrict srcY[2] = {(unsigned char*)srcBuffer0->data(), (unsigned char*)srcBuffer1->data()};
-        const unsigned char * restrict srcU[2] = {srcY[0] + componentLength, srcY[1] + componentLength};
-        const unsigned char * restrict srcV[2] = {srcU[0] + componentLength, srcU[1] + componentLength};
-        unsigned char * restrict dstY = (unsigned char*)outBuffer->data();
-        unsigned char * restrict dstU = dstY + componentLength;
-        unsigned char * restrict dstV = dstU + componentLength;
-
-        int i;
-#pragma omp parallel for default(none) private(i) shared(srcY,srcU,srcV,dstY,dstU,dstV) // num_threads(2)
-        for (i = 0; i < componentLength; ++i) {
-            const int Y_diff = diffZero + (int)srcY[0][i] - (int)srcY[1][i];
-            const int U_diff = diffZero + (int)srcU[0][i] - (int)srcU[1][i];
-            const int V_diff = diffZero + (int)srcV[0][i] - (int)srcV[1][i];
-
-            dstY[i] = Y_diff;
-            dstU[i] = U_diff;
-            dstV[i] = V_diff;
-        }
-    }
-    else if (bps > 8 && bps <= 16)
-    {
-        const unsigned short *srcY[2] = {(unsigned short*)srcBuffer0->data(), (unsigned short*)srcBuffer1->data()};
-        const unsigned short *srcU[2] = {srcY[0] + componentLength, srcY[1] + componentLength};
-        const unsigned short *srcV[2] = {srcU[0] + componentLength, srcU[1] + componentLength};
-        unsigned short * restrict dstY = (unsigned short*)outBuffer->data();
-        unsigned short * restrict dstU = dstY + componentLength;
-        unsigned short * restrict dstV = dstU + componentLength;
-
-        int i;
-#pragma omp parallel for default(none) private(i) shared(srcY,srcU,srcV,dstY,dstU,dstV) // num_threads(2)
-        for (i = 0; i < componentLength; ++i) {
-            const int Y_diff = diffZero + (int)srcY[0][i] - (int)srcY[1][i];
-            const int U_diff = diffZero + (int)srcU[0][i] - (int)srcU[1][i];
-            const int V_diff = diffZero + (int)srcV[0][i] - (int)srcV[1][i];
-
-            dstY[i] = Y_diff;
-            dstU[i] = U_diff;
-            dstV[i] = V_diff;
-        }
-    }
-    else
+    if( bps < 8 || bps > 16 )
     {
         printf("bitdepth %i not supported\n", bps);
+        return;
     }
+
+    // compute difference in YUV444 domain
+    const int bytesPerSample = (bps > 8) ? 2 : 1;
+    const int numSamples = componentLength/bytesPerSample;
+    subtractSamples(srcBuffer0->constData(), srcBuffer1->constData(), outBuffer->data(), numSamples, bps, differenceParameters(false, bps));
+    subtractSamples(srcBuffer0->constData() + componentLength, srcBuffer1->constData() + componentLength, outBuffer->data() + componentLength, 2*numSamples, bps, differenceParameters(true, bps));
 }
 
 ValuePairList DifferenceObject::getValuesAt(int x, int y)
@@ -203,16 +261,15 @@ ValuePairList DifferenceObject::getValuesAt(int x, int y)
     if( (x < 0) || (y < 0) || (x >= p_width) || (y >= p_height) )
         return ValuePairList();
 
-    // load both YUV444 buffers
-    QByteArray yuv444Arrays[2];
-    p_frameObjects[0]->getYUVFile()->getOneFrame(&yuv444Arrays[0], p_lastIdx, p_width, p_height);
-    p_frameObjects[1]->getYUVFile()->getOneFrame(&yuv444Arrays[1], p_lastIdx, p_width, p_height);
-
-    const unsigned int planeLength = p_width*p_height;
+    // read the samples of both files from the mapped or cached source frames
+    int values0[3], values1[3];
+    if( !p_frameObjects[0]->getYUVFile()->getSampleValues(p_lastIdx, p_width, p_height, x, y, &values0[0], &values0[1], &values0[2]) ||
+        !p_frameObjects[1]->getYUVFile()->getSampleValues(p_lastIdx, p_width, p_height, x, y, &values1[0], &values1[1], &values1[2]) )
+        return ValuePairList();
 
-    const int valY = yuv444Arrays[0].data()[y*p_width+x] - yuv444Arrays[1].data()[y*p_width+x];
-    const int valU = yuv444Arrays[0].data()[planeLength+(y*p_width+x)] - yuv444Arrays[1].data()[planeLength+(y*p_width+x)];
-    const int valV = yuv444Arrays[0].data()[2*planeLength+(y*p_width+x)] - yuv444Arrays[1].data()[2*planeLength+(y*p_width+x)];
+    const int valY = values0[0] - values1[0];
+    const int valU = values0[1] - values1[1];
+    const int valV = values0[2] - values1[2];
 
     ValuePairList values;
 
@@ -21,6 +21,17 @@
 
 #include <QObject>
 #include "frameobject.h"
+#include "yuvdifference.h"
+
+// how the difference of two samples is displayed
+enum DifferenceMode
+{
+    SignedDifferenceMode = 0,   // 128 + (a-b), no difference is gray
+    AbsoluteDifferenceMode,     // |a-b| of the luma as gray levels, no difference is black
+    AmplifiedDifferenceMode     // 128 + N*(a-b), saturated
+};
+
+#define DIFFERENCE_DEFAULT_AMPLIFICATION 4
 
 class DifferenceObject : public FrameObject
 {
@@ -34,12 +45,27 @@ public:
     ValuePairList getValuesAt(int x, int y);
 
     void setInternalScaleFactor(int) {}    // no internal scaling
-    void refreshDisplayImage()  { p_frameObjects[0]->clearCurrentCache();p_frameObjects[1]->clearCurrentCache();loadImage(p_lastIdx);}
+    void refreshDisplayImage()  { loadImage(p_lastIdx); }
     int numFrames();
 
+    // the amplification factor N is only used in AmplifiedDifferenceMode, [1, YUV_DIFFERENCE_MAX_SCALE]
+    void setDifferenceMode(DifferenceMode mode, int amplification = DIFFERENCE_DEFAULT_AMPLIFICATION);
+    DifferenceMode differenceMode() { return p_differenceMode; }
+    int amplification() { return p_amplification; }
+
 private:
     FrameObject* p_frameObjects[2];
 
+    DifferenceMode p_differenceMode;
+    int p_amplification;
+
+    // mapping of the differences of the luma or chroma samples to output samples for the current mode
+    YUVDifferenceParameters differenceParameters(bool chroma, int bps);
+
+    // 4:2:0 frames of the same format are subtracted without upsampling, the result is converted to RGB row by row
+    bool useNativeDifference(int width, int height);
+    void subtractFrame420(const char *srcFrame0, const char *srcFrame1, QByteArray *outBuffer, int width, int height, int bps);
+
     void subtractYUV444(QByteArray *srcBuffer0, QByteArray *srcBuffer1, QByteArray *outBuffer, YUVCPixelFormatType srcPixelFormat);
 };
 
@@ -461,7 +461,7 @@ void DisplaySplitWidget::dropEvent(QDropEvent *event)
                 QString ext = fi.suffix();
                 ext = ext.toLower();
 
-                if( fi.isDir() || ext == "yuv" || ext == "yuvplaylist" || ext == "csv" )
+                if( fi.isDir() || ext == "yuv" || ext == "yuvplaylist" || ext == "csv" || ext == "yuvstats" )
                     fileList.append(fileName);
             }
 
@@ -91,6 +91,15 @@ void DisplayWidget::drawFrame()
 {
     //draw Frame
     QPainter painter(this);
+
+    // statistics are scaled when they are drawn
+    StatisticsObject *statsObject = dynamic_cast<StatisticsObject*>(p_displayObject);
+    if (statsObject)
+    {
+        statsObject->drawOverlay(&painter, p_displayRect, rect());
+        return;
+    }
+
     QPixmap image = p_displayObject->displayImage();
     painter.drawPixmap(p_displayRect, image, image.rect());
 }
@@ -125,8 +134,7 @@ void DisplayWidget::drawStatisticsOverlay()
 
     //draw Frame
     QPainter painter(this);
-    QPixmap overlayImage = p_overlayStatisticsObject->displayImage();
-    painter.drawPixmap(p_displayRect, overlayImage, overlayImage.rect());
+    p_overlayStatisticsObject->drawOverlay(&painter, p_displayRect, rect());
 }
 
 void DisplayWidget::drawZoomFactor()
@@ -244,23 +252,27 @@ void DisplayWidget::drawZoomBox()
     painter.translate(width()-targetSize-margin, height()-targetSize-margin);
 
     // fill zoomed image into rect
-    QPixmap image = p_displayObject->displayImage();
-    int internalScaleFactor = p_displayObject->internalScaleFactor();
-    QRect srcRect = QRect((srcPoint.x()-(srcSize>>1))*internalScaleFactor, (srcPoint.y()-(srcSize>>1))*internalScaleFactor, srcSize*internalScaleFactor, srcSize*internalScaleFactor);
     QRect targetRect = QRect(0, 0, targetSize, targetSize);
+    // the whole frame at the zoom of the zoom box (for statistics, which are scaled when drawn)
+    QRect zoomedFrameRect = QRect(-(srcPoint.x()-(srcSize>>1))*zoomBoxFactor, -(srcPoint.y()-(srcSize>>1))*zoomBoxFactor, p_displayObject->width()*zoomBoxFactor, p_displayObject->height()*zoomBoxFactor);
 
     painter.fillRect(targetRect, bgColor);
-    painter.drawPixmap(targetRect, image, srcRect);
+    StatisticsObject *statsObject = dynamic_cast<StatisticsObject*>(p_displayObject);
+    if (statsObject)
+        statsObject->drawOverlay(&painter, zoomedFrameRect, targetRect);
+    else
+    {
+        QPixmap image = p_displayObject->displayImage();
+        int internalScaleFactor = p_displayObject->internalScaleFactor();
+        QRect srcRect = QRect((srcPoint.x()-(srcSize>>1))*internalScaleFactor, (srcPoint.y()-(srcSize>>1))*internalScaleFactor, srcSize*internalScaleFactor, srcSize*internalScaleFactor);
+        painter.drawPixmap(targetRect, image, srcRect);
+    }
 
     // if we have an overlayed statistics image, draw it also and get pixel value from there...
     if(p_overlayStatisticsObject)
     {
-        QPixmap overlayImage = p_overlayStatisticsObject->displayImage();
-
-        int internalScaleFactorOverlay = p_overlayStatisticsObject->internalScaleFactor();
-        QRect srcRectOverlay = QRect((srcPoint.x()-(srcSize>>1))*internalScaleFactorOverlay, (srcPoint.y()-(srcSize>>1))*internalScaleFactorOverlay, srcSize*internalScaleFactorOverlay, srcSize*internalScaleFactorOverlay);
         // draw overlay
-        painter.drawPixmap(targetRect, overlayImage, srcRectOverlay);
+        p_overlayStatisticsObject->drawOverlay(&painter, zoomedFrameRect, targetRect);
 
         // use overlay raw value
         valuesAtPos = p_overlayStatisticsObject->getValuesAt( srcPoint.x(), srcPoint.y() );
@@ -20,6 +20,8 @@
 
 #include "yuvfile.h"
 #include <QPainter>
+#include <QtConcurrent>
+#include <QThread>
 #include "assert.h"
 
 #define MIN(a,b) ((a)<(b)?(a):(b))
@@ -39,8 +41,8 @@
 #    endif
 #endif
 
-static unsigned char clp_buf[384+256+384];
-static unsigned char *clip_buf = clp_buf+384;
+// number of pixels converted per kernel call (and OpenMP work item)
+#define RGB_CONVERSION_CHUNK 16384
 
 enum {
    YUVMathDefaultColors,
@@ -50,6 +52,11 @@ enum {
 };
 
 QCache<CacheIdx, QPixmap> FrameObject::frameCache;
+int FrameObject::frameCacheEvictions = 0;
+int FrameObject::prefetchDepth = 0;
+
+// maximum number of frames between reading and RGB conversion in the prefetch pipeline
+#define PREFETCH_FRAMES_IN_FLIGHT 4
 QStringList duplicateList;
 FrameObject::FrameObject(const QString& srcFileName, QObject* parent) : DisplayObject(parent)
 {
@@ -72,14 +79,11 @@ FrameObject::FrameObject(const QString& srcFileName, QObject* parent) : DisplayO
 
     p_colorConversionMode = YUVC709ColorConversionType;
 
-    // initialize clipping table
-
-    memset(clp_buf, 0, 384);
-    int i;
-    for (i = 0; i < 256; i++) {
-        clp_buf[384+i] = i;
-    }
-    memset(clp_buf+384+256, 255, 384);
+    p_cancelPrefetch = false;
+    p_prefetchGeneration = 0;
+    p_prefetchHits = 0;
+    p_prefetchMisses = 0;
+    p_prefetchConvertPool.setMaxThreadCount(MAX(1, MIN(PREFETCH_FRAMES_IN_FLIGHT, QThread::idealThreadCount())));
 
     QFileInfo checkFile(srcFileName);
     if( checkFile.exists() && checkFile.isFile() )
@@ -102,32 +106,48 @@ FrameObject::FrameObject(const QString& srcFileName, QObject* parent) : DisplayO
     // listen to changes emitted from frame object and propagate to GUI
     QObject::connect(this, SIGNAL(frameInformationChanged()), this, SLOT(propagateParameterChanges()));
     QObject::connect(this, SIGNAL(frameInformationChanged()), this, SLOT(refreshDisplayImage()));
+
+    // frames converted by the prefetch thread are put into the cache from the GUI thread
+    QObject::connect(this, SIGNAL(prefetchedFrameReady(int,int,QByteArray,QImage)), this, SLOT(insertPrefetchedFrame(int,int,QByteArray,QImage)), Qt::QueuedConnection);
 }
 
 FrameObject::~FrameObject()
 {
+    stopPrefetching();
+
     if(p_srcFile != NULL)
     {
-        clearCurrentCache();
         duplicateList.removeOne(p_srcFile->fileName());
+
+        // free the memory of the frames of this file, unless it is still open in another item
+        if (!duplicateList.contains(p_srcFile->fileName()))
+        {
+            foreach(const CacheIdx &cIdx, frameCache.keys())
+            {
+                if (cIdx.fileName == p_srcFile->fileName())
+                    frameCache.remove(cIdx);
+            }
+        }
         delete p_srcFile;
     }
 }
 
-void FrameObject::clearCurrentCache()
+CacheIdx FrameObject::cacheIdx(int frameIdx)
 {
-    if (p_srcFile!=NULL)
-    {
-    if (duplicateList.count(p_srcFile->fileName())<=1)
-    {
-        for (int frameIdx=p_startFrame;frameIdx<=p_endFrame;frameIdx++)
-        {
-         CacheIdx cIdx(p_srcFile->fileName(), frameIdx);
-         if (frameCache.contains(cIdx))
-                 frameCache.remove(cIdx);
-        }
-    }
-    }
+    return CacheIdx(p_srcFile->fileName(), frameIdx, renderParameters());
+}
+
+QByteArray FrameObject::renderParameters()
+{
+    const bool yuvMath = doApplyYUVMath();
+    const int params[] = {
+        p_width, p_height,
+        p_srcFile->pixelFormat(), p_srcFile->interpolationMode(), p_colorConversionMode,
+        yuvMath, yuvMath ? p_lumaScale : 0, yuvMath ? p_lumaOffset : 0, yuvMath ? p_chromaOffset : 0,
+        yuvMath ? p_chromaUScale : 0, yuvMath ? p_chromaVScale : 0, yuvMath ? p_lumaInvert : 0, yuvMath ? p_chromaInvert : 0
+    };
+
+    return QByteArray((const char*)params, sizeof(params));
 }
 
 void FrameObject::loadImage(int frameIdx)
@@ -144,47 +164,220 @@ void FrameObject::loadImage(int frameIdx)
     if( p_srcFile == NULL )
         return;
 
-    // check if we have this frame index in our cache already
-    CacheIdx cIdx(p_srcFile->fileName(), frameIdx);
+    // check if we have this frame index with the current parameters in our cache already
+    CacheIdx cIdx = cacheIdx(frameIdx);
     QPixmap* cachedFrame = frameCache.object(cIdx);
     if(cachedFrame == NULL)    // load the corresponding frame from yuv file into the frame buffer
     {
+        p_prefetchMisses++;
+
         // add new QPixmap to cache and use its data buffer
         cachedFrame = new QPixmap();
 
-        if( p_srcFile->pixelFormat() != YUVC_24RGBPixelFormat )
-        {
-            // read YUV444 frame from file - 16 bit LE words
-            p_srcFile->getOneFrame(&p_tmpBufferYUV444, frameIdx, p_width, p_height);
+        QImage tmpImage = renderFrame(frameIdx, p_width, p_height, &p_tmpBufferYUV444, &p_PixmapConversionBuffer);
 
-            // if requested, do some YUV math
-            if( doApplyYUVMath() )
-                applyYUVMath(&p_tmpBufferYUV444, p_width, p_height, p_srcFile->pixelFormat());
+        // Convert the image in p_PixmapConversionBuffer to a QPixmap
+        cachedFrame->convertFromImage(tmpImage);
 
-            // convert from YUV444 (planar) - 16 bit words to RGB888 (interleaved) color format (in place)
-            convertYUV2RGB(&p_tmpBufferYUV444, &p_PixmapConversionBuffer, YUVC_24RGBPixelFormat);
-        }
+        // the cache deletes frames which are larger than the whole cache, so copy the frame before
+        p_displayImage = *cachedFrame;
+        insertIntoFrameCache(cIdx, cachedFrame);
+    }
+    else
+    {
+        p_prefetchHits++;
+
+        // update our QImage with frame buffer
+        p_displayImage = *cachedFrame;
+    }
+
+    p_lastIdx = frameIdx;
+}
+
+int FrameObject::frameCacheCost(const QPixmap &pixmap)
+{
+    // the real memory footprint of the pixmap (usually 32 bit per pixel, independent of the source format)
+    qint64 sizeInBytes = (qint64)pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+
+    // QCache costs are int, so account in KiB (rounded up, so even tiny frames are not for free)
+    return (int)((sizeInBytes + 1023) >> 10);
+}
+
+void FrameObject::insertIntoFrameCache(const CacheIdx &cIdx, QPixmap *pixmap)
+{
+    const int countBefore = frameCache.count() + (frameCache.contains(cIdx) ? 0 : 1);
+
+    // takes ownership of pixmap, the least recently used frames are evicted if the cache is full
+    frameCache.insert(cIdx, pixmap, frameCacheCost(*pixmap));
+
+    frameCacheEvictions += countBefore - frameCache.count();
+}
+
+void FrameObject::setFrameCacheSizeInMB(unsigned int sizeInMB)
+{
+    const int countBefore = frameCache.count();
+    frameCache.setMaxCost(sizeInMB << 10);
+    frameCacheEvictions += countBefore - frameCache.count();
+}
+
+QString FrameObject::frameCacheStatus()
+{
+    return QString("Frame cache: %1 of %2 MB, %3 frames, %4 evictions").arg(frameCache.totalCost() / 1024.0, 0, 'f', 1).arg(frameCache.maxCost() >> 10).arg(frameCache.count()).arg(frameCacheEvictions);
+}
+
+QImage FrameObject::renderFrame(int frameIdx, int width, int height, QByteArray *yuv444Buffer, QByteArray *rgbBuffer)
+{
+    if( useFusedConversion(width, height) )
+    {
+        // 4:2:0 frames are converted row by row, the YUV444 buffer only holds the raw frame if the file is not mapped
+        const char *srcFrame = p_srcFile->getRawFrame(yuv444Buffer, frameIdx, width, height);
+        return convertFrameFused(p_srcFile, srcFrame, width, height, rgbBuffer, conversionParameters());
+    }
+
+    // read YUV444 (or RGB24) frame from file - 16 bit LE words
+    p_srcFile->getOneFrame(yuv444Buffer, frameIdx, width, height);
+
+    return convertFrame(width, height, yuv444Buffer, rgbBuffer, conversionParameters());
+}
+
+QImage FrameObject::convertFrame(int width, int height, QByteArray *yuv444Buffer, QByteArray *rgbBuffer, const FrameConversionParameters &params)
+{
+    if( p_srcFile->pixelFormat() != YUVC_24RGBPixelFormat )
+    {
+        // if requested, do some YUV math
+        if( params.applyYUVMath )
+            applyYUVMath(yuv444Buffer, width, height, p_srcFile->pixelFormat(), params.math);
+
+        // convert from YUV444 (planar) - 16 bit words to RGB888 (interleaved) color format (in place)
+        convertYUV2RGB(yuv444Buffer, rgbBuffer, YUVC_24RGBPixelFormat, params.colorConversionMode);
+    }
+    else
+    {
+        // RGB24 frames are already in display format
+        rgbBuffer->swap(*yuv444Buffer);
+    }
+
+    return QImage((unsigned char*)rgbBuffer->data(), width, height, QImage::Format_RGB888);
+}
+
+void FrameObject::prefetchFrames(int frameIdx)
+{
+    if( p_srcFile == NULL || prefetchDepth <= 0 || p_prefetchFuture.isRunning() )
+        return;
+
+    // collect the frames ahead of the play head which are not cached yet
+    const int step = MAX(1, p_sampling);
+    const int lastFrame = MIN(p_endFrame, numFrames()-1);
+    QList<int> frameList;
+    for (int i=1; i<=prefetchDepth; i++)
+    {
+        int nextIdx = frameIdx + i*step;
+        if( nextIdx < p_startFrame || nextIdx > lastFrame )
+            break;
+
+        if( !frameCache.contains(cacheIdx(nextIdx)) )
+            frameList.append(nextIdx);
+    }
+
+    if( frameList.isEmpty() )
+        return;
+
+    // 4:2:0 frames are only read by the worker (nothing to do for mapped files) and upsampled during the conversion
+    PrefetchContext context;
+    context.width = p_width;
+    context.height = p_height;
+    context.fused = useFusedConversion(p_width, p_height);
+    context.params = conversionParameters();
+    context.renderParams = renderParameters();
+    context.freeSlots = NULL;
+
+    p_cancelPrefetch = false;
+    p_prefetchFuture = QtConcurrent::run(this, &FrameObject::prefetchWorker, frameList, context);
+}
+
+void FrameObject::stopPrefetching()
+{
+    if (p_prefetchFuture.isRunning())
+    {
+        // signal to background thread that we want to cancel the processing
+        p_cancelPrefetch = true;
+        p_prefetchFuture.waitForFinished();
+    }
+
+    // frames which are still queued for insertion are outdated now
+    p_prefetchGeneration++;
+}
+
+void FrameObject::prefetchWorker(QList<int> frameList, PrefetchContext context)
+{
+    // This thread reads and upsamples the frames while the conversion of previously read frames
+    // to RGB runs on p_prefetchConvertPool. The semaphore limits the number of frames in flight.
+    QSemaphore freeSlots(PREFETCH_FRAMES_IN_FLIGHT);
+    QList< QFuture<void> > conversions;
+    context.freeSlots = &freeSlots;
+
+    foreach(int frameIdx, frameList)
+    {
+        if( p_cancelPrefetch )
+            break;
+
+        freeSlots.acquire();
+
+        // every frame in flight needs its own buffer, the members are reserved for the GUI thread
+        QByteArray frameBuffer;
+        if( context.fused )
+            p_srcFile->getRawFrame(&frameBuffer, frameIdx, context.width, context.height);
         else
+            p_srcFile->getOneFrame(&frameBuffer, frameIdx, context.width, context.height);
+
+        conversions.append( QtConcurrent::run(&p_prefetchConvertPool, this, &FrameObject::prefetchConvert, frameIdx, frameBuffer, (const PrefetchContext*)&context) );
+    }
+
+    // context and freeSlots live on our stack, so wait for all conversions
+    foreach(QFuture<void> conversion, conversions)
+        conversion.waitForFinished();
+}
+
+void FrameObject::prefetchConvert(int frameIdx, QByteArray frameBuffer, const PrefetchContext *context)
+{
+    const int width = context->width;
+    const int height = context->height;
+
+    if( !p_cancelPrefetch )
+    {
+        // the image has to be detached from rgbBuffer, which only lives in this function
+        QByteArray rgbBuffer;
+        QImage image;
+        if( context->fused )
         {
-            // read RGB24 frame from file
-            p_srcFile->getOneFrame(&p_PixmapConversionBuffer, frameIdx, p_width, p_height);
+            // an empty buffer means that the frame is mapped
+            const char *srcFrame = frameBuffer.isEmpty() ? p_srcFile->getRawFrame(&frameBuffer, frameIdx, width, height) : frameBuffer.constData();
+            image = convertFrameFused(p_srcFile, srcFrame, width, height, &rgbBuffer, context->params).copy();
         }
+        else
+            image = convertFrame(width, height, &frameBuffer, &rgbBuffer, context->params).copy();
 
-        // add this frame into our cache, use MBytes as cost
-        int sizeInMB = p_PixmapConversionBuffer.size() >> 20;
+        // the generation can not change while the prefetch future is running
+        emit prefetchedFrameReady(frameIdx, p_prefetchGeneration, context->renderParams, image);
+    }
 
-        // Convert the image in p_PixmapConversionBuffer to a QPixmap
-       QImage tmpImage((unsigned char*)p_PixmapConversionBuffer.data(),p_width,p_height,QImage::Format_RGB888);
-     //  QImage tmpImage((unsigned char*)p_PixmapConversionBuffer.data(),p_width,p_height,QImage::Format_RGB30);
-        cachedFrame->convertFromImage(tmpImage);
+    context->freeSlots->release();
+}
 
-        frameCache.insert(cIdx, cachedFrame, sizeInMB);
-    }
+void FrameObject::insertPrefetchedFrame(int frameIdx, int generation, QByteArray renderParams, QImage image)
+{
+    // drop frames of a prefetch run that was stopped (e.g. the conversion parameters changed)
+    if( p_srcFile == NULL || generation != p_prefetchGeneration )
+        return;
 
-    p_lastIdx = frameIdx;
+    // the key is built from the parameters the frame was rendered with, not from the current members
+    CacheIdx cIdx(p_srcFile->fileName(), frameIdx, renderParams);
+    if( frameCache.contains(cIdx) )
+        return;
 
-    // update our QImage with frame buffer
-    p_displayImage = *cachedFrame;
+    // QPixmaps may only be created in the GUI thread
+    QPixmap* cachedFrame = new QPixmap(QPixmap::fromImage(image));
+    insertIntoFrameCache(cIdx, cachedFrame);
 }
 
 ValuePairList FrameObject::getValuesAt(int x, int y)
@@ -192,49 +385,70 @@ ValuePairList FrameObject::getValuesAt(int x, int y)
     if ( (p_srcFile == NULL) || (x < 0) || (y < 0) || (x >= p_width) || (y >= p_height) )
         return ValuePairList();
 
-    // read YUV 444 from file
-    QByteArray yuvByteArray;
-    p_srcFile->getOneFrame(&yuvByteArray, p_lastIdx, p_width, p_height);
-
-    const unsigned int planeLength = p_width*p_height;
+    // read the samples from the mapped or cached source frame, chroma before upsampling
+    int valY, valU, valV;
+    if( !p_srcFile->getSampleValues(p_lastIdx, p_width, p_height, x, y, &valY, &valU, &valV) )
+        return ValuePairList();
 
-    const unsigned char valY = yuvByteArray.data()[y*p_width+x];
-    const unsigned char valU = yuvByteArray.data()[planeLength+(y*p_width+x)];
-    const unsigned char valV = yuvByteArray.data()[2*planeLength+(y*p_width+x)];
+    const bool isRGB = (p_srcFile->pixelFormat() == YUVC_24RGBPixelFormat);
 
     ValuePairList values;
 
-    values.append( ValuePair("Y", QString::number(valY)) );
-    values.append( ValuePair("U", QString::number(valU)) );
-    values.append( ValuePair("V", QString::number(valV)) );
+    values.append( ValuePair(isRGB ? "R" : "Y", QString::number(valY)) );
+    values.append( ValuePair(isRGB ? "G" : "U", QString::number(valU)) );
+    values.append( ValuePair(isRGB ? "B" : "V", QString::number(valV)) );
 
     return values;
 }
 
-void FrameObject::applyYUVMath(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, YUVCPixelFormatType srcPixelFormat)
+FrameConversionParameters FrameObject::conversionParameters()
 {
-    const int lumaLength = lumaWidth*lumaHeight;
-    const int singleChromaLength = lumaLength;
-    const int chromaLength = 2*singleChromaLength;
-    const int sourceBPS = YUVFile::bitsPerSample( srcPixelFormat );
-    const int maxVal = (1<<sourceBPS)-1;
+    FrameConversionParameters params;
+    params.applyYUVMath = doApplyYUVMath();
+    params.math = yuvMathParameters();
+    params.colorConversionMode = p_colorConversionMode;
+    return params;
+}
 
-    const bool yInvert = p_lumaInvert;
-    const int yOffset = p_lumaOffset;
-    const int yMultiplier = p_lumaScale;
-    const bool cInvert = p_chromaInvert;
-    const int cOffset = p_chromaOffset;
-    const int cMultiplier0 = p_chromaUScale;
-    const int cMultiplier1 = p_chromaVScale;
+YUVMathParameters FrameObject::yuvMathParameters()
+{
+    YUVMathParameters math;
+    math.yInvert = p_lumaInvert;
+    math.yOffset = p_lumaOffset;
+    math.yMultiplier = p_lumaScale;
+    math.cInvert = p_chromaInvert;
+    math.cOffset = p_chromaOffset;
+    math.cMultiplier[0] = p_chromaUScale;
+    math.cMultiplier[1] = p_chromaVScale;
 
-    int colorMode = YUVMathDefaultColors;
+    math.colorMode = YUVMathDefaultColors;
 
     if( p_lumaScale != 0 && p_chromaUScale == 0 && p_chromaVScale == 0 )
-        colorMode = YUVMathLumaOnly;
+        math.colorMode = YUVMathLumaOnly;
     else if( p_lumaScale == 0 && p_chromaUScale != 0 && p_chromaVScale == 0 )
-        colorMode = YUVMathCbOnly;
+        math.colorMode = YUVMathCbOnly;
     else if( p_lumaScale == 0 && p_chromaUScale == 0 && p_chromaVScale != 0 )
-        colorMode = YUVMathCrOnly;
+        math.colorMode = YUVMathCrOnly;
+
+    return math;
+}
+
+void FrameObject::applyYUVMath(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, YUVCPixelFormatType srcPixelFormat, const YUVMathParameters &math)
+{
+    const int lumaLength = lumaWidth*lumaHeight;
+    const int singleChromaLength = lumaLength;
+    const int chromaLength = 2*singleChromaLength;
+    const int sourceBPS = YUVFile::bitsPerSample( srcPixelFormat );
+    const int maxVal = (1<<sourceBPS)-1;
+
+    const bool yInvert = math.yInvert;
+    const int yOffset = math.yOffset;
+    const int yMultiplier = math.yMultiplier;
+    const bool cInvert = math.cInvert;
+    const int cOffset = math.cOffset;
+    const int cMultiplier0 = math.cMultiplier[0];
+    const int cMultiplier1 = math.cMultiplier[1];
+    const int colorMode = math.colorMode;
 
     if (sourceBPS == 8)
     {
@@ -339,42 +553,12 @@ void FrameObject::applyYUVMath(QByteArray *sourceBuffer, int lumaWidth, int luma
     }
 }
 
-void FrameObject::convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuffer, YUVCPixelFormatType targetPixelFormat)
+YUV2RGBCoefficients FrameObject::conversionCoefficients(int bps, YUVCColorConversionType colorConversionMode)
 {
-    Q_ASSERT(targetPixelFormat == YUVC_24RGBPixelFormat);
-
-   //const int bps = YUVFile::bitsPerSample(targetPixelFormat);
-
-    const int bps = YUVFile::bitsPerSample(p_srcFile->pixelFormat());
-    //const int bps = YUVFile::bitsPerSample(YUVC_420YpCbCr10LEPlanarPixelFormat);
-    // make sure target buffer is big enough
-    int srcBufferLength = sourceBuffer->size();
-    Q_ASSERT( srcBufferLength%3 == 0 ); // YUV444 has 3 bytes per pixel
-    int componentLength = 0;
-    //buffer size changes depending on the bit depth
-    if( targetBuffer->size() != srcBufferLength/2 *3)
-        targetBuffer->resize(srcBufferLength/2*3);
-    if(bps == 8)
-    {
-
-        componentLength = srcBufferLength/3;
-    }
-    else if(bps==10)
-    {
-
-         componentLength = srcBufferLength/6;
-    }
-
-
-    const int yOffset = 16<<(bps-8);
-    const int cZero = 128<<(bps-8);
-    const int rgbMax = (1<<bps)-1;
     int yMult, rvMult, guMult, gvMult, buMult;
 
-    unsigned char *dst = (unsigned char*)targetBuffer->data();
-
     if (bps == 8) {
-        switch (p_colorConversionMode) {
+        switch (colorConversionMode) {
         case YUVC601ColorConversionType:
             yMult =   76309;
             rvMult = 104597;
@@ -396,28 +580,8 @@ void FrameObject::convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuf
             gvMult = -34925;
             buMult = 138438;
         }
-        const unsigned char * restrict srcY = (unsigned char*)sourceBuffer->data();
-        const unsigned char * restrict srcU = srcY + componentLength;
-        const unsigned char * restrict srcV = srcU + componentLength;
-        unsigned char * restrict dstMem = dst;
-
-        int i;
-#pragma omp parallel for default(none) private(i) shared(srcY,srcU,srcV,dstMem,yMult,rvMult,guMult,gvMult,buMult,clip_buf,componentLength)// num_threads(2)
-        for (i = 0; i < componentLength; ++i) {
-            const int Y_tmp = ((int)srcY[i] - yOffset) * yMult;
-            const int U_tmp = (int)srcU[i] - cZero;
-            const int V_tmp = (int)srcV[i] - cZero;
-
-            const int R_tmp = (Y_tmp                  + V_tmp * rvMult ) >> 16;//32 to 16 bit conversion by left shifting
-            const int G_tmp = (Y_tmp + U_tmp * guMult + V_tmp * gvMult ) >> 16;
-            const int B_tmp = (Y_tmp + U_tmp * buMult                  ) >> 16;
-
-            dstMem[3*i]   = clip_buf[R_tmp];
-            dstMem[3*i+1] = clip_buf[G_tmp];
-            dstMem[3*i+2] = clip_buf[B_tmp];
-        }
-    } else if (bps > 8 && bps <= 16) {
-        switch (p_colorConversionMode) {
+    } else {
+        switch (colorConversionMode) {
         case YUVC601ColorConversionType:
             yMult =   19535114;
             rvMult =  26776886;
@@ -442,44 +606,165 @@ void FrameObject::convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuf
             gvMult = (gvMult + (1<<(15-bps))) >> (16-bps);
             buMult = (buMult + (1<<(15-bps))) >> (16-bps);
         }
-        const unsigned short *srcY = (unsigned short*)sourceBuffer->data();
+    }
+
+    YUV2RGBCoefficients coef = { yMult, rvMult, guMult, gvMult, buMult };
+    return coef;
+}
+
+void FrameObject::convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuffer, YUVCPixelFormatType targetPixelFormat, YUVCColorConversionType colorConversionMode)
+{
+    Q_ASSERT(targetPixelFormat == YUVC_24RGBPixelFormat);
+
+   //const int bps = YUVFile::bitsPerSample(targetPixelFormat);
+
+    const int bps = YUVFile::bitsPerSample(p_srcFile->pixelFormat());
+    //const int bps = YUVFile::bitsPerSample(YUVC_420YpCbCr10LEPlanarPixelFormat);
+    // make sure target buffer is big enough
+    int srcBufferLength = sourceBuffer->size();
+    Q_ASSERT( srcBufferLength%3 == 0 ); // YUV444 has 3 bytes per pixel
+    int componentLength = 0;
+    //buffer size changes depending on the bit depth
+    if( targetBuffer->size() != srcBufferLength/2 *3)
+        targetBuffer->resize(srcBufferLength/2*3);
+    if(bps == 8)
+    {
+
+        componentLength = srcBufferLength/3;
+    }
+    else if(bps==10)
+    {
+
+         componentLength = srcBufferLength/6;
+    }
+
+    unsigned char *dst = (unsigned char*)targetBuffer->data();
+    YUV2RGBCoefficients coef = conversionCoefficients(bps, colorConversionMode);
+    const RGBConversionKernels *kernels = &rgbConversionKernels();
+
+    if (bps == 8) {
+        const unsigned char *srcY = (const unsigned char*)sourceBuffer->constData();
+        const unsigned char *srcU = srcY + componentLength;
+        const unsigned char *srcV = srcU + componentLength;
+        unsigned char *dstMem = dst;
+
+        int i;
+#pragma omp parallel for default(none) private(i) shared(srcY,srcU,srcV,dstMem,coef,kernels,componentLength)
+        for (i = 0; i < componentLength; i += RGB_CONVERSION_CHUNK) {
+            const int n = MIN(RGB_CONVERSION_CHUNK, componentLength - i);
+            kernels->convert8(srcY + i, srcU + i, srcV + i, dstMem + 3*i, n, coef);
+        }
+    } else if (bps > 8 && bps <= 16) {
+        const unsigned short *srcY = (const unsigned short*)sourceBuffer->constData();
         const unsigned short *srcU = srcY + componentLength;
         const unsigned short *srcV = srcU + componentLength;
         unsigned char *dstMem = dst;
 
         int i;
-#pragma omp parallel for default(none) private(i) shared(srcY,srcU,srcV,dstMem,yMult,rvMult,guMult,gvMult,buMult,componentLength) // num_threads(2)
-        for (i = 0; i < componentLength; ++i) {
-            qint64 Y_tmp = ((qint64)srcY[i] - yOffset)*yMult;
-            qint64 U_tmp = (qint64)srcU[i]- cZero ;
-            qint64 V_tmp = (qint64)srcV[i]- cZero ;
-           // unsigned int temp = 0, temp1=0;
-
-            qint64 R_tmp  = (Y_tmp                  + V_tmp * rvMult) >> (8+bps);
-            dstMem[i*3]   = (R_tmp<0 ? 0 : (R_tmp>rgbMax ? rgbMax : R_tmp))>>(bps-8);
-            qint64 G_tmp  = (Y_tmp + U_tmp * guMult + V_tmp * gvMult) >> (8+bps);
-            dstMem[i*3+1] = (G_tmp<0 ? 0 : (G_tmp>rgbMax ? rgbMax : G_tmp))>>(bps-8);
-            qint64 B_tmp  = (Y_tmp + U_tmp * buMult                 ) >> (8+bps);
-            dstMem[i*3+2] = (B_tmp<0 ? 0 : (B_tmp>rgbMax ? rgbMax : B_tmp))>>(bps-8);
-//the commented section uses RGB 30 format (10 bits per channel)
-
-/*
-            qint64 R_tmp  = ((Y_tmp                  + V_tmp * rvMult))>>(8+bps)   ;
-            temp = (R_tmp<0 ? 0 : (R_tmp>rgbMax ? rgbMax : R_tmp));
-            dstMem[i*4+3]   = ((temp>>4) & 0x3F);
-
-            qint64 G_tmp  = ((Y_tmp + U_tmp * guMult + V_tmp * gvMult))>>(8+bps);
-            temp1 = (G_tmp<0 ? 0 : (G_tmp>rgbMax ? rgbMax : G_tmp));
-            dstMem[i*4+2] = ((temp<<4) & 0xF0 ) | ((temp1>>6) & 0x0F);
-
-            qint64 B_tmp  = ((Y_tmp + U_tmp * buMult                 ))>>(8+bps) ;
-            temp=0;
-            temp = (B_tmp<0 ? 0 : (B_tmp>rgbMax ? rgbMax : B_tmp));
-            dstMem[i*4+1] = ((temp1<<2)&0xFC) | ((temp>>8) & 0x03);
-            dstMem[i*4] = temp & 0xFF;
-*/
+#pragma omp parallel for default(none) private(i) shared(srcY,srcU,srcV,dstMem,coef,kernels,componentLength)
+        for (i = 0; i < componentLength; i += RGB_CONVERSION_CHUNK) {
+            const int n = MIN(RGB_CONVERSION_CHUNK, componentLength - i);
+            kernels->convert16(srcY + i, srcU + i, srcV + i, dstMem + 3*i, n, coef, bps);
         }
     } else {
         printf("bitdepth %i not supported\n", bps);
     }
 }
+
+bool FrameObject::useFusedConversion(int width, int height)
+{
+    if( !p_srcFile->canUpsampleChromaBands(width, height) )
+        return false;
+
+    // YUV math is only implemented for 8 bit samples
+    return YUVFile::bitsPerSample(p_srcFile->pixelFormat()) == 8 || !doApplyYUVMath();
+}
+
+// YUV math on one row of 4:4:4 samples, same results as applyYUVMath. srcY and dstY may be identical.
+static void applyYUVMathRow8(const YUVMathParameters &math, const unsigned char *srcY, unsigned char *dstY, unsigned char *u, unsigned char *v, int n)
+{
+    const int maxVal = 255;
+
+    for (int i = 0; i < n; i++) {
+        int newVal;
+        if (math.colorMode == YUVMathDefaultColors || math.colorMode == YUVMathLumaOnly) {
+            newVal = math.yInvert ? (maxVal-(int)(srcY[i])):((int)(srcY[i]));
+            newVal = (newVal - math.yOffset) * math.yMultiplier + math.yOffset;
+        } else {
+            // a single chroma component is shown as luma
+            const int c = (math.colorMode == YUVMathCbOnly) ? 0 : 1;
+            newVal = (c == 0) ? u[i] : v[i];
+            newVal = math.cInvert ? (maxVal-newVal) : newVal;
+            newVal = (newVal - math.cOffset) * math.cMultiplier[c] + math.cOffset;
+        }
+        dstY[i] = (unsigned char)MAX( 0, MIN( maxVal, newVal ) );
+
+        if (math.colorMode == YUVMathDefaultColors) {
+            for (int c = 0; c < 2; c++) {
+                unsigned char *chroma = (c == 0) ? u : v;
+                newVal = math.cInvert?(maxVal-(int)(chroma[i])):((int)(chroma[i]));
+                newVal = (newVal - math.cOffset) * math.cMultiplier[c] + math.cOffset;
+                chroma[i] = (unsigned char)MAX( 0, MIN( maxVal, newVal ) );
+            }
+        } else {
+            u[i] = 128;
+            v[i] = 128;
+        }
+    }
+}
+
+QImage FrameObject::convertFrameFused(YUVFile *srcFile, const char *srcFrame, int width, int height, QByteArray *rgbBuffer, const FrameConversionParameters &params)
+{
+    const int bps = YUVFile::bitsPerSample(srcFile->pixelFormat());
+    const int rowLength = width * (bps > 8 ? 2 : 1);
+    const bool applyMath = params.applyYUVMath;
+    const YUVMathParameters math = params.math;
+    const YUV2RGBCoefficients coef = conversionCoefficients(bps, params.colorConversionMode);
+    const RGBConversionKernels *kernels = &rgbConversionKernels();
+    const int numBands = srcFile->chromaBandCount(height);
+
+    if( rgbBuffer->size() != width*height*3 )
+        rgbBuffer->resize(width*height*3);
+    unsigned char *dst = (unsigned char*)rgbBuffer->data();
+
+#pragma omp parallel
+    {
+        // Each thread upsamples the chroma of a band (at most two rows) into its own row buffers.
+        // The luma rows are read from the source frame (or the luma buffer if YUV math is applied).
+        QByteArray rowBuffer(6*rowLength, 0);
+        char *bufY = rowBuffer.data();
+        char *bufU = bufY + 2*rowLength;
+        char *bufV = bufU + 2*rowLength;
+
+        int band;
+#pragma omp for
+        for (band = 0; band < numBands; band++) {
+            int firstRow, numRows;
+            srcFile->chromaBandRows(band, height, &firstRow, &numRows);
+            srcFile->upsampleChromaBand(srcFrame, width, height, band, bufU, bufV);
+
+            for (int k = 0; k < numRows; k++) {
+                const int row = firstRow + k;
+                unsigned char *dstRow = dst + 3*row*width;
+                if (bps == 8) {
+                    const unsigned char *srcY = (const unsigned char*)srcFrame + row*width;
+                    unsigned char *u = (unsigned char*)bufU + k*width;
+                    unsigned char *v = (unsigned char*)bufV + k*width;
+                    if (applyMath) {
+                        unsigned char *y = (unsigned char*)bufY + k*width;
+                        applyYUVMathRow8(math, srcY, y, u, v, width);
+                        srcY = y;
+                    }
+                    kernels->convert8(srcY, u, v, dstRow, width, coef);
+                } else {
+                    const unsigned short *srcY = (const unsigned short*)srcFrame + row*width;
+                    const unsigned short *u = (const unsigned short*)bufU + k*width;
+                    const unsigned short *v = (const unsigned short*)bufV + k*width;
+                    kernels->convert16(srcY, u, v, dstRow, width, coef, bps);
+                }
+            }
+        }
+    }
+
+    return QImage(dst, width, height, QImage::Format_RGB888);
+}
@@ -24,29 +24,67 @@
 #include <QFileInfo>
 #include <QString>
 #include <QImage>
+#include <QFuture>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QHash>
 #include "yuvfile.h"
 #include "displayobject.h"
+#include "rgbconversion.h"
 
 class CacheIdx
  {
  public:
-     CacheIdx(const QString &name, const unsigned int idx) { fileName=name; frameIdx=idx; }
+     CacheIdx(const QString &name, const unsigned int idx, const QByteArray &params) { fileName=name; frameIdx=idx; renderParams=params; }
 
      QString fileName;
      unsigned int frameIdx;
+     QByteArray renderParams;   // all parameters the frame was rendered with (see FrameObject::renderParameters)
  };
 
  inline bool operator==(const CacheIdx &e1, const CacheIdx &e2)
  {
-     return e1.fileName == e2.fileName && e1.frameIdx == e2.frameIdx;
+     return e1.fileName == e2.fileName && e1.frameIdx == e2.frameIdx && e1.renderParams == e2.renderParams;
  }
 
  inline uint qHash(const CacheIdx &cIdx)
  {
-     uint tmp = qHash(cIdx.fileName) ^ qHash(cIdx.frameIdx);
+     uint tmp = qHash(cIdx.fileName) ^ qHash(cIdx.frameIdx) ^ qHash(cIdx.renderParams);
      return tmp;
  }
 
+// parameters of the YUV math (see FrameObject::applyYUVMath)
+struct YUVMathParameters
+{
+    int colorMode;
+    bool yInvert;
+    int yOffset;
+    int yMultiplier;
+    bool cInvert;
+    int cOffset;
+    int cMultiplier[2];
+};
+
+// everything the conversion of a frame to RGB depends on besides the source file (see FrameObject::conversionParameters)
+struct FrameConversionParameters
+{
+    bool applyYUVMath;
+    YUVMathParameters math;
+    YUVCColorConversionType colorConversionMode;
+};
+
+// The parameters of a prefetch run. They are copied in the GUI thread, so the prefetch threads do not
+// read members which the GUI thread may change while they are running.
+struct PrefetchContext
+{
+    int width;
+    int height;
+    bool fused;
+    FrameConversionParameters params;
+    QByteArray renderParams;    // the cache key parameters of the frames (see FrameObject::renderParameters)
+    QSemaphore *freeSlots;  // set by the prefetch worker
+};
+
 class FrameObject : public DisplayObject
 {
     Q_OBJECT
@@ -59,29 +97,29 @@ public:
     QString path() {return p_srcFile->getPath();}
     QString createdtime() {return p_srcFile->getCreatedtime();}
     QString modifiedtime() {return p_srcFile->getModifiedtime();}
-    int     nrBytes() {return p_srcFile->getNumberBytes();}
+    qint64  nrBytes() {return p_srcFile->getNumberBytes();}
     QString getStatus() { return p_srcFile->getStatus(p_width, p_height); }
 
     void setInternalScaleFactor(int) {}    // no internal scaling
 
     // forward these parameters to our source file
-    void setSrcPixelFormat(YUVCPixelFormatType newFormat) { p_srcFile->setSrcPixelFormat(newFormat); emit frameInformationChanged(); }
-    void setInterpolationMode(InterpolationMode newMode) { p_srcFile->setInterpolationMode(newMode); emit frameInformationChanged(); }
-    void setColorConversionMode(YUVCColorConversionType newMode) { p_colorConversionMode = newMode; emit frameInformationChanged(); }
+    void setSrcPixelFormat(YUVCPixelFormatType newFormat) { stopPrefetching(); p_srcFile->setSrcPixelFormat(newFormat); emit frameInformationChanged(); }
+    void setInterpolationMode(InterpolationMode newMode) { stopPrefetching(); p_srcFile->setInterpolationMode(newMode); emit frameInformationChanged(); }
+    void setColorConversionMode(YUVCColorConversionType newMode) { stopPrefetching(); p_colorConversionMode = newMode; emit frameInformationChanged(); }
 
     YUVCPixelFormatType pixelFormat() { return p_srcFile->pixelFormat(); }
     InterpolationMode interpolationMode() { return p_srcFile->interpolationMode(); }
     YUVCColorConversionType colorConversionMode() { return p_colorConversionMode; }
 
-    void setLumaScale(int scale) {p_lumaScale = scale; emit frameInformationChanged(); }
-    void setChromaUScale(int scale) {p_chromaUScale = scale; emit frameInformationChanged(); }
-    void setChromaVScale(int scale) {p_chromaVScale = scale; emit frameInformationChanged(); }
+    void setLumaScale(int scale) { stopPrefetching(); p_lumaScale = scale; emit frameInformationChanged(); }
+    void setChromaUScale(int scale) { stopPrefetching(); p_chromaUScale = scale; emit frameInformationChanged(); }
+    void setChromaVScale(int scale) { stopPrefetching(); p_chromaVScale = scale; emit frameInformationChanged(); }
 
-    void setLumaOffset(int offset) {p_lumaOffset = offset; emit frameInformationChanged(); }
-    void setChromaOffset(int offset) {p_chromaOffset = offset; emit frameInformationChanged(); }
+    void setLumaOffset(int offset) { stopPrefetching(); p_lumaOffset = offset; emit frameInformationChanged(); }
+    void setChromaOffset(int offset) { stopPrefetching(); p_chromaOffset = offset; emit frameInformationChanged(); }
 
-    void setLumaInvert(bool invert) { p_lumaInvert = invert; emit frameInformationChanged(); }
-    void setChromaInvert(bool invert) { p_chromaInvert = invert; emit frameInformationChanged(); }
+    void setLumaInvert(bool invert) { stopPrefetching(); p_lumaInvert = invert; emit frameInformationChanged(); }
+    void setChromaInvert(bool invert) { stopPrefetching(); p_chromaInvert = invert; emit frameInformationChanged(); }
 
     bool doApplyYUVMath() { return p_lumaScale!=1 || p_lumaOffset!=125 || p_chromaOffset!=128 || p_chromaUScale!=1 || p_chromaVScale!=1 || p_lumaInvert!=0 || p_chromaInvert!=0; }
 
@@ -89,7 +127,21 @@ public:
 
     ValuePairList getValuesAt(int x, int y);
 
+    // The cost of a cached frame is the memory footprint of its pixmap in KiB. Always insert with insertIntoFrameCache.
     static QCache<CacheIdx, QPixmap> frameCache;
+    static void insertIntoFrameCache(const CacheIdx &cIdx, QPixmap *pixmap);
+    static int frameCacheCost(const QPixmap &pixmap);
+    static void setFrameCacheSizeInMB(unsigned int sizeInMB);
+    // current usage, number of frames and evictions of the frame cache
+    static QString frameCacheStatus();
+
+    // number of frames the prefetch thread reads ahead of the play head (0 disables prefetching)
+    static int prefetchDepth;
+
+    // how often the displayed frame was found in the cache (hit) or had to be loaded synchronously (miss)
+    int prefetchHits() { return p_prefetchHits; }
+    int prefetchMisses() { return p_prefetchMisses; }
+    QString prefetchStatus() { return QString("Cache hits: %1, misses: %2").arg(p_prefetchHits).arg(p_prefetchMisses); }
 
     YUVFile *getYUVFile() {return p_srcFile;}
 
@@ -98,17 +150,52 @@ public:
 signals:
     void frameInformationChanged();
 
+    // emitted from the prefetch thread for every frame that was converted in the background
+    void prefetchedFrameReady(int frameIdx, int generation, QByteArray renderParams, QImage image);
+
 public slots:
 
-    void refreshDisplayImage() {clearCurrentCache(); loadImage(p_lastIdx);}
+    // frames rendered with other parameters stay in the cache, the cache key contains all parameters
+    void refreshDisplayImage() {stopPrefetching(); loadImage(p_lastIdx);}
+    // frames of the old size are of no use, so stop reading them
+    void setWidth(int newWidth) { stopPrefetching(); DisplayObject::setWidth(newWidth); }
+    void setHeight(int newHeight) { stopPrefetching(); DisplayObject::setHeight(newHeight); }
     void propagateParameterChanges() { emit informationChanged(); }
 
     void clearCompleteCache() { frameCache.clear(); }
-    void clearCurrentCache();
+
+    // start loading the next prefetchDepth frames after frameIdx (respecting sampling and end frame) in the background
+    void prefetchFrames(int frameIdx);
+    void stopPrefetching();
+
+protected slots:
+    void insertPrefetchedFrame(int frameIdx, int generation, QByteArray renderParams, QImage image);
+
 protected:
 
-    void applyYUVMath(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, YUVCPixelFormatType srcPixelFormat);
-    void convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuffer, YUVCPixelFormatType targetPixelFormat);
+    // read and convert one frame. The returned image uses the data of rgbBuffer.
+    QImage renderFrame(int frameIdx, int width, int height, QByteArray *yuv444Buffer, QByteArray *rgbBuffer);
+    // apply YUV math and convert a frame that was read with getOneFrame to RGB. The returned image uses the data of rgbBuffer.
+    QImage convertFrame(int width, int height, QByteArray *yuv444Buffer, QByteArray *rgbBuffer, const FrameConversionParameters &params);
+
+    // Fused conversion of 4:2:0 frames: chroma upsampling, YUV math and conversion to RGB are done row by row,
+    // so the frame is never stored in YUV444. The returned image uses the data of rgbBuffer.
+    bool useFusedConversion(int width, int height);
+    // srcFile provides the pixel format and the chroma upsampling of srcFrame
+    QImage convertFrameFused(YUVFile *srcFile, const char *srcFrame, int width, int height, QByteArray *rgbBuffer, const FrameConversionParameters &params);
+
+    // prefetch pipeline: the worker reads (and upsamples) frames, the conversion to RGB runs on the thread pool
+    void prefetchWorker(QList<int> frameList, PrefetchContext context);
+    void prefetchConvert(int frameIdx, QByteArray frameBuffer, const PrefetchContext *context);
+
+    // snapshot of the current conversion parameters
+    FrameConversionParameters conversionParameters();
+    YUVMathParameters yuvMathParameters();
+    void applyYUVMath(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, YUVCPixelFormatType srcPixelFormat) { applyYUVMath(sourceBuffer, lumaWidth, lumaHeight, srcPixelFormat, yuvMathParameters()); }
+    void applyYUVMath(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, YUVCPixelFormatType srcPixelFormat, const YUVMathParameters &math);
+    static YUV2RGBCoefficients conversionCoefficients(int bps, YUVCColorConversionType colorConversionMode);
+    void convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuffer, YUVCPixelFormatType targetPixelFormat) { convertYUV2RGB(sourceBuffer, targetBuffer, targetPixelFormat, p_colorConversionMode); }
+    void convertYUV2RGB(QByteArray *sourceBuffer, QByteArray *targetBuffer, YUVCPixelFormatType targetPixelFormat, YUVCColorConversionType colorConversionMode);
 
     YUVFile* p_srcFile;
 
@@ -124,6 +211,24 @@ protected:
     bool p_chromaInvert;
 
     YUVCColorConversionType p_colorConversionMode;
+
+    QFuture<void> p_prefetchFuture;
+    // The conversions of the prefetch worker run on our own pool. The worker blocks until a conversion is done,
+    // so it would deadlock if the conversions had to wait for a thread of the pool the worker is running on.
+    QThreadPool p_prefetchConvertPool;
+    bool p_cancelPrefetch;
+    int p_prefetchGeneration;   // incremented whenever prefetched frames become invalid
+
+    int p_prefetchHits;
+    int p_prefetchMisses;
+
+    // cache key of a frame rendered with the current parameters
+    CacheIdx cacheIdx(int frameIdx);
+    // everything that changes the rendered frame (the renderParams of the cache key)
+    QByteArray renderParameters();
+
+    // number of frames that were pushed out of the frame cache because it was full
+    static int frameCacheEvictions;
 };
 
 #endif // FRAMEOBJECT_H
@@ -32,6 +32,8 @@
 #include <QByteArray>
 #include <QDebug>
 #include <QTextEdit>
+#include <QProgressDialog>
+#include <QtConcurrent>
 
 #include "playlistitemvid.h"
 #include "playlistitemstats.h"
@@ -41,6 +43,7 @@
 #include "displaysplitwidget.h"
 #include "plistparser.h"
 #include "plistserializer.h"
+#include "sequencemetricsdialog.h"
 
 #define MIN(a,b) ((a)>(b)?(b):(a))
 #define MAX(a,b) ((a)<(b)?(b):(a))
@@ -161,6 +164,9 @@ void MainWindow::createMenusAndActions()
     fileMenu->addSeparator();
     saveScreenshotAction = fileMenu->addAction("&Save Screenshot...", this, SLOT(saveScreenshot()) );
     fileMenu->addSeparator();
+    convertStatisticsAction = fileMenu->addAction("&Convert Statistics to Binary...", this, SLOT(convertStatisticsFile()) );
+    compareSequencesAction = fileMenu->addAction("Co&mpare Sequences...", this, SLOT(compareSequences()) );
+    fileMenu->addSeparator();
     showSettingsAction = fileMenu->addAction("&Settings", &p_settingswindow, SLOT(show()) );
 
     QMenu* viewMenu = menuBar()->addMenu(tr("&View"));
@@ -613,7 +619,7 @@ void MainWindow::loadFiles(QStringList files)
                 settings.setValue("recentFileList", files);
                 updateRecentFileActions();
             }
-            else if( ext == "csv" )
+            else if( ext == "csv" || ext == "yuvstats" )
             {
                 PlaylistItemStats *newListItemStats = new PlaylistItemStats(fileName, p_playlistWidget);
                 lastAddedItem = newListItemStats;
@@ -661,7 +667,7 @@ void MainWindow::openFile()
     // load last used directory from QPreferences
     QSettings settings;
     QStringList filter;
-    filter << "All Supported Files (*.yuv *.yuvplaylist *.csv)" << "Video Files (*.yuv)" << "Playlist Files (*.yuvplaylist)" << "Statistics Files (*.csv)";
+    filter << "All Supported Files (*.yuv *.yuvplaylist *.csv *.yuvstats)" << "Video Files (*.yuv)" << "Playlist Files (*.yuvplaylist)" << "Statistics Files (*.csv *.yuvstats)";
 
     QFileDialog openDialog(this);
     openDialog.setDirectory(settings.value("lastFilePath").toString());
@@ -831,18 +837,20 @@ void MainWindow::updateSelectedItems()
     QString newCaption = "YUView - " + selectedItemPrimary->text(0);
     setWindowTitle(newCaption);
 
-    PlaylistItemStats* statsItem = NULL;    // used for model as source
+    StatisticsObject* statsObject = NULL;    // used for model as source
 
     // if the newly selected primary (!) item is of type statistics, use it as source for types
     if( selectedItemPrimary && selectedItemPrimary->itemType() == StatisticsItemType )
     {
-        statsItem = dynamic_cast<PlaylistItemStats*>(selectedItemPrimary);
+        PlaylistItemStats* statsItem = dynamic_cast<PlaylistItemStats*>(selectedItemPrimary);
         Q_ASSERT(statsItem != NULL);
+        statsObject = statsItem->displayObject();
     }
     else if( selectedItemSecondary && selectedItemSecondary->itemType() == StatisticsItemType )
     {
-        statsItem = dynamic_cast<PlaylistItemStats*>(selectedItemSecondary);
+        PlaylistItemStats* statsItem = dynamic_cast<PlaylistItemStats*>(selectedItemSecondary);
         Q_ASSERT(statsItem != NULL);
+        statsObject = statsItem->displayObject();
     }
 
     // if selected item is of type 'diff', update child items
@@ -853,37 +861,24 @@ void MainWindow::updateSelectedItems()
         PlaylistItemVid* secondVidItem = dynamic_cast<PlaylistItemVid*>(selectedItemPrimary->child(1));
 
         if( firstVidItem && secondVidItem )
+        {
             diffItem->displayObject()->setFrameObjects(firstVidItem->displayObject(), secondVidItem->displayObject());
+            diffItem->qualityMapObject()->setFrameObjects(firstVidItem->displayObject(), secondVidItem->displayObject());
+        }
     }
 
-    // check for associated statistics
-    PlaylistItemStats* statsItemPrimary = NULL;
-    PlaylistItemStats* statsItemSecondary = NULL;
-    if( selectedItemPrimary && selectedItemPrimary->itemType() == VideoItemType && selectedItemPrimary->childCount() > 0 )
-    {
-        QTreeWidgetItem* childItem = selectedItemPrimary->child(0);
-        statsItemPrimary = dynamic_cast<PlaylistItemStats*>(childItem);
-        Q_ASSERT(statsItemPrimary != NULL);
-
-        if( statsItem == NULL )
-            statsItem = statsItemPrimary;
-    }
-    if( selectedItemSecondary && selectedItemSecondary->itemType() == VideoItemType && selectedItemSecondary->childCount() > 0 )
-    {
-        QTreeWidgetItem* childItem = selectedItemSecondary->child(0);
-        statsItemSecondary = dynamic_cast<PlaylistItemStats*>(childItem);
-        Q_ASSERT(statsItemSecondary != NULL);
-
-        if( statsItem == NULL )
-            statsItem = statsItemSecondary;
-    }
+    // check for associated statistics (the quality map of a difference is its statistics overlay)
+    StatisticsObject* statsObjectPrimary = associatedStatisticsObject(selectedItemPrimary);
+    StatisticsObject* statsObjectSecondary = associatedStatisticsObject(selectedItemSecondary);
+    if( statsObject == NULL )
+        statsObject = statsObjectPrimary ? statsObjectPrimary : statsObjectSecondary;
 
     // update statistics mode, if statistics is selected or associated with a selected item
-    if( statsItem != NULL )
-        dynamic_cast<StatsListModel*>(ui->statsListView->model())->setStatisticsTypeList(statsItem->displayObject()->getStatisticsTypeList());
+    if( statsObject != NULL )
+        dynamic_cast<StatsListModel*>(ui->statsListView->model())->setStatisticsTypeList(statsObject->getStatisticsTypeList());
 
     // update display widget
-    ui->displaySplitView->setActiveStatisticsObjects(statsItemPrimary?statsItemPrimary->displayObject():NULL, statsItemSecondary?statsItemSecondary->displayObject():NULL);
+    ui->displaySplitView->setActiveStatisticsObjects(statsObjectPrimary, statsObjectSecondary);
 
     if(selectedItemPrimary == NULL || selectedItemPrimary->displayObject() == NULL)
         return;
@@ -915,6 +910,7 @@ void MainWindow::onCustomContextMenu(const QPoint &point)
     menu.addAction("Add Difference Sequence", this, SLOT(addDifferenceSequence()));
 
     QTreeWidgetItem* itemAtPoint = p_playlistWidget->itemAt(point);
+    PlaylistItemDifference* diffItemAtPoint = NULL;
     if (itemAtPoint)
     {
         menu.addSeparator();
@@ -938,16 +934,41 @@ void MainWindow::onCustomContextMenu(const QPoint &point)
         PlaylistItemDifference* testDiff = dynamic_cast<PlaylistItemDifference*>(itemAtPoint);
         if(testDiff)
         {
-            // TODO: special actions for difference items
+            // the mode actions carry the difference mode as data and the amplification as property
+            DifferenceObject *diffObject = testDiff->displayObject();
+            QMenu *modeMenu = menu.addMenu("Difference Mode");
+            QAction *modeAction = modeMenu->addAction("Signed");
+            modeAction->setData(SignedDifferenceMode);
+            modeAction->setCheckable(true);
+            modeAction->setChecked(diffObject->differenceMode() == SignedDifferenceMode);
+            modeAction = modeMenu->addAction("Absolute");
+            modeAction->setData(AbsoluteDifferenceMode);
+            modeAction->setCheckable(true);
+            modeAction->setChecked(diffObject->differenceMode() == AbsoluteDifferenceMode);
+            const int amplifications[] = {2, 4, 8, 16};
+            for (int i = 0; i < 4; i++)
+            {
+                modeAction = modeMenu->addAction(QString("Amplified x%1").arg(amplifications[i]));
+                modeAction->setData(AmplifiedDifferenceMode);
+                modeAction->setProperty("amplification", amplifications[i]);
+                modeAction->setCheckable(true);
+                modeAction->setChecked(diffObject->differenceMode() == AmplifiedDifferenceMode && diffObject->amplification() == amplifications[i]);
+            }
+            diffItemAtPoint = testDiff;
         }
     }
 
     QPoint globalPos = p_playlistWidget->viewport()->mapToGlobal(point);
     QAction* selectedAction= menu.exec(globalPos);
-    if (selectedAction)
+    if (selectedAction && diffItemAtPoint && selectedAction->data().isValid())
     {
-        //TODO
-        //printf("Do something \n");
+        // the difference image is reloaded by the display object
+        DifferenceMode mode = (DifferenceMode)selectedAction->data().toInt();
+        if (mode == AmplifiedDifferenceMode)
+            diffItemAtPoint->displayObject()->setDifferenceMode(mode, selectedAction->property("amplification").toInt());
+        else
+            diffItemAtPoint->displayObject()->setDifferenceMode(mode);
+        ui->displaySplitView->drawFrame(p_currentFrame);
     }
 }
 
@@ -1162,7 +1183,7 @@ void MainWindow::updateMetaInfo()
         ui->filepathText->setText(viditem->displayObject()->path());
         ui->nrBytesText->setText(QString::number(viditem->displayObject()->nrBytes()));
         ui->nrFramesText->setText(QString::number(viditem->displayObject()->numFrames()));
-        ui->statusText->setText(viditem->displayObject()->getStatusAndInfo());
+        ui->statusText->setText(viditem->displayObject()->getStatusAndInfo() + "\n" + viditem->displayObject()->prefetchStatus() + "\n" + FrameObject::frameCacheStatus());
     }
     else if( selectedPrimaryPlaylistItem()->itemType() == StatisticsItemType )
     {
@@ -1174,7 +1195,7 @@ void MainWindow::updateMetaInfo()
         ui->filepathText->setText(statsItem->displayObject()->path());
         ui->nrBytesText->setText(QString::number(statsItem->displayObject()->nrBytes()));
         ui->nrFramesText->setText(QString::number(statsItem->displayObject()->numFrames()));
-        ui->statusText->setText(statsItem->displayObject()->getStatusAndInfo());
+        ui->statusText->setText(statsItem->displayObject()->getStatusAndInfo() + "\n" + StatisticsObject::statisticsCacheStatus());
     }
     else
     {
@@ -1539,6 +1560,56 @@ void MainWindow::frameTimerEvent()
         // update current frame
         setCurrentFrame( nextFrame );
     }
+
+    // keep the read ahead of the displayed videos in front of the play head
+    PlaylistItemVid* vidItem = dynamic_cast<PlaylistItemVid*>(selectedPrimaryPlaylistItem());
+    if (vidItem)
+        vidItem->displayObject()->prefetchFrames(p_currentFrame);
+    vidItem = dynamic_cast<PlaylistItemVid*>(selectedSecondaryPlaylistItem());
+    if (vidItem)
+        vidItem->displayObject()->prefetchFrames(p_currentFrame);
+
+    // the same for the displayed statistics
+    prefetchStatistics(selectedPrimaryPlaylistItem());
+    prefetchStatistics(selectedSecondaryPlaylistItem());
+}
+
+void MainWindow::prefetchStatistics(PlaylistItem *item)
+{
+    if (item == NULL)
+        return;
+
+    // statistics are shown on their own or as overlay of their video (or difference)
+    StatisticsObject* statsObject = NULL;
+    PlaylistItemStats* statsItem = dynamic_cast<PlaylistItemStats*>(item);
+    if (statsItem)
+        statsObject = statsItem->displayObject();
+    else
+        statsObject = associatedStatisticsObject(item);
+
+    if (statsObject)
+        statsObject->prefetchStatistics(p_currentFrame, item->displayObject()->sampling());
+}
+
+StatisticsObject* MainWindow::associatedStatisticsObject(PlaylistItem *item)
+{
+    if (item == NULL)
+        return NULL;
+
+    if (item->itemType() == VideoItemType && item->childCount() > 0)
+    {
+        PlaylistItemStats* statsItem = dynamic_cast<PlaylistItemStats*>(item->child(0));
+        Q_ASSERT(statsItem != NULL);
+        return statsItem->displayObject();
+    }
+    if (item->itemType() == DifferenceItemType && item->childCount() == 2)
+    {
+        PlaylistItemDifference* diffItem = dynamic_cast<PlaylistItemDifference*>(item);
+        Q_ASSERT(diffItem != NULL);
+        return diffItem->qualityMapObject();
+    }
+
+    return NULL;
 }
 
 void MainWindow::heartbeatTimerEvent()
@@ -1553,6 +1624,11 @@ void MainWindow::heartbeatTimerEvent()
 
     p_lastHeartbeatTime = newFrameTime;
     p_FPSCounter = 0;
+
+    // update read ahead counters
+    PlaylistItemVid* vidItem = dynamic_cast<PlaylistItemVid*>(selectedPrimaryPlaylistItem());
+    if (vidItem && p_playTimer->isActive())
+        ui->statusText->setText(vidItem->displayObject()->getStatusAndInfo() + "\n" + vidItem->displayObject()->prefetchStatus() + "\n" + FrameObject::frameCacheStatus());
 }
 
 void MainWindow::toggleRepeat()
@@ -1708,14 +1784,10 @@ void MainWindow::statsTypesChanged()
         // update list of activated types
         statsItem->displayObject()->setStatisticsTypeList(dynamic_cast<StatsListModel*>(ui->statsListView->model())->getStatisticsTypeList());
     }
-    else if (selectedPrimaryPlaylistItem() && selectedPrimaryPlaylistItem()->itemType() == VideoItemType && selectedPrimaryPlaylistItem()->childCount() > 0 )
+    else if (associatedStatisticsObject(selectedPrimaryPlaylistItem()) != NULL)
     {
-        QTreeWidgetItem* childItem = selectedPrimaryPlaylistItem()->child(0);
-        PlaylistItemStats* statsItem = dynamic_cast<PlaylistItemStats*>(childItem);
-        Q_ASSERT(statsItem != NULL);
-
         // update list of activated types
-        statsItem->displayObject()->setStatisticsTypeList(dynamic_cast<StatsListModel*>(ui->statsListView->model())->getStatisticsTypeList());
+        associatedStatisticsObject(selectedPrimaryPlaylistItem())->setStatisticsTypeList(dynamic_cast<StatsListModel*>(ui->statsListView->model())->getStatisticsTypeList());
     }
 
     // update all displayed statistics of secondary item
@@ -1727,14 +1799,10 @@ void MainWindow::statsTypesChanged()
         // update list of activated types
         statsItem->displayObject()->setStatisticsTypeList(dynamic_cast<StatsListModel*>(ui->statsListView->model())->getStatisticsTypeList());
     }
-    else if (selectedSecondaryPlaylistItem() && selectedSecondaryPlaylistItem()->itemType() == VideoItemType && selectedSecondaryPlaylistItem()->childCount() > 0 )
+    else if (associatedStatisticsObject(selectedSecondaryPlaylistItem()) != NULL)
     {
-        QTreeWidgetItem* childItem = selectedSecondaryPlaylistItem()->child(0);
-        PlaylistItemStats* statsItem = dynamic_cast<PlaylistItemStats*>(childItem);
-        Q_ASSERT(statsItem != NULL);
-
         // update list of activated types
-        statsItem->displayObject()->setStatisticsTypeList(dynamic_cast<StatsListModel*>(ui->statsListView->model())->getStatisticsTypeList());
+        associatedStatisticsObject(selectedSecondaryPlaylistItem())->setStatisticsTypeList(dynamic_cast<StatsListModel*>(ui->statsListView->model())->getStatisticsTypeList());
     }
 
     // refresh display widget
@@ -1846,9 +1914,102 @@ void MainWindow::saveScreenshot() {
     settings.setValue("LastScreenshotPath",filename);
 }
 
+void MainWindow::convertStatisticsFile()
+{
+    QSettings settings;
+
+    QString csvPath = QFileDialog::getOpenFileName(this, tr("Convert Statistics File"), settings.value("lastFilePath").toString(), tr("Statistics Files (*.csv)"));
+    if (csvPath.isEmpty())
+        return;
+
+    QFileInfo csvInfo(csvPath);
+    QString binaryPath = QFileDialog::getSaveFileName(this, tr("Save Binary Statistics File"), csvInfo.path() + "/" + csvInfo.completeBaseName() + ".yuvstats", tr("Binary Statistics Files (*.yuvstats)"));
+    if (binaryPath.isEmpty())
+        return;
+
+    // convert in the background, files of several GB take minutes
+    QString error;
+    bool cancel = false;
+    int progress = 0;
+    QFuture<bool> conversion = QtConcurrent::run(&StatisticsObject::convertCSVToBinary, csvPath, binaryPath, &error, (const bool*)&cancel, &progress);
+
+    QProgressDialog progressDialog(tr("Converting %1...").arg(csvInfo.fileName()), tr("Cancel"), 0, 100, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(0);
+    while (!conversion.isFinished())
+    {
+        if (progressDialog.wasCanceled())
+            cancel = true;
+        else
+            progressDialog.setValue(progress);
+
+        QApplication::processEvents(QEventLoop::AllEvents, 50);
+        QThread::msleep(50);
+    }
+    progressDialog.reset();
+
+    if (!conversion.result())
+    {
+        // a canceled conversion removes the incomplete file
+        if (!cancel)
+            QMessageBox::warning(this, tr("Conversion failed"), error, QMessageBox::Ok);
+        return;
+    }
+
+    loadFiles(QStringList(binaryPath));
+}
+
+void MainWindow::compareSequences()
+{
+    // two selected videos or the two videos of a difference
+    PlaylistItemVid* vidItems[2] = { NULL, NULL };
+    PlaylistItem* selectedItemPrimary = selectedPrimaryPlaylistItem();
+    if( selectedItemPrimary && selectedItemPrimary->itemType() == DifferenceItemType && selectedItemPrimary->childCount() == 2 )
+    {
+        vidItems[0] = dynamic_cast<PlaylistItemVid*>(selectedItemPrimary->child(0));
+        vidItems[1] = dynamic_cast<PlaylistItemVid*>(selectedItemPrimary->child(1));
+    }
+    else
+    {
+        vidItems[0] = dynamic_cast<PlaylistItemVid*>(selectedItemPrimary);
+        vidItems[1] = dynamic_cast<PlaylistItemVid*>(selectedSecondaryPlaylistItem());
+    }
+
+    if( vidItems[0] == NULL || vidItems[1] == NULL )
+    {
+        QMessageBox::information(this, tr("Compare Sequences"), tr("Select two video sequences or a difference sequence."), QMessageBox::Ok);
+        return;
+    }
+
+    FrameObject* firstObject = vidItems[0]->displayObject();
+    FrameObject* secondObject = vidItems[1]->displayObject();
+    if( firstObject->width() != secondObject->width() || firstObject->height() != secondObject->height() ||
+        YUVFile::bitsPerSample(firstObject->pixelFormat()) != YUVFile::bitsPerSample(secondObject->pixelFormat()) )
+    {
+        QMessageBox::warning(this, tr("Compare Sequences"), tr("The sequences need to have the same size and bit depth."), QMessageBox::Ok);
+        return;
+    }
+
+    SequenceMetricsDialog metricsDialog(firstObject, secondObject, this);
+    metricsDialog.exec();
+}
+
 void MainWindow::updateSettings()
 {
-    FrameObject::frameCache.setMaxCost(p_settingswindow.getCacheSizeInMB());
+    FrameObject::setFrameCacheSizeInMB(p_settingswindow.getCacheSizeInMB());
+    // the source frames are only a second tier for re-rendering, a quarter of the video cache is plenty
+    YUVFile::setSourceFrameCacheSizeInMB(p_settingswindow.getCacheSizeInMB() / 4);
+    FrameObject::prefetchDepth = p_settingswindow.getPrefetchDepth();
+    StatisticsObject::setStatisticsCacheSizeInMB(p_settingswindow.getStatisticsCacheSizeInMB());
+    StatisticsObject::prefetchDepth = p_settingswindow.getPrefetchDepth();
+
+    QualityMapObject::defaultBlockSize = p_settingswindow.getQualityMapBlockSize();
+    for(int i=0; i<p_playlistWidget->topLevelItemCount();i++)
+    {
+        PlaylistItemDifference* diffItem = dynamic_cast<PlaylistItemDifference*>(p_playlistWidget->topLevelItem(i));
+        if( diffItem )
+            diffItem->qualityMapObject()->setBlockSize(QualityMapObject::defaultBlockSize);
+    }
 
     updateGrid();
 
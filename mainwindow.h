@@ -123,6 +123,12 @@ public slots:
 
     void savePlaylistToFile();
 
+    //! Converts a CSV statistics file to the binary statistics format
+    void convertStatisticsFile();
+
+    //! Computes PSNR, SSIM and MS-SSIM of the two selected sequences (or the sequences of the selected difference)
+    void compareSequences();
+
     //! Starts playback of selected video file
     void play();
 
@@ -238,6 +244,11 @@ private:
     PlaylistItem* selectedPrimaryPlaylistItem();
     PlaylistItem* selectedSecondaryPlaylistItem();
 
+    // start loading the statistics shown with item ahead of the play head
+    void prefetchStatistics(PlaylistItem *item);
+    // the statistics shown as overlay of a video (its statistics file) or of a difference (its quality map)
+    StatisticsObject* associatedStatisticsObject(PlaylistItem *item);
+
     SettingsWindow p_settingswindow;
 
     void createMenusAndActions();
@@ -253,6 +264,8 @@ private:
     QAction* addTextAction;
     QAction* addDifferenceAction;
     QAction* saveScreenshotAction;
+    QAction* convertStatisticsAction;
+    QAction* compareSequencesAction;
     QAction* showSettingsAction;
     QAction* deleteItemAction;
 
@@ -22,6 +22,7 @@ PlaylistItemDifference::PlaylistItemDifference(const QString &itemName, QTreeWid
 {
     // create new object for this video file
     p_displayObject = new DifferenceObject();
+    p_qualityMapObject = new QualityMapObject();
 
     // update item name to short name
     setText(0, itemName);
@@ -35,6 +36,7 @@ PlaylistItemDifference::PlaylistItemDifference(const QString &itemName, QTreeWid
 
 PlaylistItemDifference::~PlaylistItemDifference()
 {
+    delete p_qualityMapObject;
     delete p_displayObject;
 }
 
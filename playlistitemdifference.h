@@ -22,6 +22,7 @@
 #include <QObject>
 #include "playlistitem.h"
 #include "differenceobject.h"
+#include "qualitymapobject.h"
 
 class PlaylistItemDifference : public PlaylistItem
 {
@@ -32,6 +33,12 @@ public:
     PlaylistItemType itemType();
 
     DifferenceObject *displayObject() { return dynamic_cast<DifferenceObject*>(p_displayObject); }
+
+    // per block PSNR/MSE of the two sequences, shown as statistics overlay of the difference
+    QualityMapObject *qualityMapObject() { return p_qualityMapObject; }
+
+private:
+    QualityMapObject *p_qualityMapObject;
 };
 
 #endif // PLAYLISTITEMDIFFERENCE_H
@@ -0,0 +1,252 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qualitymapobject.h"
+#include "qualitymetrics.h"
+
+#include <climits>
+
+int QualityMapObject::defaultBlockSize = 16;
+
+QualityMapObject::QualityMapObject(QObject* parent) : StatisticsObject(parent)
+{
+    p_frameObjects[0] = NULL;
+    p_frameObjects[1] = NULL;
+    p_blockSize = qBound(QUALITY_MAP_MIN_BLOCK_SIZE, defaultBlockSize, QUALITY_MAP_MAX_BLOCK_SIZE);
+    p_bitDepth = 0;
+    p_name = "Quality Map";
+}
+
+QualityMapObject::~QualityMapObject()
+{
+    // the prefetch thread calls our loadStatistics
+    stopPrefetching();
+}
+
+// Return the smaller number of frames from the two frame objects
+int QualityMapObject::numFrames()
+{
+    if (p_frameObjects[0] == NULL || p_frameObjects[1] == NULL)
+        return 0;
+    return qMin(p_frameObjects[0]->numFrames(), p_frameObjects[1]->numFrames());
+}
+
+void QualityMapObject::setFrameObjects(FrameObject* firstObject, FrameObject* secondObject)
+{
+    stopPrefetching();
+
+    p_frameObjects[0] = firstObject;
+    p_frameObjects[1] = secondObject;
+
+    // the source frames or their parameters may have changed
+    removeFromStatisticsCache();
+
+    if (firstObject == NULL || secondObject == NULL)
+        return;
+
+    p_width = firstObject->width();
+    p_height = firstObject->height();
+    p_frameRate = firstObject->frameRate();
+    p_numberFrames = numFrames();
+    p_endFrame = p_numberFrames - 1;
+
+    const int bitDepth = YUVFile::bitsPerSample(firstObject->pixelFormat());
+    if (bitDepth != p_bitDepth)
+        setStatisticsTypes(bitDepth);
+
+    emit informationChanged();
+}
+
+void QualityMapObject::setBlockSize(int blockSize)
+{
+    blockSize = qBound(QUALITY_MAP_MIN_BLOCK_SIZE, blockSize, QUALITY_MAP_MAX_BLOCK_SIZE);
+    if (blockSize == p_blockSize)
+        return;
+
+    stopPrefetching();
+    p_blockSize = blockSize;
+    removeFromStatisticsCache();
+}
+
+void QualityMapObject::setStatisticsTypes(int bitDepth)
+{
+    // Keep the render settings of the current types. New types are not rendered, the overlay would hide the
+    // difference image and every played frame would be compared. It is enabled in the statistics list.
+    StatisticsTypeList oldTypeList = p_statsTypeList;
+    p_statsTypeList.clear();
+    p_bitDepth = bitDepth;
+
+    // PSNR in [0, 60] dB
+    StatisticsType psnrType;
+    psnrType.typeID = psnrQualityMapType;
+    psnrType.typeName = "PSNR Y [dB]";
+    psnrType.visualizationType = colorRangeType;
+    QStringList psnrRange;
+    psnrRange << "%" << "defaultRange" << "0" << QString::number(60 * QUALITY_MAP_VALUE_SCALE) << "jet";
+    psnrType.colorRange = new DefaultColorRange(psnrRange);
+    psnrType.colorRange->buildLUT();
+    psnrType.render = false;
+    p_statsTypeList.append(psnrType);
+
+    // MSE from transparent (no error) to red (an MSE of 100 for 8 bit, scaled to the bit depth)
+    StatisticsType mseType;
+    mseType.typeID = mseQualityMapType;
+    mseType.typeName = "MSE Y";
+    mseType.visualizationType = colorRangeType;
+    ColorRange *mseRange = new ColorRange();
+    mseRange->rangeMin = 0;
+    mseRange->rangeMax = (100 << (2*qMax(0, bitDepth-8))) * QUALITY_MAP_VALUE_SCALE;
+    mseRange->minColor = QColor(255, 0, 0, 0);
+    mseRange->maxColor = QColor(255, 0, 0, 255);
+    mseRange->buildLUT();
+    mseType.colorRange = mseRange;
+    mseType.render = false;
+    p_statsTypeList.append(mseType);
+
+    if (!oldTypeList.isEmpty())
+        setStatisticsTypeList(oldTypeList);
+}
+
+bool QualityMapObject::hasStatistics(int frameIdx, int typeID)
+{
+    return (typeID == psnrQualityMapType || typeID == mseQualityMapType) && frameIdx >= 0 && frameIdx < numFrames();
+}
+
+StatisticsLoadContext QualityMapObject::loadContext()
+{
+    StatisticsLoadContext context = StatisticsObject::loadContext();
+
+    FrameObject *firstObject = p_frameObjects[0];
+    FrameObject *secondObject = p_frameObjects[1];
+    if (firstObject == NULL || secondObject == NULL || firstObject->getYUVFile() == NULL || secondObject->getYUVFile() == NULL)
+        return context;
+
+    // both frames have to have the same size and bit depth
+    const int width = firstObject->width();
+    const int height = firstObject->height();
+    const int bitDepth = YUVFile::bitsPerSample(firstObject->pixelFormat());
+    if (width <= 0 || height <= 0 || secondObject->width() != width || secondObject->height() != height || YUVFile::bitsPerSample(secondObject->pixelFormat()) != bitDepth)
+        return context;
+
+    context.width = width;
+    context.height = height;
+    context.sourceFiles[0] = firstObject->getYUVFile();
+    context.sourceFiles[1] = secondObject->getYUVFile();
+    context.sourceBitDepth = bitDepth;
+    return context;
+}
+
+StatisticsItemList QualityMapObject::loadStatistics(int frameIdx, int typeID, const StatisticsLoadContext &context)
+{
+    // runs on the prefetch thread as well, so the frame objects are not used here
+    if (context.sourceFiles[0] == NULL || context.sourceFiles[1] == NULL)
+        return StatisticsItemList();
+
+    int width = context.width;
+    int height = context.height;
+    const int bitDepth = context.sourceBitDepth;
+
+    QByteArray frameBuffers[2];
+    YUVPlanes planes[2];
+    if (!context.sourceFiles[0]->getPlanes(&frameBuffers[0], frameIdx, width, height, &planes[0]) ||
+        !context.sourceFiles[1]->getPlanes(&frameBuffers[1], frameIdx, width, height, &planes[1]) ||
+        planes[0].bytesPerSample != planes[1].bytesPerSample || planes[0].bytesPerSample != ((bitDepth > 8) ? 2 : 1))
+        return StatisticsItemList();
+
+    int blockSize = p_blockSize;
+    int blocksX = (width + blockSize - 1) / blockSize;
+    int blocksY = (height + blockSize - 1) / blockSize;
+
+    // sum of squared differences per block, the block rows are processed in parallel
+    QVector<quint64> blockSSE(blocksX * blocksY, 0);
+    quint64 *sse = blockSSE.data();
+    const char *srcA = planes[0].data[0];
+    const char *srcB = planes[1].data[0];
+    int bytesPerSample = planes[0].bytesPerSample;
+    const QualityMetricKernels *kernels = &qualityMetricKernels();
+
+    int blockY;
+#pragma omp parallel for default(none) private(blockY) shared(sse,srcA,srcB,kernels,width,height,blockSize,blocksX,blocksY,bytesPerSample)
+    for (blockY = 0; blockY < blocksY; blockY++)
+    {
+        const int yEnd = qMin(height, (blockY+1) * blockSize);
+        for (int y = blockY * blockSize; y < yEnd; y++)
+        {
+            const char *rowA = srcA + (qint64)y * width * bytesPerSample;
+            const char *rowB = srcB + (qint64)y * width * bytesPerSample;
+            for (int blockX = 0; blockX < blocksX; blockX++)
+            {
+                const int x = blockX * blockSize;
+                const int n = qMin(blockSize, width - x);
+                if (bytesPerSample == 1)
+                    sse[blockY*blocksX + blockX] += kernels->sse8((const unsigned char*)rowA + x, (const unsigned char*)rowB + x, n);
+                else
+                    sse[blockY*blocksX + blockX] += kernels->sse16((const unsigned short*)rowA + x, (const unsigned short*)rowB + x, n);
+            }
+        }
+    }
+
+    StatisticsItemList psnrList, mseList;
+    psnrList.reserve(blocksX * blocksY, false);
+    mseList.reserve(blocksX * blocksY, false);
+    for (blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (int blockX = 0; blockX < blocksX; blockX++)
+        {
+            const int x = blockX * blockSize;
+            const int y = blockY * blockSize;
+            const int w = qMin(blockSize, width - x);
+            const int h = qMin(blockSize, height - y);
+
+            const double mse = (double)sse[blockY*blocksX + blockX] / (double)(w * h);
+            const int psnrValue = qRound(psnrFromMSE(mse, bitDepth) * QUALITY_MAP_VALUE_SCALE);
+            const int mseValue = (int)qMin(mse * QUALITY_MAP_VALUE_SCALE + 0.5, (double)INT_MAX);
+
+            psnrList.append(x, y, w, h, psnrValue, 0, false);
+            mseList.append(x, y, w, h, mseValue, 0, false);
+        }
+    }
+
+    psnrList.buildIndex(width, height);
+    mseList.buildIndex(width, height);
+    insertIntoStatisticsCache(frameIdx, psnrQualityMapType, psnrList);
+    insertIntoStatisticsCache(frameIdx, mseQualityMapType, mseList);
+
+    return (typeID == psnrQualityMapType) ? psnrList : mseList;
+}
+
+// the values of all rendered types at the given position (in dB respectively squared sample values)
+ValuePairList QualityMapObject::getValuesAt(int x, int y)
+{
+    ValuePairList valueList;
+
+    for (int i = 0; i < p_statsTypeList.count(); i++)
+    {
+        if (!p_statsTypeList[i].render)
+            continue;
+
+        StatisticsItemList statsList = getStatistics(p_lastIdx, p_statsTypeList[i].typeID);
+        QVector<int> items = statsList.itemsAt(x, y);
+        if (items.isEmpty())
+            valueList.append( ValuePair(p_statsTypeList[i].typeName, "-") );
+        else
+            valueList.append( ValuePair(p_statsTypeList[i].typeName, QString::number((double)statsList.value1[items.first()] / QUALITY_MAP_VALUE_SCALE, 'f', 2)) );
+    }
+
+    return valueList;
+}
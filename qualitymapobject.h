@@ -0,0 +1,69 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QUALITYMAPOBJECT_H
+#define QUALITYMAPOBJECT_H
+
+#include <QObject>
+#include "statisticsobject.h"
+#include "frameobject.h"
+
+#define QUALITY_MAP_MIN_BLOCK_SIZE 4
+#define QUALITY_MAP_MAX_BLOCK_SIZE 64
+
+// the values of the quality map are stored in 1/QUALITY_MAP_VALUE_SCALE (dB)
+#define QUALITY_MAP_VALUE_SCALE 100
+
+enum qualityMapType_t { psnrQualityMapType = 0, mseQualityMapType };
+
+// Per block PSNR and MSE of the luma planes of two frame objects. The values are computed when a frame is
+// requested (or prefetched) and rendered like the statistics of a statistics file.
+class QualityMapObject : public StatisticsObject
+{
+public:
+    QualityMapObject(QObject* parent = 0);
+    ~QualityMapObject();
+
+    void setFrameObjects(FrameObject* firstObject, FrameObject* secondObject);
+
+    // edge length of the blocks in luma samples (clipped to [QUALITY_MAP_MIN_BLOCK_SIZE, QUALITY_MAP_MAX_BLOCK_SIZE])
+    void setBlockSize(int blockSize);
+    int blockSize() { return p_blockSize; }
+
+    int numFrames();
+    ValuePairList getValuesAt(int x, int y);
+
+    // block size of new quality maps
+    static int defaultBlockSize;
+
+protected:
+    bool hasStatistics(int frameIdx, int typeID);
+    // computes the PSNR and MSE lists of the frame and puts both into the cache
+    StatisticsItemList loadStatistics(int frameIdx, int typeID, const StatisticsLoadContext &context);
+    // the size, bit depth and files of the frame objects (no source files if they can not be compared)
+    StatisticsLoadContext loadContext();
+
+private:
+    void setStatisticsTypes(int bitDepth);
+
+    FrameObject* p_frameObjects[2];
+    int p_blockSize;
+    int p_bitDepth;
+};
+
+#endif // QUALITYMAPOBJECT_H
@@ -0,0 +1,646 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qualitymetrics.h"
+#include "cpufeatures.h"
+
+#include <math.h>
+#include <limits>
+#include <QVector>
+
+/////////////////////////////////////////////////////////////////////////////
+// scalar reference
+
+static quint64 sse8_c(const unsigned char *srcA, const unsigned char *srcB, int n)
+{
+    quint64 sum = 0;
+    for (int i = 0; i < n; ++i) {
+        const int diff = (int)srcA[i] - (int)srcB[i];
+        sum += (quint64)(diff * diff);
+    }
+    return sum;
+}
+
+static quint64 sse16_c(const unsigned short *srcA, const unsigned short *srcB, int n)
+{
+    quint64 sum = 0;
+    for (int i = 0; i < n; ++i) {
+        const qint64 diff = (qint64)srcA[i] - (qint64)srcB[i];
+        sum += (quint64)(diff * diff);
+    }
+    return sum;
+}
+
+// The taps of the Gaussian filters are added in this order by all implementations:
+// weights[5]*center, then weights[k]*(tap k + tap 10-k) for k = 0 to 4.
+static void gaussianRow_c(const float *src, float *dst, int n, const float *weights)
+{
+    for (int x = 0; x < n; x++) {
+        float sum = weights[5] * src[x+5];
+        for (int k = 0; k < 5; k++)
+            sum += weights[k] * (src[x+k] + src[x+10-k]);
+        dst[x] = sum;
+    }
+}
+
+static void gaussianColumn_c(const float *const *rows, float *dst, int n, const float *weights)
+{
+    for (int x = 0; x < n; x++) {
+        float sum = weights[5] * rows[5][x];
+        for (int k = 0; k < 5; k++)
+            sum += weights[k] * (rows[k][x] + rows[10-k][x]);
+        dst[x] = sum;
+    }
+}
+
+static void ssimRow_c(const float *const *means, float *ssim, float *cs, int n, float c1, float c2)
+{
+    for (int x = 0; x < n; x++) {
+        const float meanA = means[0][x];
+        const float meanB = means[1][x];
+        const float meanProduct = meanA * meanB;
+        const float meanSquares = meanA * meanA + meanB * meanB;
+        const float luminance = (2.0f * meanProduct + c1) / (meanSquares + c1);
+        cs[x] = (2.0f * (means[3][x] - meanProduct) + c2) / ((means[2][x] - meanSquares) + c2);
+        ssim[x] = luminance * cs[x];
+    }
+}
+
+#if YUVIEW_X86_SIMD
+
+// The 8 bit kernels add the squares in 32 bit lanes. Each iteration adds at most 2*2*255^2 to a lane,
+// so the lanes are moved to the 64 bit sum before they can overflow.
+#define SSE8_FLUSH_ITERATIONS 4096
+
+/////////////////////////////////////////////////////////////////////////////
+// SSE4.1 - 16 samples per iteration (4 for the Gaussian filters)
+
+YUVIEW_TARGET_SSE41 static inline __m128i widenAdd64_sse41(__m128i sum64, __m128i lanes32)
+{
+    sum64 = _mm_add_epi64(sum64, _mm_cvtepu32_epi64(lanes32));
+    return _mm_add_epi64(sum64, _mm_cvtepu32_epi64(_mm_srli_si128(lanes32, 8)));
+}
+
+YUVIEW_TARGET_SSE41 static inline quint64 horizontalSum64_sse41(__m128i sum64)
+{
+    quint64 lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, sum64);
+    return lanes[0] + lanes[1];
+}
+
+YUVIEW_TARGET_SSE41 static quint64 sse8_sse41(const unsigned char *srcA, const unsigned char *srcB, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum64 = _mm_setzero_si128();
+    __m128i sum32 = _mm_setzero_si128();
+
+    int i = 0;
+    int iterations = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(srcA + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(srcB + i));
+        const __m128i diffLo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        const __m128i diffHi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        sum32 = _mm_add_epi32(sum32, _mm_add_epi32(_mm_madd_epi16(diffLo, diffLo), _mm_madd_epi16(diffHi, diffHi)));
+
+        if (++iterations == SSE8_FLUSH_ITERATIONS) {
+            sum64 = widenAdd64_sse41(sum64, sum32);
+            sum32 = _mm_setzero_si128();
+            iterations = 0;
+        }
+    }
+    sum64 = widenAdd64_sse41(sum64, sum32);
+
+    return horizontalSum64_sse41(sum64) + sse8_c(srcA + i, srcB + i, n - i);
+}
+
+// 16 bit samples: the absolute differences are squared to 64 bit (no overflow for any bit depth)
+YUVIEW_TARGET_SSE41 static quint64 sse16_sse41(const unsigned short *srcA, const unsigned short *srcB, int n)
+{
+    __m128i sum64 = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i a = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(srcA + i)));
+        const __m128i b = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(srcB + i)));
+        const __m128i diff = _mm_abs_epi32(_mm_sub_epi32(a, b));
+        sum64 = _mm_add_epi64(sum64, _mm_mul_epu32(diff, diff));
+        const __m128i diffOdd = _mm_srli_epi64(diff, 32);
+        sum64 = _mm_add_epi64(sum64, _mm_mul_epu32(diffOdd, diffOdd));
+    }
+
+    return horizontalSum64_sse41(sum64) + sse16_c(srcA + i, srcB + i, n - i);
+}
+
+YUVIEW_TARGET_SSE41 static void gaussianRow_sse41(const float *src, float *dst, int n, const float *weights)
+{
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[5]), _mm_loadu_ps(src + x + 5));
+        for (int k = 0; k < 5; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_add_ps(_mm_loadu_ps(src + x + k), _mm_loadu_ps(src + x + 10 - k))));
+        _mm_storeu_ps(dst + x, sum);
+    }
+    gaussianRow_c(src + x, dst + x, n - x, weights);
+}
+
+YUVIEW_TARGET_SSE41 static void gaussianColumn_sse41(const float *const *rows, float *dst, int n, const float *weights)
+{
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[5]), _mm_loadu_ps(rows[5] + x));
+        for (int k = 0; k < 5; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_add_ps(_mm_loadu_ps(rows[k] + x), _mm_loadu_ps(rows[10-k] + x))));
+        _mm_storeu_ps(dst + x, sum);
+    }
+
+    const float *tailRows[11];
+    for (int k = 0; k < 11; k++)
+        tailRows[k] = rows[k] + x;
+    gaussianColumn_c(tailRows, dst + x, n - x, weights);
+}
+
+YUVIEW_TARGET_SSE41 static void ssimRow_sse41(const float *const *means, float *ssim, float *cs, int n, float c1, float c2)
+{
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 c1s = _mm_set1_ps(c1);
+    const __m128 c2s = _mm_set1_ps(c2);
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        const __m128 meanA = _mm_loadu_ps(means[0] + x);
+        const __m128 meanB = _mm_loadu_ps(means[1] + x);
+        const __m128 meanProduct = _mm_mul_ps(meanA, meanB);
+        const __m128 meanSquares = _mm_add_ps(_mm_mul_ps(meanA, meanA), _mm_mul_ps(meanB, meanB));
+        const __m128 luminance = _mm_div_ps(_mm_add_ps(_mm_mul_ps(two, meanProduct), c1s), _mm_add_ps(meanSquares, c1s));
+        const __m128 covariance = _mm_sub_ps(_mm_loadu_ps(means[3] + x), meanProduct);
+        const __m128 variances = _mm_sub_ps(_mm_loadu_ps(means[2] + x), meanSquares);
+        const __m128 contrastStructure = _mm_div_ps(_mm_add_ps(_mm_mul_ps(two, covariance), c2s), _mm_add_ps(variances, c2s));
+        _mm_storeu_ps(cs + x, contrastStructure);
+        _mm_storeu_ps(ssim + x, _mm_mul_ps(luminance, contrastStructure));
+    }
+
+    const float *tailMeans[4] = { means[0] + x, means[1] + x, means[2] + x, means[3] + x };
+    ssimRow_c(tailMeans, ssim + x, cs + x, n - x, c1, c2);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AVX2 - 32 samples (8 bit) or 8 samples (16 bit and the Gaussian filters) per iteration
+
+YUVIEW_TARGET_AVX2 static inline __m256i widenAdd64_avx2(__m256i sum64, __m256i lanes32)
+{
+    sum64 = _mm256_add_epi64(sum64, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(lanes32)));
+    return _mm256_add_epi64(sum64, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(lanes32, 1)));
+}
+
+YUVIEW_TARGET_AVX2 static inline quint64 horizontalSum64_avx2(__m256i sum64)
+{
+    quint64 lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, sum64);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+YUVIEW_TARGET_AVX2 static quint64 sse8_avx2(const unsigned char *srcA, const unsigned char *srcB, int n)
+{
+    __m256i sum64 = _mm256_setzero_si256();
+    __m256i sum32 = _mm256_setzero_si256();
+
+    int i = 0;
+    int iterations = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i diffLo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcA + i))), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcB + i))));
+        const __m256i diffHi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcA + i + 16))), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcB + i + 16))));
+        sum32 = _mm256_add_epi32(sum32, _mm256_add_epi32(_mm256_madd_epi16(diffLo, diffLo), _mm256_madd_epi16(diffHi, diffHi)));
+
+        if (++iterations == SSE8_FLUSH_ITERATIONS) {
+            sum64 = widenAdd64_avx2(sum64, sum32);
+            sum32 = _mm256_setzero_si256();
+            iterations = 0;
+        }
+    }
+    sum64 = widenAdd64_avx2(sum64, sum32);
+
+    return horizontalSum64_avx2(sum64) + sse8_c(srcA + i, srcB + i, n - i);
+}
+
+YUVIEW_TARGET_AVX2 static quint64 sse16_avx2(const unsigned short *srcA, const unsigned short *srcB, int n)
+{
+    __m256i sum64 = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(srcA + i)));
+        const __m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(srcB + i)));
+        const __m256i diff = _mm256_abs_epi32(_mm256_sub_epi32(a, b));
+        sum64 = _mm256_add_epi64(sum64, _mm256_mul_epu32(diff, diff));
+        const __m256i diffOdd = _mm256_srli_epi64(diff, 32);
+        sum64 = _mm256_add_epi64(sum64, _mm256_mul_epu32(diffOdd, diffOdd));
+    }
+
+    return horizontalSum64_avx2(sum64) + sse16_c(srcA + i, srcB + i, n - i);
+}
+
+YUVIEW_TARGET_AVX2 static void gaussianRow_avx2(const float *src, float *dst, int n, const float *weights)
+{
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[5]), _mm256_loadu_ps(src + x + 5));
+        for (int k = 0; k < 5; k++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_add_ps(_mm256_loadu_ps(src + x + k), _mm256_loadu_ps(src + x + 10 - k))));
+        _mm256_storeu_ps(dst + x, sum);
+    }
+    gaussianRow_c(src + x, dst + x, n - x, weights);
+}
+
+YUVIEW_TARGET_AVX2 static void gaussianColumn_avx2(const float *const *rows, float *dst, int n, const float *weights)
+{
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[5]), _mm256_loadu_ps(rows[5] + x));
+        for (int k = 0; k < 5; k++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_add_ps(_mm256_loadu_ps(rows[k] + x), _mm256_loadu_ps(rows[10-k] + x))));
+        _mm256_storeu_ps(dst + x, sum);
+    }
+
+    const float *tailRows[11];
+    for (int k = 0; k < 11; k++)
+        tailRows[k] = rows[k] + x;
+    gaussianColumn_c(tailRows, dst + x, n - x, weights);
+}
+
+YUVIEW_TARGET_AVX2 static void ssimRow_avx2(const float *const *means, float *ssim, float *cs, int n, float c1, float c2)
+{
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 c1s = _mm256_set1_ps(c1);
+    const __m256 c2s = _mm256_set1_ps(c2);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        const __m256 meanA = _mm256_loadu_ps(means[0] + x);
+        const __m256 meanB = _mm256_loadu_ps(means[1] + x);
+        const __m256 meanProduct = _mm256_mul_ps(meanA, meanB);
+        const __m256 meanSquares = _mm256_add_ps(_mm256_mul_ps(meanA, meanA), _mm256_mul_ps(meanB, meanB));
+        const __m256 luminance = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(two, meanProduct), c1s), _mm256_add_ps(meanSquares, c1s));
+        const __m256 covariance = _mm256_sub_ps(_mm256_loadu_ps(means[3] + x), meanProduct);
+        const __m256 variances = _mm256_sub_ps(_mm256_loadu_ps(means[2] + x), meanSquares);
+        const __m256 contrastStructure = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(two, covariance), c2s), _mm256_add_ps(variances, c2s));
+        _mm256_storeu_ps(cs + x, contrastStructure);
+        _mm256_storeu_ps(ssim + x, _mm256_mul_ps(luminance, contrastStructure));
+    }
+
+    const float *tailMeans[4] = { means[0] + x, means[1] + x, means[2] + x, means[3] + x };
+    ssimRow_c(tailMeans, ssim + x, cs + x, n - x, c1, c2);
+}
+
+#endif // YUVIEW_X86_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// dispatch
+
+static const QualityMetricKernels g_kernelsScalar = { sse8_c, sse16_c, gaussianRow_c, gaussianColumn_c, ssimRow_c, "scalar" };
+#if YUVIEW_X86_SIMD
+static const QualityMetricKernels g_kernelsSSE41 = { sse8_sse41, sse16_sse41, gaussianRow_sse41, gaussianColumn_sse41, ssimRow_sse41, "SSE4.1" };
+static const QualityMetricKernels g_kernelsAVX2 = { sse8_avx2, sse16_avx2, gaussianRow_avx2, gaussianColumn_avx2, ssimRow_avx2, "AVX2" };
+#endif
+
+static const QualityMetricKernels &selectKernels()
+{
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsAVX2())
+        return g_kernelsAVX2;
+    if (cpuSupportsSSE41())
+        return g_kernelsSSE41;
+#endif
+    return g_kernelsScalar;
+}
+
+const QualityMetricKernels &qualityMetricKernels()
+{
+    static const QualityMetricKernels &kernels = selectKernels();
+    return kernels;
+}
+
+const QualityMetricKernels &qualityMetricKernelsScalar()
+{
+    return g_kernelsScalar;
+}
+
+const QualityMetricKernels *qualityMetricKernelsSupported(int i)
+{
+    const QualityMetricKernels *supported[3];
+    int count = 0;
+    supported[count++] = &g_kernelsScalar;
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsSSE41())
+        supported[count++] = &g_kernelsSSE41;
+    if (cpuSupportsAVX2())
+        supported[count++] = &g_kernelsAVX2;
+#endif
+    return (i >= 0 && i < count) ? supported[i] : NULL;
+}
+
+double psnrFromMSE(double mse, int bps, double maxPSNR)
+{
+    if (mse <= 0.0)
+        return maxPSNR;
+
+    const double maxValue = (double)((1 << bps) - 1);
+    const double psnr = 10.0 * log10(maxValue * maxValue / mse);
+    return (psnr > maxPSNR) ? maxPSNR : psnr;
+}
+
+quint64 planeSSE(const char *srcA, const char *srcB, int width, int height, int bytesPerSample)
+{
+    const QualityMetricKernels &kernels = qualityMetricKernels();
+    quint64 sum = 0;
+    for (int y = 0; y < height; y++) {
+        const qint64 rowOffset = (qint64)y * width * bytesPerSample;
+        if (bytesPerSample == 1)
+            sum += kernels.sse8((const unsigned char*)(srcA + rowOffset), (const unsigned char*)(srcB + rowOffset), width);
+        else
+            sum += kernels.sse16((const unsigned short*)(srcA + rowOffset), (const unsigned short*)(srcB + rowOffset), width);
+    }
+    return sum;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SSIM
+
+// sums of a 4x4 block: a, b, a*a + b*b and a*b
+struct SSIMBlockSums
+{
+    qint64 sumA;
+    qint64 sumB;
+    qint64 sumSquares;
+    qint64 sumProducts;
+};
+
+template <typename T>
+static void ssimBlockRow(const T *srcA, const T *srcB, int width, int blockRow, int blocksX, SSIMBlockSums *sums)
+{
+    for (int blockX = 0; blockX < blocksX; blockX++) {
+        SSIMBlockSums s = { 0, 0, 0, 0 };
+        for (int y = 0; y < 4; y++) {
+            const qint64 rowOffset = (qint64)(blockRow*4 + y) * width + blockX*4;
+            for (int x = 0; x < 4; x++) {
+                const qint64 a = srcA[rowOffset + x];
+                const qint64 b = srcB[rowOffset + x];
+                s.sumA += a;
+                s.sumB += b;
+                s.sumSquares += a*a + b*b;
+                s.sumProducts += a*b;
+            }
+        }
+        sums[blockX] = s;
+    }
+}
+
+// Mean SSIM and mean contrast-structure term of the 8x8 windows (2x2 blocks of 4x4 samples, so the
+// windows overlap by 4 samples). Returns false if the plane is smaller than one window.
+template <typename T>
+static bool ssimPlane(const T *srcA, const T *srcB, int width, int height, int bps, double *ssim, double *cs)
+{
+    const int blocksX = width / 4;
+    const int blocksY = height / 4;
+    if (blocksX < 2 || blocksY < 2)
+        return false;
+
+    const double maxValue = (double)((1 << bps) - 1);
+    const double c1 = (0.01 * maxValue) * (0.01 * maxValue);
+    const double c2 = (0.03 * maxValue) * (0.03 * maxValue);
+
+    // the block sums of the previous and the current block row
+    QVector<SSIMBlockSums> blockSums(2 * blocksX);
+    double sumSSIM = 0.0;
+    double sumCS = 0.0;
+
+    for (int blockY = 0; blockY < blocksY; blockY++) {
+        SSIMBlockSums *current = blockSums.data() + (blockY & 1) * blocksX;
+        const SSIMBlockSums *previous = blockSums.constData() + ((blockY + 1) & 1) * blocksX;
+        ssimBlockRow(srcA, srcB, width, blockY, blocksX, current);
+        if (blockY == 0)
+            continue;
+
+        for (int blockX = 0; blockX < blocksX - 1; blockX++) {
+            const double n = 64.0;
+            const double sumA = (double)(previous[blockX].sumA + previous[blockX+1].sumA + current[blockX].sumA + current[blockX+1].sumA);
+            const double sumB = (double)(previous[blockX].sumB + previous[blockX+1].sumB + current[blockX].sumB + current[blockX+1].sumB);
+            const double sumSquares = (double)(previous[blockX].sumSquares + previous[blockX+1].sumSquares + current[blockX].sumSquares + current[blockX+1].sumSquares);
+            const double sumProducts = (double)(previous[blockX].sumProducts + previous[blockX+1].sumProducts + current[blockX].sumProducts + current[blockX+1].sumProducts);
+
+            const double meanA = sumA / n;
+            const double meanB = sumB / n;
+            const double variances = sumSquares / n - meanA*meanA - meanB*meanB;
+            const double covariance = sumProducts / n - meanA*meanB;
+
+            const double luminance = (2.0*meanA*meanB + c1) / (meanA*meanA + meanB*meanB + c1);
+            const double contrastStructure = (2.0*covariance + c2) / (variances + c2);
+            sumSSIM += luminance * contrastStructure;
+            sumCS += contrastStructure;
+        }
+    }
+
+    const double windows = (double)(blocksX - 1) * (double)(blocksY - 1);
+    *ssim = sumSSIM / windows;
+    *cs = sumCS / windows;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// MS-SSIM (Wang, Simoncelli and Bovik 2003): SSIM of an 11x11 Gaussian window (sigma 1.5) at every position
+// inside the plane. Between the scales the planes are low-pass filtered with a 2x2 average and subsampled by 2.
+
+#define MSSSIM_SCALES 5
+#define MSSSIM_WINDOW 11
+
+// the maps which are filtered with the Gaussian window: a, b, a*a + b*b and a*b (SSIM only needs the sum of the
+// variances)
+#define MSSSIM_MAPS 4
+
+static void gaussianWindow(float *weights)
+{
+    double window[MSSSIM_WINDOW];
+    double sum = 0.0;
+    for (int i = 0; i < MSSSIM_WINDOW; i++) {
+        const double d = (double)(i - MSSSIM_WINDOW / 2);
+        window[i] = exp(-d*d / (2.0 * 1.5 * 1.5));
+        sum += window[i];
+    }
+    for (int i = 0; i < MSSSIM_WINDOW; i++)
+        weights[i] = (float)(window[i] / sum);
+}
+
+template <typename T>
+static void mapRows(const T *srcA, const T *srcB, int width, float *const *maps)
+{
+    for (int x = 0; x < width; x++) {
+        const float a = (float)srcA[x];
+        const float b = (float)srcB[x];
+        maps[0][x] = a;
+        maps[1][x] = b;
+        maps[2][x] = a*a + b*b;
+        maps[3][x] = a * b;
+    }
+}
+
+// Mean SSIM and mean contrast-structure term of the Gaussian windows. Returns false if the plane is smaller than
+// one window.
+template <typename T>
+static bool gaussianSSIMPlane(const T *srcA, const T *srcB, int width, int height, int bps, double *ssim, double *cs)
+{
+    if (width < MSSSIM_WINDOW || height < MSSSIM_WINDOW)
+        return false;
+
+    const QualityMetricKernels &kernels = qualityMetricKernels();
+    const int outWidth = width - MSSSIM_WINDOW + 1;
+    const int outHeight = height - MSSSIM_WINDOW + 1;
+    float weights[MSSSIM_WINDOW];
+    gaussianWindow(weights);
+
+    const float maxValue = (float)((1 << bps) - 1);
+    const float c1 = (0.01f * maxValue) * (0.01f * maxValue);
+    const float c2 = (0.03f * maxValue) * (0.03f * maxValue);
+
+    // One row of the maps, the horizontally filtered rows of the current window position (row y of map m is
+    // at m * MSSSIM_WINDOW + y % MSSSIM_WINDOW), the filtered windows of the position and their SSIM terms.
+    QVector<float> rowBuffer(MSSSIM_MAPS * width);
+    QVector<float> filteredRows(MSSSIM_MAPS * MSSSIM_WINDOW * outWidth);
+    QVector<float> windowBuffer(MSSSIM_MAPS * outWidth);
+    QVector<float> ssimBuffer(2 * outWidth);
+    float *ssimValues = ssimBuffer.data();
+    float *csValues = ssimBuffer.data() + outWidth;
+    float *row[MSSSIM_MAPS];
+    float *window[MSSSIM_MAPS];
+    for (int m = 0; m < MSSSIM_MAPS; m++) {
+        row[m] = rowBuffer.data() + m * width;
+        window[m] = windowBuffer.data() + m * outWidth;
+    }
+
+    double sumSSIM = 0.0;
+    double sumCS = 0.0;
+    for (int y = 0; y < height; y++) {
+        const qint64 rowOffset = (qint64)y * width;
+        mapRows(srcA + rowOffset, srcB + rowOffset, width, row);
+        for (int m = 0; m < MSSSIM_MAPS; m++)
+            kernels.gaussianRow(row[m], filteredRows.data() + (m * MSSSIM_WINDOW + y % MSSSIM_WINDOW) * outWidth, outWidth, weights);
+        if (y < MSSSIM_WINDOW - 1)
+            continue;
+
+        // vertical pass over the rows y - MSSSIM_WINDOW + 1 to y
+        for (int m = 0; m < MSSSIM_MAPS; m++) {
+            const float *rows[MSSSIM_WINDOW];
+            for (int k = 0; k < MSSSIM_WINDOW; k++)
+                rows[k] = filteredRows.constData() + (m * MSSSIM_WINDOW + (y - MSSSIM_WINDOW + 1 + k) % MSSSIM_WINDOW) * outWidth;
+            kernels.gaussianColumn(rows, window[m], outWidth, weights);
+        }
+
+        kernels.ssimRow(window, ssimValues, csValues, outWidth, c1, c2);
+        for (int x = 0; x < outWidth; x++) {
+            sumSSIM += ssimValues[x];
+            sumCS += csValues[x];
+        }
+    }
+
+    const double windows = (double)outWidth * (double)outHeight;
+    *ssim = sumSSIM / windows;
+    *cs = sumCS / windows;
+    return true;
+}
+
+// Average of 2x2 samples, subsampled by 2. The last row and column of odd sizes are mirrored like in the reference
+// implementation (symmetric 2x2 filter, then every second sample), so the plane gets (width+1)/2 x (height+1)/2.
+template <typename T>
+static void downsamplePlane(const T *src, int width, int height, QVector<float> &dst)
+{
+    const int dstWidth = (width + 1) / 2;
+    const int dstHeight = (height + 1) / 2;
+    dst.resize(dstWidth * dstHeight);
+    float *out = dst.data();
+    for (int y = 0; y < dstHeight; y++) {
+        const T *row0 = src + (qint64)(2*y) * width;
+        const T *row1 = (2*y + 1 < height) ? row0 + width : row0;
+        for (int x = 0; x < dstWidth; x++) {
+            const int x1 = (2*x + 1 < width) ? 2*x + 1 : 2*x;
+            out[y*dstWidth + x] = ((float)row0[2*x] + (float)row0[x1] + (float)row1[2*x] + (float)row1[x1]) * 0.25f;
+        }
+    }
+}
+
+template <typename T>
+static double msssimPlane(const T *srcA, const T *srcB, int width, int height, int bps)
+{
+    static const double weights[MSSSIM_SCALES] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+
+    double csValues[MSSSIM_SCALES];
+    double ssim;
+    if (!gaussianSSIMPlane(srcA, srcB, width, height, bps, &ssim, &csValues[0]))
+        return std::numeric_limits<double>::quiet_NaN();
+
+    // the further scales as long as they hold one window (the full 5 scales need 176x176 samples)
+    int scales = 1;
+    QVector<float> scaledA, scaledB;
+    while (scales < MSSSIM_SCALES && (width + 1) / 2 >= MSSSIM_WINDOW && (height + 1) / 2 >= MSSSIM_WINDOW) {
+        if (scales == 1) {
+            downsamplePlane(srcA, width, height, scaledA);
+            downsamplePlane(srcB, width, height, scaledB);
+        } else {
+            QVector<float> nextA, nextB;
+            downsamplePlane(scaledA.constData(), width, height, nextA);
+            downsamplePlane(scaledB.constData(), width, height, nextB);
+            scaledA = nextA;
+            scaledB = nextB;
+        }
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+
+        gaussianSSIMPlane(scaledA.constData(), scaledB.constData(), width, height, bps, &ssim, &csValues[scales]);
+        scales++;
+    }
+
+    // the weights of the used scales are scaled to the sum of all weights (which is 1.0001 in the reference)
+    double usedWeights = 0.0;
+    double allWeights = 0.0;
+    for (int i = 0; i < MSSSIM_SCALES; i++) {
+        if (i < scales)
+            usedWeights += weights[i];
+        allWeights += weights[i];
+    }
+    const double weightScale = allWeights / usedWeights;
+
+    // contrast-structure of all scales, luminance only of the coarsest (negative terms count as 0)
+    double msssim = pow(qMax(ssim, 0.0), weights[scales-1] * weightScale);
+    for (int i = 0; i < scales - 1; i++)
+        msssim *= pow(qMax(csValues[i], 0.0), weights[i] * weightScale);
+    return msssim;
+}
+
+double planeSSIM(const char *srcA, const char *srcB, int width, int height, int bytesPerSample, int bps)
+{
+    double ssim, cs;
+    bool valid;
+    if (bytesPerSample == 1)
+        valid = ssimPlane((const unsigned char*)srcA, (const unsigned char*)srcB, width, height, bps, &ssim, &cs);
+    else
+        valid = ssimPlane((const unsigned short*)srcA, (const unsigned short*)srcB, width, height, bps, &ssim, &cs);
+    return valid ? ssim : std::numeric_limits<double>::quiet_NaN();
+}
+
+double planeMSSSIM(const char *srcA, const char *srcB, int width, int height, int bytesPerSample, int bps)
+{
+    if (bytesPerSample == 1)
+        return msssimPlane((const unsigned char*)srcA, (const unsigned char*)srcB, width, height, bps);
+    return msssimPlane((const unsigned short*)srcA, (const unsigned short*)srcB, width, height, bps);
+}
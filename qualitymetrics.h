@@ -0,0 +1,64 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QUALITYMETRICS_H
+#define QUALITYMETRICS_H
+
+#include <QtGlobal>
+
+// Kernels for objective quality metrics of two planes.
+// All implementations produce bit identical results. The scalar versions are the reference.
+struct QualityMetricKernels
+{
+    // sum of squared differences of n samples
+    quint64 (*sse8)(const unsigned char *srcA, const unsigned char *srcB, int n);
+    quint64 (*sse16)(const unsigned short *srcA, const unsigned short *srcB, int n);
+    // symmetric 11 tap filter (the Gaussian window of MS-SSIM) for n outputs, horizontal over src[x] to src[x+10]
+    // and vertical over rows[0][x] to rows[10][x]
+    void (*gaussianRow)(const float *src, float *dst, int n, const float *weights);
+    void (*gaussianColumn)(const float *const *rows, float *dst, int n, const float *weights);
+    // SSIM and contrast-structure term of n windows from the filtered means of a, b, a*a + b*b and a*b
+    void (*ssimRow)(const float *const *means, float *ssim, float *cs, int n, float c1, float c2);
+
+    const char *name;
+};
+
+// kernels for the best instruction set supported by this CPU (selected once at first call)
+const QualityMetricKernels &qualityMetricKernels();
+
+// scalar reference kernels
+const QualityMetricKernels &qualityMetricKernelsScalar();
+
+// The kernels of every instruction set supported by this CPU, starting with the scalar reference (for tests).
+// Returns NULL if i is not smaller than the number of supported instruction sets.
+const QualityMetricKernels *qualityMetricKernelsSupported(int i);
+
+// PSNR in dB of a mean squared error for samples with bps bits. Identical planes (mse 0) get maxPSNR.
+double psnrFromMSE(double mse, int bps, double maxPSNR = 100.0);
+
+// Metrics of two planes of width x height samples without padding. The samples are unsigned char
+// (bytesPerSample 1) or unsigned short (bytesPerSample 2) with bps significant bits.
+quint64 planeSSE(const char *srcA, const char *srcB, int width, int height, int bytesPerSample);
+// Mean SSIM over 8x8 windows with a step of 4 samples. Planes smaller than one window give NaN.
+double planeSSIM(const char *srcA, const char *srcB, int width, int height, int bytesPerSample, int bps);
+// MS-SSIM of the reference implementation: 11x11 Gaussian window (sigma 1.5) and 2x2 average downsampling over 5
+// scales. Planes smaller than 176x176 use fewer scales (the weights of the used scales are scaled to the sum of all
+// weights), planes smaller than 11x11 give NaN.
+double planeMSSSIM(const char *srcA, const char *srcB, int width, int height, int bytesPerSample, int bps);
+
+#endif // QUALITYMETRICS_H
@@ -0,0 +1,322 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rgbconversion.h"
+#include "cpufeatures.h"
+#include <cstddef>
+
+/////////////////////////////////////////////////////////////////////////////
+// scalar reference
+
+static void convert8_c(const unsigned char *srcY, const unsigned char *srcU, const unsigned char *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef)
+{
+    const int yOffset = 16;
+    const int cZero = 128;
+
+    for (int i = 0; i < n; ++i) {
+        const int Y_tmp = ((int)srcY[i] - yOffset) * coef.yMult;
+        const int U_tmp = (int)srcU[i] - cZero;
+        const int V_tmp = (int)srcV[i] - cZero;
+
+        const int R_tmp = (Y_tmp                       + V_tmp * coef.rvMult ) >> 16;
+        const int G_tmp = (Y_tmp + U_tmp * coef.guMult + V_tmp * coef.gvMult ) >> 16;
+        const int B_tmp = (Y_tmp + U_tmp * coef.buMult                       ) >> 16;
+
+        dst[3*i]   = (R_tmp<0 ? 0 : (R_tmp>255 ? 255 : R_tmp));
+        dst[3*i+1] = (G_tmp<0 ? 0 : (G_tmp>255 ? 255 : G_tmp));
+        dst[3*i+2] = (B_tmp<0 ? 0 : (B_tmp>255 ? 255 : B_tmp));
+    }
+}
+
+static void convert16_c(const unsigned short *srcY, const unsigned short *srcU, const unsigned short *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef, int bps)
+{
+    const int yOffset = 16<<(bps-8);
+    const int cZero = 128<<(bps-8);
+    const int rgbMax = (1<<bps)-1;
+
+    for (int i = 0; i < n; ++i) {
+        long long Y_tmp = ((long long)srcY[i] - yOffset) * coef.yMult;
+        long long U_tmp = (long long)srcU[i] - cZero;
+        long long V_tmp = (long long)srcV[i] - cZero;
+
+        long long R_tmp = (Y_tmp                       + V_tmp * coef.rvMult) >> (8+bps);
+        dst[i*3]   = (R_tmp<0 ? 0 : (R_tmp>rgbMax ? rgbMax : R_tmp))>>(bps-8);
+        long long G_tmp = (Y_tmp + U_tmp * coef.guMult + V_tmp * coef.gvMult) >> (8+bps);
+        dst[i*3+1] = (G_tmp<0 ? 0 : (G_tmp>rgbMax ? rgbMax : G_tmp))>>(bps-8);
+        long long B_tmp = (Y_tmp + U_tmp * coef.buMult                      ) >> (8+bps);
+        dst[i*3+2] = (B_tmp<0 ? 0 : (B_tmp>rgbMax ? rgbMax : B_tmp))>>(bps-8);
+    }
+}
+
+#if YUVIEW_X86_SIMD
+
+// The SIMD versions calculate in 32 bit. For more than 10 bits per sample the products may
+// overflow, so these bit depths (and samples out of the 10 bit range) use the scalar code.
+#define SIMD_MAX_BPS 10
+
+/////////////////////////////////////////////////////////////////////////////
+// SSE4.1 - 16 pixels per iteration
+
+// interleave 16 R, G and B bytes to 48 bytes RGB888
+YUVIEW_TARGET_SSE41 static inline void storeRGB16_sse41(unsigned char *dst, __m128i r, __m128i g, __m128i b)
+{
+    // byte k of the output is channel k%3 of pixel k/3. -1 (0x80) clears the byte.
+    const __m128i r0 = _mm_setr_epi8( 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1, 5);
+    const __m128i g0 = _mm_setr_epi8(-1, 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1);
+    const __m128i b0 = _mm_setr_epi8(-1,-1, 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1);
+    const __m128i r1 = _mm_setr_epi8(-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1,10,-1);
+    const __m128i g1 = _mm_setr_epi8( 5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1,10);
+    const __m128i b1 = _mm_setr_epi8(-1, 5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1);
+    const __m128i r2 = _mm_setr_epi8(-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1);
+    const __m128i g2 = _mm_setr_epi8(-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1);
+    const __m128i b2 = _mm_setr_epi8(10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15);
+
+    _mm_storeu_si128((__m128i*)(dst),    _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(b, b0)));
+    _mm_storeu_si128((__m128i*)(dst+16), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(b, b1)));
+    _mm_storeu_si128((__m128i*)(dst+32), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(b, b2)));
+}
+
+// convert 4 pixels (32 bit each) and return R, G, B before clipping
+YUVIEW_TARGET_SSE41 static inline void yuv2rgb4_sse41(__m128i y, __m128i u, __m128i v, const YUV2RGBCoefficients &coef, __m128i shift, __m128i &r, __m128i &g, __m128i &b)
+{
+    y = _mm_mullo_epi32(y, _mm_set1_epi32(coef.yMult));
+    r = _mm_sra_epi32(_mm_add_epi32(y, _mm_mullo_epi32(v, _mm_set1_epi32(coef.rvMult))), shift);
+    g = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(y, _mm_mullo_epi32(u, _mm_set1_epi32(coef.guMult))), _mm_mullo_epi32(v, _mm_set1_epi32(coef.gvMult))), shift);
+    b = _mm_sra_epi32(_mm_add_epi32(y, _mm_mullo_epi32(u, _mm_set1_epi32(coef.buMult))), shift);
+}
+
+YUVIEW_TARGET_SSE41 static void convert8_sse41(const unsigned char *srcY, const unsigned char *srcU, const unsigned char *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef)
+{
+    const __m128i yOffset = _mm_set1_epi32(16);
+    const __m128i cZero = _mm_set1_epi32(128);
+    const __m128i shift = _mm_cvtsi32_si128(16);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i y8 = _mm_loadu_si128((const __m128i*)(srcY + i));
+        const __m128i u8 = _mm_loadu_si128((const __m128i*)(srcU + i));
+        const __m128i v8 = _mm_loadu_si128((const __m128i*)(srcV + i));
+
+        __m128i r[4], g[4], b[4];
+        for (int k = 0; k < 4; k++) {
+            // the shift amount has to be a constant, so shift by 4 bytes each round
+            const __m128i y = _mm_sub_epi32(_mm_cvtepu8_epi32(k == 0 ? y8 : k == 1 ? _mm_srli_si128(y8, 4) : k == 2 ? _mm_srli_si128(y8, 8) : _mm_srli_si128(y8, 12)), yOffset);
+            const __m128i u = _mm_sub_epi32(_mm_cvtepu8_epi32(k == 0 ? u8 : k == 1 ? _mm_srli_si128(u8, 4) : k == 2 ? _mm_srli_si128(u8, 8) : _mm_srli_si128(u8, 12)), cZero);
+            const __m128i v = _mm_sub_epi32(_mm_cvtepu8_epi32(k == 0 ? v8 : k == 1 ? _mm_srli_si128(v8, 4) : k == 2 ? _mm_srli_si128(v8, 8) : _mm_srli_si128(v8, 12)), cZero);
+            yuv2rgb4_sse41(y, u, v, coef, shift, r[k], g[k], b[k]);
+        }
+
+        // saturating packs clip to [0, 255]
+        const __m128i r8 = _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3]));
+        const __m128i g8 = _mm_packus_epi16(_mm_packs_epi32(g[0], g[1]), _mm_packs_epi32(g[2], g[3]));
+        const __m128i b8 = _mm_packus_epi16(_mm_packs_epi32(b[0], b[1]), _mm_packs_epi32(b[2], b[3]));
+        storeRGB16_sse41(dst + 3*i, r8, g8, b8);
+    }
+    convert8_c(srcY + i, srcU + i, srcV + i, dst + 3*i, n - i, coef);
+}
+
+// clip to [0, rgbMax] and scale down to 8 bit
+YUVIEW_TARGET_SSE41 static inline __m128i clipAndScale_sse41(__m128i x, __m128i rgbMax, __m128i downShift)
+{
+    return _mm_srl_epi32(_mm_min_epi32(_mm_max_epi32(x, _mm_setzero_si128()), rgbMax), downShift);
+}
+
+YUVIEW_TARGET_SSE41 static void convert16_sse41(const unsigned short *srcY, const unsigned short *srcU, const unsigned short *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef, int bps)
+{
+    if (bps > SIMD_MAX_BPS) {
+        convert16_c(srcY, srcU, srcV, dst, n, coef, bps);
+        return;
+    }
+
+    const __m128i yOffset = _mm_set1_epi32(16<<(bps-8));
+    const __m128i cZero = _mm_set1_epi32(128<<(bps-8));
+    const __m128i rgbMax = _mm_set1_epi32((1<<bps)-1);
+    const __m128i maxSample = _mm_set1_epi16((1<<bps)-1);
+    const __m128i shift = _mm_cvtsi32_si128(8+bps);
+    const __m128i downShift = _mm_cvtsi32_si128(bps-8);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i y16[2], u16[2], v16[2];
+        for (int h = 0; h < 2; h++) {
+            y16[h] = _mm_loadu_si128((const __m128i*)(srcY + i + 8*h));
+            u16[h] = _mm_loadu_si128((const __m128i*)(srcU + i + 8*h));
+            v16[h] = _mm_loadu_si128((const __m128i*)(srcV + i + 8*h));
+        }
+
+        // samples out of range could overflow the 32 bit arithmetic
+        const __m128i above = _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_subs_epu16(y16[0], maxSample), _mm_subs_epu16(y16[1], maxSample)),
+                                                        _mm_or_si128(_mm_subs_epu16(u16[0], maxSample), _mm_subs_epu16(u16[1], maxSample))),
+                                           _mm_or_si128(_mm_subs_epu16(v16[0], maxSample), _mm_subs_epu16(v16[1], maxSample)));
+        if (!_mm_testz_si128(above, above)) {
+            convert16_c(srcY + i, srcU + i, srcV + i, dst + 3*i, 16, coef, bps);
+            continue;
+        }
+
+        __m128i r[4], g[4], b[4];
+        for (int k = 0; k < 4; k++) {
+            const int h = k >> 1;
+            const __m128i y = _mm_sub_epi32((k & 1) ? _mm_cvtepu16_epi32(_mm_srli_si128(y16[h], 8)) : _mm_cvtepu16_epi32(y16[h]), yOffset);
+            const __m128i u = _mm_sub_epi32((k & 1) ? _mm_cvtepu16_epi32(_mm_srli_si128(u16[h], 8)) : _mm_cvtepu16_epi32(u16[h]), cZero);
+            const __m128i v = _mm_sub_epi32((k & 1) ? _mm_cvtepu16_epi32(_mm_srli_si128(v16[h], 8)) : _mm_cvtepu16_epi32(v16[h]), cZero);
+            yuv2rgb4_sse41(y, u, v, coef, shift, r[k], g[k], b[k]);
+            r[k] = clipAndScale_sse41(r[k], rgbMax, downShift);
+            g[k] = clipAndScale_sse41(g[k], rgbMax, downShift);
+            b[k] = clipAndScale_sse41(b[k], rgbMax, downShift);
+        }
+
+        const __m128i r8 = _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3]));
+        const __m128i g8 = _mm_packus_epi16(_mm_packs_epi32(g[0], g[1]), _mm_packs_epi32(g[2], g[3]));
+        const __m128i b8 = _mm_packus_epi16(_mm_packs_epi32(b[0], b[1]), _mm_packs_epi32(b[2], b[3]));
+        storeRGB16_sse41(dst + 3*i, r8, g8, b8);
+    }
+    convert16_c(srcY + i, srcU + i, srcV + i, dst + 3*i, n - i, coef, bps);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AVX2 - 16 pixels per iteration, 8 per register
+
+YUVIEW_TARGET_AVX2 static inline void yuv2rgb8_avx2(__m256i y, __m256i u, __m256i v, const YUV2RGBCoefficients &coef, __m128i shift, __m256i &r, __m256i &g, __m256i &b)
+{
+    y = _mm256_mullo_epi32(y, _mm256_set1_epi32(coef.yMult));
+    r = _mm256_sra_epi32(_mm256_add_epi32(y, _mm256_mullo_epi32(v, _mm256_set1_epi32(coef.rvMult))), shift);
+    g = _mm256_sra_epi32(_mm256_add_epi32(_mm256_add_epi32(y, _mm256_mullo_epi32(u, _mm256_set1_epi32(coef.guMult))), _mm256_mullo_epi32(v, _mm256_set1_epi32(coef.gvMult))), shift);
+    b = _mm256_sra_epi32(_mm256_add_epi32(y, _mm256_mullo_epi32(u, _mm256_set1_epi32(coef.buMult))), shift);
+}
+
+// pack 2x8 32 bit values to 16 bytes with unsigned saturation
+YUVIEW_TARGET_AVX2 static inline __m128i pack16_avx2(__m256i lo, __m256i hi)
+{
+    // packs works per 128 bit lane, restore the order of the 64 bit blocks
+    const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+}
+
+YUVIEW_TARGET_AVX2 static void convert8_avx2(const unsigned char *srcY, const unsigned char *srcU, const unsigned char *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef)
+{
+    const __m256i yOffset = _mm256_set1_epi32(16);
+    const __m256i cZero = _mm256_set1_epi32(128);
+    const __m128i shift = _mm_cvtsi32_si128(16);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i r[2], g[2], b[2];
+        for (int h = 0; h < 2; h++) {
+            const __m256i y = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(srcY + i + 8*h))), yOffset);
+            const __m256i u = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(srcU + i + 8*h))), cZero);
+            const __m256i v = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(srcV + i + 8*h))), cZero);
+            yuv2rgb8_avx2(y, u, v, coef, shift, r[h], g[h], b[h]);
+        }
+        storeRGB16_sse41(dst + 3*i, pack16_avx2(r[0], r[1]), pack16_avx2(g[0], g[1]), pack16_avx2(b[0], b[1]));
+    }
+    convert8_sse41(srcY + i, srcU + i, srcV + i, dst + 3*i, n - i, coef);
+}
+
+YUVIEW_TARGET_AVX2 static inline __m256i clipAndScale_avx2(__m256i x, __m256i rgbMax, __m128i downShift)
+{
+    return _mm256_srl_epi32(_mm256_min_epi32(_mm256_max_epi32(x, _mm256_setzero_si256()), rgbMax), downShift);
+}
+
+YUVIEW_TARGET_AVX2 static void convert16_avx2(const unsigned short *srcY, const unsigned short *srcU, const unsigned short *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef, int bps)
+{
+    if (bps > SIMD_MAX_BPS) {
+        convert16_c(srcY, srcU, srcV, dst, n, coef, bps);
+        return;
+    }
+
+    const __m256i yOffset = _mm256_set1_epi32(16<<(bps-8));
+    const __m256i cZero = _mm256_set1_epi32(128<<(bps-8));
+    const __m256i rgbMax = _mm256_set1_epi32((1<<bps)-1);
+    const __m256i maxSample = _mm256_set1_epi16((1<<bps)-1);
+    const __m128i shift = _mm_cvtsi32_si128(8+bps);
+    const __m128i downShift = _mm_cvtsi32_si128(bps-8);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i y16 = _mm256_loadu_si256((const __m256i*)(srcY + i));
+        const __m256i u16 = _mm256_loadu_si256((const __m256i*)(srcU + i));
+        const __m256i v16 = _mm256_loadu_si256((const __m256i*)(srcV + i));
+
+        // samples out of range could overflow the 32 bit arithmetic
+        const __m256i above = _mm256_or_si256(_mm256_or_si256(_mm256_subs_epu16(y16, maxSample), _mm256_subs_epu16(u16, maxSample)), _mm256_subs_epu16(v16, maxSample));
+        if (!_mm256_testz_si256(above, above)) {
+            convert16_c(srcY + i, srcU + i, srcV + i, dst + 3*i, 16, coef, bps);
+            continue;
+        }
+
+        __m256i r[2], g[2], b[2];
+        for (int h = 0; h < 2; h++) {
+            const __m256i y = _mm256_sub_epi32(_mm256_cvtepu16_epi32(h ? _mm256_extracti128_si256(y16, 1) : _mm256_castsi256_si128(y16)), yOffset);
+            const __m256i u = _mm256_sub_epi32(_mm256_cvtepu16_epi32(h ? _mm256_extracti128_si256(u16, 1) : _mm256_castsi256_si128(u16)), cZero);
+            const __m256i v = _mm256_sub_epi32(_mm256_cvtepu16_epi32(h ? _mm256_extracti128_si256(v16, 1) : _mm256_castsi256_si128(v16)), cZero);
+            yuv2rgb8_avx2(y, u, v, coef, shift, r[h], g[h], b[h]);
+            r[h] = clipAndScale_avx2(r[h], rgbMax, downShift);
+            g[h] = clipAndScale_avx2(g[h], rgbMax, downShift);
+            b[h] = clipAndScale_avx2(b[h], rgbMax, downShift);
+        }
+        storeRGB16_sse41(dst + 3*i, pack16_avx2(r[0], r[1]), pack16_avx2(g[0], g[1]), pack16_avx2(b[0], b[1]));
+    }
+    convert16_sse41(srcY + i, srcU + i, srcV + i, dst + 3*i, n - i, coef, bps);
+}
+
+#endif // YUVIEW_X86_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// dispatch
+
+static const RGBConversionKernels g_kernelsScalar = { convert8_c, convert16_c, "scalar" };
+#if YUVIEW_X86_SIMD
+static const RGBConversionKernels g_kernelsSSE41 = { convert8_sse41, convert16_sse41, "SSE4.1" };
+static const RGBConversionKernels g_kernelsAVX2 = { convert8_avx2, convert16_avx2, "AVX2" };
+#endif
+
+static const RGBConversionKernels &selectKernels()
+{
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsAVX2())
+        return g_kernelsAVX2;
+    if (cpuSupportsSSE41())
+        return g_kernelsSSE41;
+#endif
+    return g_kernelsScalar;
+}
+
+const RGBConversionKernels &rgbConversionKernels()
+{
+    static const RGBConversionKernels &kernels = selectKernels();
+    return kernels;
+}
+
+const RGBConversionKernels &rgbConversionKernelsScalar()
+{
+    return g_kernelsScalar;
+}
+
+const RGBConversionKernels *rgbConversionKernelsSupported(int i)
+{
+    const RGBConversionKernels *supported[3];
+    int count = 0;
+    supported[count++] = &g_kernelsScalar;
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsSSE41())
+        supported[count++] = &g_kernelsSSE41;
+    if (cpuSupportsAVX2())
+        supported[count++] = &g_kernelsAVX2;
+#endif
+    return (i >= 0 && i < count) ? supported[i] : NULL;
+}
@@ -0,0 +1,53 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RGBCONVERSION_H
+#define RGBCONVERSION_H
+
+// fixed point multipliers of the YUV to RGB matrix (see typedef.h)
+struct YUV2RGBCoefficients
+{
+    int yMult;
+    int rvMult;
+    int guMult;
+    int gvMult;
+    int buMult;
+};
+
+// Kernels converting n pixels of planar YUV 4:4:4 to interleaved RGB888.
+// All implementations produce bit identical results. The scalar versions are the reference.
+struct RGBConversionKernels
+{
+    void (*convert8)(const unsigned char *srcY, const unsigned char *srcU, const unsigned char *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef);
+    // samples with bps in ]8, 16], coefficients already scaled to bps
+    void (*convert16)(const unsigned short *srcY, const unsigned short *srcU, const unsigned short *srcV, unsigned char *dst, int n, const YUV2RGBCoefficients &coef, int bps);
+
+    const char *name;
+};
+
+// kernels for the best instruction set supported by this CPU (selected once at first call)
+const RGBConversionKernels &rgbConversionKernels();
+
+// scalar reference kernels
+const RGBConversionKernels &rgbConversionKernelsScalar();
+
+// The kernels of every instruction set supported by this CPU, starting with the scalar reference (for tests).
+// Returns NULL if i is not smaller than the number of supported instruction sets.
+const RGBConversionKernels *rgbConversionKernelsSupported(int i);
+
+#endif // RGBCONVERSION_H
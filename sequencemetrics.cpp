@@ -0,0 +1,195 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sequencemetrics.h"
+#include "qualitymetrics.h"
+
+#include <QtConcurrent>
+#include <QFile>
+#include <QTextStream>
+#include <limits>
+
+SequenceMetrics::SequenceMetrics(YUVFile *firstFile, YUVFile *secondFile, int width, int height)
+{
+    p_files[0] = firstFile;
+    p_files[1] = secondFile;
+    p_width = width;
+    p_height = height;
+    p_startFrame = 0;
+    p_cancel = false;
+}
+
+SequenceMetrics::~SequenceMetrics()
+{
+    cancel();
+}
+
+void SequenceMetrics::start(int startFrame, int endFrame)
+{
+    cancel();
+
+    p_startFrame = startFrame;
+    p_results.fill(FrameMetrics(), qMax(0, endFrame - startFrame + 1));
+    p_framesDone = 0;
+    p_cancel = false;
+    p_future = QtConcurrent::run(this, &SequenceMetrics::worker);
+}
+
+void SequenceMetrics::cancel()
+{
+    if (p_future.isRunning())
+    {
+        // signal to background thread that we want to cancel the processing
+        p_cancel = true;
+        p_future.waitForFinished();
+    }
+}
+
+void SequenceMetrics::worker()
+{
+    // the frames are independent, so they are processed in parallel (frames take about the same time)
+    FrameMetrics *results = p_results.data();
+    SequenceMetrics *metrics = this;
+    int numFrames = p_results.count();
+    int startFrame = p_startFrame;
+
+    int i;
+#pragma omp parallel for default(none) private(i) shared(results,metrics,numFrames,startFrame) schedule(dynamic)
+    for (i = 0; i < numFrames; i++)
+    {
+        if (metrics->p_cancel)
+            continue;
+
+        results[i] = metrics->computeFrameMetrics(startFrame + i);
+        metrics->p_framesDone.ref();
+    }
+}
+
+FrameMetrics SequenceMetrics::computeFrameMetrics(int frameIdx)
+{
+    FrameMetrics metrics;
+    metrics.frameIdx = frameIdx;
+    metrics.valid = false;
+    for (int c = 0; c < 3; c++)
+        metrics.psnr[c] = metrics.ssim[c] = metrics.msssim[c] = std::numeric_limits<double>::quiet_NaN();
+
+    const int bitDepth = YUVFile::bitsPerSample(p_files[0]->pixelFormat());
+    if (YUVFile::bitsPerSample(p_files[1]->pixelFormat()) != bitDepth)
+        return metrics;
+
+    QByteArray frameBuffers[2];
+    YUVPlanes planes[2];
+    if (!p_files[0]->getPlanes(&frameBuffers[0], frameIdx, p_width, p_height, &planes[0]) ||
+        !p_files[1]->getPlanes(&frameBuffers[1], frameIdx, p_width, p_height, &planes[1]) ||
+        planes[0].bytesPerSample != planes[1].bytesPerSample)
+        return metrics;
+
+    metrics.valid = true;
+    for (int c = 0; c < 3; c++)
+    {
+        // the chroma planes only compare if both files have the same subsampling
+        if (planes[0].data[c] == NULL || planes[1].data[c] == NULL || planes[0].width[c] != planes[1].width[c] || planes[0].height[c] != planes[1].height[c])
+            continue;
+
+        const int width = planes[0].width[c];
+        const int height = planes[0].height[c];
+        const quint64 sse = planeSSE(planes[0].data[c], planes[1].data[c], width, height, planes[0].bytesPerSample);
+        metrics.psnr[c] = psnrFromMSE((double)sse / ((double)width * height), bitDepth);
+        metrics.ssim[c] = planeSSIM(planes[0].data[c], planes[1].data[c], width, height, planes[0].bytesPerSample, bitDepth);
+        metrics.msssim[c] = planeMSSSIM(planes[0].data[c], planes[1].data[c], width, height, planes[0].bytesPerSample, bitDepth);
+    }
+
+    return metrics;
+}
+
+FrameMetrics SequenceMetrics::average()
+{
+    FrameMetrics average;
+    average.frameIdx = INT_INVALID;
+    average.valid = false;
+
+    // mean of the per frame values (frames which were not read or planes without a value are skipped)
+    double sums[3][3] = { { 0 } };
+    int counts[3][3] = { { 0 } };
+    foreach (const FrameMetrics &metrics, p_results)
+    {
+        if (!metrics.valid)
+            continue;
+
+        average.valid = true;
+        for (int c = 0; c < 3; c++)
+        {
+            const double values[3] = { metrics.psnr[c], metrics.ssim[c], metrics.msssim[c] };
+            for (int m = 0; m < 3; m++)
+            {
+                if (values[m] == values[m])     // not NaN
+                {
+                    sums[m][c] += values[m];
+                    counts[m][c]++;
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        average.psnr[c] = counts[0][c] ? sums[0][c] / counts[0][c] : std::numeric_limits<double>::quiet_NaN();
+        average.ssim[c] = counts[1][c] ? sums[1][c] / counts[1][c] : std::numeric_limits<double>::quiet_NaN();
+        average.msssim[c] = counts[2][c] ? sums[2][c] / counts[2][c] : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return average;
+}
+
+static QString metricsCSVLine(const QString &frame, const FrameMetrics &metrics)
+{
+    QStringList values;
+    values << frame;
+    for (int c = 0; c < 3; c++)
+        values << QString::number(metrics.psnr[c], 'f', 4);
+    for (int c = 0; c < 3; c++)
+        values << QString::number(metrics.ssim[c], 'f', 6);
+    for (int c = 0; c < 3; c++)
+        values << QString::number(metrics.msssim[c], 'f', 6);
+    return values.join(";");
+}
+
+bool SequenceMetrics::exportCSV(const QString &filePath, QString *error)
+{
+    QFile csvFile(filePath);
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        *error = QString("Could not open %1 for writing.").arg(filePath);
+        return false;
+    }
+
+    QTextStream out(&csvFile);
+    out << "Frame;PSNR Y;PSNR U;PSNR V;SSIM Y;SSIM U;SSIM V;MS-SSIM Y;MS-SSIM U;MS-SSIM V\n";
+    foreach (const FrameMetrics &metrics, p_results)
+        if (metrics.valid)
+            out << metricsCSVLine(QString::number(metrics.frameIdx), metrics) << "\n";
+    out << metricsCSVLine("Average", average()) << "\n";
+
+    out.flush();
+    if (csvFile.error() != QFile::NoError)
+    {
+        *error = QString("Could not write %1.").arg(filePath);
+        return false;
+    }
+    return true;
+}
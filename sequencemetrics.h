@@ -0,0 +1,77 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEQUENCEMETRICS_H
+#define SEQUENCEMETRICS_H
+
+#include <QString>
+#include <QVector>
+#include <QFuture>
+#include <QAtomicInt>
+#include "yuvfile.h"
+
+// metrics of one frame, per plane (Y, U, V). Planes which do not exist (4:0:0) or are too small are NaN.
+struct FrameMetrics
+{
+    int frameIdx;
+    bool valid;     // false if the frame could not be read
+    double psnr[3];
+    double ssim[3];
+    double msssim[3];
+};
+
+// Objective metrics (PSNR, SSIM, MS-SSIM) of all frames of a range of two sequences. The frames are read through
+// YUVFile::getPlanes (from the mapped file if possible) and processed in parallel in the background.
+class SequenceMetrics
+{
+public:
+    SequenceMetrics(YUVFile *firstFile, YUVFile *secondFile, int width, int height);
+    ~SequenceMetrics();
+
+    // compute the frames [startFrame, endFrame] in the background
+    void start(int startFrame, int endFrame);
+    void cancel();
+
+    bool isRunning() { return p_future.isRunning(); }
+    int framesDone() { return p_framesDone.load(); }
+    int frameCount() { return p_results.count(); }
+
+    // the metrics of all frames and their average (only complete if the computation was not cancelled)
+    QVector<FrameMetrics> results() { return p_results; }
+    FrameMetrics average();
+
+    // the per frame metrics and the average as CSV (';' separated). Returns false and sets error on failure.
+    bool exportCSV(const QString &filePath, QString *error);
+
+private:
+    void worker();
+    FrameMetrics computeFrameMetrics(int frameIdx);
+
+    YUVFile *p_files[2];
+    int p_width;
+    int p_height;
+    int p_startFrame;
+
+    QVector<FrameMetrics> p_results;
+
+    QFuture<void> p_future;
+    bool p_cancel;
+    QAtomicInt p_framesDone;
+};
+
+#endif // SEQUENCEMETRICS_H
@@ -0,0 +1,116 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sequencemetricsdialog.h"
+#include "ui_sequencemetricsdialog.h"
+
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QSettings>
+
+SequenceMetricsDialog::SequenceMetricsDialog(FrameObject *firstObject, FrameObject *secondObject, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::SequenceMetricsDialog),
+    p_metrics(firstObject->getYUVFile(), secondObject->getYUVFile(), firstObject->width(), firstObject->height())
+{
+    ui->setupUi(this);
+
+    // the frame range of the first sequence, limited to the frames both sequences have
+    const int startFrame = firstObject->startFrame();
+    const int endFrame = qMin(firstObject->endFrame(), qMin(firstObject->numFrames(), secondObject->numFrames()) - 1);
+
+    ui->infoLabel->setText(QString("%1 - %2, frames %3 to %4").arg(firstObject->name()).arg(secondObject->name()).arg(startFrame).arg(endFrame));
+    ui->progressBar->setMaximum(qMax(1, endFrame - startFrame + 1));
+
+    QStringList header;
+    header << "Frame" << "PSNR Y" << "PSNR U" << "PSNR V" << "SSIM Y" << "SSIM U" << "SSIM V" << "MS-SSIM Y" << "MS-SSIM U" << "MS-SSIM V";
+    ui->metricsTable->setColumnCount(header.count());
+    ui->metricsTable->setHorizontalHeaderLabels(header);
+    ui->metricsTable->verticalHeader()->setVisible(false);
+
+    p_metrics.start(startFrame, endFrame);
+
+    connect(&p_progressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+    p_progressTimer.start(100);
+}
+
+SequenceMetricsDialog::~SequenceMetricsDialog()
+{
+    p_progressTimer.stop();
+    p_metrics.cancel();
+    delete ui;
+}
+
+void SequenceMetricsDialog::updateProgress()
+{
+    ui->progressBar->setValue(p_metrics.framesDone());
+
+    if (!p_metrics.isRunning())
+    {
+        p_progressTimer.stop();
+        showResults();
+    }
+}
+
+static void setMetricsRow(QTableWidget *table, int row, const QString &frame, const FrameMetrics &metrics)
+{
+    table->setItem(row, 0, new QTableWidgetItem(frame));
+    for (int c = 0; c < 3; c++)
+    {
+        table->setItem(row, 1+c, new QTableWidgetItem(QString::number(metrics.psnr[c], 'f', 2)));
+        table->setItem(row, 4+c, new QTableWidgetItem(QString::number(metrics.ssim[c], 'f', 4)));
+        table->setItem(row, 7+c, new QTableWidgetItem(QString::number(metrics.msssim[c], 'f', 4)));
+    }
+}
+
+void SequenceMetricsDialog::showResults()
+{
+    QVector<FrameMetrics> results = p_metrics.results();
+
+    int validFrames = 0;
+    foreach (const FrameMetrics &metrics, results)
+        if (metrics.valid)
+            validFrames++;
+
+    // the average first, then all frames which could be read
+    ui->metricsTable->setRowCount(1 + validFrames);
+    setMetricsRow(ui->metricsTable, 0, "Average", p_metrics.average());
+    int row = 1;
+    foreach (const FrameMetrics &metrics, results)
+        if (metrics.valid)
+            setMetricsRow(ui->metricsTable, row++, QString::number(metrics.frameIdx), metrics);
+    ui->metricsTable->resizeColumnsToContents();
+
+    ui->exportButton->setEnabled(true);
+}
+
+void SequenceMetricsDialog::on_exportButton_clicked()
+{
+    QSettings settings;
+
+    QString csvPath = QFileDialog::getSaveFileName(this, tr("Export Metrics"), settings.value("lastFilePath").toString(), tr("CSV Files (*.csv)"));
+    if (csvPath.isEmpty())
+        return;
+
+    QString error;
+    if (!p_metrics.exportCSV(csvPath, &error))
+        QMessageBox::warning(this, tr("Export failed"), error, QMessageBox::Ok);
+}
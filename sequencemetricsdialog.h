@@ -0,0 +1,52 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEQUENCEMETRICSDIALOG_H
+#define SEQUENCEMETRICSDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+#include "frameobject.h"
+#include "sequencemetrics.h"
+
+namespace Ui {
+class SequenceMetricsDialog;
+}
+
+// Computes PSNR, SSIM and MS-SSIM of two sequences in the background and shows them per frame
+class SequenceMetricsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    SequenceMetricsDialog(FrameObject *firstObject, FrameObject *secondObject, QWidget *parent = 0);
+    ~SequenceMetricsDialog();
+
+private slots:
+    void updateProgress();
+    void on_exportButton_clicked();
+
+private:
+    void showResults();
+
+    Ui::SequenceMetricsDialog *ui;
+    SequenceMetrics p_metrics;
+    QTimer p_progressTimer;
+};
+
+#endif // SEQUENCEMETRICSDIALOG_H
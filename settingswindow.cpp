@@ -90,6 +90,23 @@ unsigned int SettingsWindow::getCacheSizeInMB() {
     return MAX(useMem, MIN_CACHE_SIZE_IN_MB);
 }
 
+int SettingsWindow::getPrefetchDepth() {
+    // read ahead fills the video cache, so it is useless without a cache
+    settings.beginGroup("VideoCache");
+    int depth = settings.value("Enabled", true).toBool() ? settings.value("PrefetchDepth", 8).toInt() : 0;
+    settings.endGroup();
+
+    return depth;
+}
+
+unsigned int SettingsWindow::getStatisticsCacheSizeInMB() {
+    return settings.value("Statistics/CacheSizeInMB", 512).toUInt();
+}
+
+int SettingsWindow::getQualityMapBlockSize() {
+    return settings.value("Statistics/QualityMapBlockSize", 16).toInt();
+}
+
 void SettingsWindow::on_saveButton_clicked()
 {
     if (!saveSettings()) {
@@ -103,10 +120,13 @@ bool SettingsWindow::saveSettings() {
     settings.setValue("Enabled", ui->cacheCheckBox->checkState() == Qt::Checked);
     settings.setValue("UseThreshold", ui->cacheThresholdCheckBox->checkState() == Qt::Checked);
     settings.setValue("ThresholdValue", ui->cacheThresholdSlider->value());
+    settings.setValue("PrefetchDepth", ui->prefetchDepthSpinBox->value());
     settings.endGroup();
 
     settings.setValue("Statistics/Simplify", ui->simplifyCheckBox->isChecked());
     settings.setValue("Statistics/SimplificationSize", ui->simplifySizeSpinBox->value());
+    settings.setValue("Statistics/CacheSizeInMB", ui->statisticsCacheSpinBox->value());
+    settings.setValue("Statistics/QualityMapBlockSize", ui->qualityMapBlockSizeSpinBox->value());
 
     settings.setValue("ClearFrameEnabled",ui->clearFrameCheckBox->isChecked());
 
@@ -120,10 +140,13 @@ bool SettingsWindow::loadSettings() {
     ui->cacheCheckBox->setChecked( settings.value("Enabled", true).toBool() );
     ui->cacheThresholdCheckBox->setChecked( settings.value("UseThreshold", false).toBool() );
     ui->cacheThresholdSlider->setValue( settings.value("ThresholdValue", 49).toInt() );
+    ui->prefetchDepthSpinBox->setValue( settings.value("PrefetchDepth", 8).toInt() );
     settings.endGroup();
 
     ui->simplifyCheckBox->setChecked(settings.value("Statistics/Simplify", false).toBool());
     ui->simplifySizeSpinBox->setValue(settings.value("Statistics/SimplificationSize", 32).toInt());    
+    ui->statisticsCacheSpinBox->setValue(settings.value("Statistics/CacheSizeInMB", 512).toInt());
+    ui->qualityMapBlockSizeSpinBox->setValue(settings.value("Statistics/QualityMapBlockSize", 16).toInt());
     ui->clearFrameCheckBox->setChecked(settings.value("ClearFrameEnabled",false).toBool());
     return true;
 }
@@ -135,6 +158,9 @@ void SettingsWindow::on_cacheThresholdSlider_valueChanged(int value)
 
 void SettingsWindow::on_cacheCheckBox_stateChanged(int)
 {
+    ui->prefetchDepthSpinBox->setEnabled(ui->cacheCheckBox->checkState() == Qt::Checked);
+    ui->prefetchDepthLabel->setEnabled(ui->cacheCheckBox->checkState() == Qt::Checked);
+
     if (ui->cacheCheckBox->checkState() == Qt::Checked)
     {
         ui->cacheThresholdCheckBox->setEnabled(true);
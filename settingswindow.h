@@ -34,6 +34,9 @@ public:
     explicit SettingsWindow(QWidget *parent = 0);
     ~SettingsWindow();
     unsigned int getCacheSizeInMB();
+    int getPrefetchDepth();
+    unsigned int getStatisticsCacheSizeInMB();
+    int getQualityMapBlockSize();
     bool getClearFrameState();
 
 signals:
@@ -21,6 +21,9 @@
 
 #include <QStringList>
 #include <QMap>
+#include <QVector>
+#include <QColor>
+#include <QRect>
 #include "typedef.h"
 #if _WIN32 && !__MINGW32__
 #define _USE_MATH_DEFINES 1
@@ -31,6 +34,9 @@
 
 typedef QMap<int,QColor> ColorMap;
 
+// maximum number of entries of the color lookup table of a ColorRange
+#define COLOR_RANGE_LUT_SIZE 1024
+
 class ColorRange {
 public:
     ColorRange() {}
@@ -64,9 +70,36 @@ public:
         return QColor(retR, retG, retB, retA);
     }
 
+    // Precompute the colors of [rangeMin, rangeMax]: one entry per integer value for ranges of up to
+    // COLOR_RANGE_LUT_SIZE values, otherwise COLOR_RANGE_LUT_SIZE equally spaced samples of getColor.
+    void buildLUT()
+    {
+        const int span = rangeMax - rangeMin;
+        const int n = (span <= 0) ? 1 : qMin(span + 1, COLOR_RANGE_LUT_SIZE);
+        lut.resize(n);
+        for (int k = 0; k < n; k++)
+            lut[k] = getColor((n == 1) ? (float)rangeMin : rangeMin + (float)k * span / (n-1)).rgba();
+    }
+
+    // color of value through the lookup table (values outside of the range get the color of the nearest end)
+    QRgb lookupColor(float value)
+    {
+        if (lut.isEmpty())
+            buildLUT();
+        if (lut.count() == 1)
+            return lut[0];
+
+        float pos = (value - rangeMin) * (lut.count()-1) / (float)(rangeMax - rangeMin);
+        pos = qBound(0.0f, pos, (float)(lut.count()-1));    // also catches NaN
+        return lut[(int)floor(pos + 0.5f)];
+    }
+
     int rangeMin, rangeMax;
     QColor minColor;
     QColor maxColor;
+
+protected:
+    QVector<QRgb> lut;
 };
 
 enum defaultColormaps_t {
@@ -291,6 +324,16 @@ public:
         }
     }
 
+    // color of a block with the given value and size (colorMapType and colorRangeType)
+    QColor blockColor(int value, int blockArea)
+    {
+        if (visualizationType == colorMapType)
+            return colorMap.value(value);
+        if (visualizationType == colorRangeType && colorRange != NULL)
+            return QColor::fromRgba(colorRange->lookupColor(scaleToBlockSize ? (float)value / (float)blockArea : (float)value));
+        return QColor();
+    }
+
     int typeID;
     QString typeName;
     visualizationType_t visualizationType;
@@ -311,18 +354,111 @@ public:
     int     alphaFactor;
 };
 
-enum statistics_t {
-    arrowType = 0,
-    blockType
-};
+// size of the cells of the spatial index of a StatisticsItemList in pixels
+#define STATISTICS_INDEX_CELL_SIZE 16
 
-struct StatisticsItem {
-    statistics_t type;
-    QColor color;
-    QColor gridColor;
-    QRect positionRect;
-    float vector[2];
-    int rawValues[2];
+// The blocks of one POC/type of a statistics file. The blocks are stored in packed arrays (one entry per block)
+// and only the raw values are kept. Colors and vectors are derived from the values and the StatisticsType when drawing.
+class StatisticsItemList
+{
+public:
+    StatisticsItemList() { indexCellsX = 0; indexCellsY = 0; }
+
+    int count() const { return posX.count(); }
+
+    // value2 is only stored for vector types
+    void reserve(int n, bool withValue2)
+    {
+        posX.reserve(n); posY.reserve(n); width.reserve(n); height.reserve(n); value1.reserve(n);
+        if (withValue2)
+            value2.reserve(n);
+    }
+    void append(int x, int y, int w, int h, int v1, int v2, bool withValue2)
+    {
+        posX.append(x); posY.append(y); width.append(w); height.append(h); value1.append(v1);
+        if (withValue2)
+            value2.append(v2);
+    }
+
+    QRect rect(int i) const { return QRect(posX[i], posY[i], width[i], height[i]); }
+
+    // Build the spatial index: a grid of STATISTICS_INDEX_CELL_SIZE cells over the frame,
+    // in which every block is listed in all cells it overlaps. Call when the list is complete.
+    void buildIndex(int frameWidth, int frameHeight)
+    {
+        indexCellsX = (frameWidth + STATISTICS_INDEX_CELL_SIZE - 1) / STATISTICS_INDEX_CELL_SIZE;
+        indexCellsY = (frameHeight + STATISTICS_INDEX_CELL_SIZE - 1) / STATISTICS_INDEX_CELL_SIZE;
+        cellStart.clear();
+        cellItems.clear();
+        if (indexCellsX <= 0 || indexCellsY <= 0)
+            return;
+
+        // count the blocks per cell, then place them (counting sort, the blocks of a cell stay in list order)
+        cellStart.fill(0, indexCellsX * indexCellsY + 1);
+        for (int pass = 0; pass < 2; pass++)
+        {
+            QVector<int> fillPos;
+            if (pass == 1)
+            {
+                for (int c = 0; c < indexCellsX * indexCellsY; c++)
+                    cellStart[c+1] += cellStart[c];
+                cellItems.resize(cellStart.last());
+                fillPos = cellStart;
+            }
+
+            for (int i = 0; i < count(); i++)
+            {
+                if (width[i] <= 0 || height[i] <= 0)
+                    continue;
+                const int cx0 = qMax(posX[i], 0) / STATISTICS_INDEX_CELL_SIZE;
+                const int cy0 = qMax(posY[i], 0) / STATISTICS_INDEX_CELL_SIZE;
+                const int cx1 = qMin((posX[i] + width[i] - 1) / STATISTICS_INDEX_CELL_SIZE, indexCellsX - 1);
+                const int cy1 = qMin((posY[i] + height[i] - 1) / STATISTICS_INDEX_CELL_SIZE, indexCellsY - 1);
+                for (int cy = cy0; cy <= cy1; cy++)
+                    for (int cx = cx0; cx <= cx1; cx++)
+                    {
+                        if (pass == 0)
+                            cellStart[cy*indexCellsX + cx + 1]++;
+                        else
+                            cellItems[fillPos[cy*indexCellsX + cx]++] = i;
+                    }
+            }
+        }
+    }
+
+    // indices of all blocks that contain the given position (in list order)
+    QVector<int> itemsAt(int x, int y) const
+    {
+        QVector<int> items;
+        if (cellStart.isEmpty() || x < 0 || y < 0)
+            return items;
+        const int cx = x / STATISTICS_INDEX_CELL_SIZE;
+        const int cy = y / STATISTICS_INDEX_CELL_SIZE;
+        if (cx >= indexCellsX || cy >= indexCellsY)
+            return items;
+
+        const int cell = cy*indexCellsX + cx;
+        for (int j = cellStart[cell]; j < cellStart[cell+1]; j++)
+            if (rect(cellItems[j]).contains(x, y))
+                items.append(cellItems[j]);
+        return items;
+    }
+
+    // number of ints held by the list and its index
+    qint64 memorySize() const { return (qint64)count() * 5 + value2.count() + cellStart.count() + cellItems.count(); }
+
+    QVector<int> posX;
+    QVector<int> posY;
+    QVector<int> width;
+    QVector<int> height;
+    QVector<int> value1;
+    QVector<int> value2;
+
+private:
+    int indexCellsX;
+    int indexCellsY;
+    QVector<int> cellStart;     // per cell the position of its first block in cellItems (one extra entry at the end)
+    QVector<int> cellItems;
 };
 
 #endif // STATISTICSEXTENSIONS_H
@@ -21,32 +21,110 @@
 #include <QSettings>
 #include <QColor>
 #include <QPainter>
+#include <QPainterPath>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QDir>
-#include <QTextStream>
+#include <QBuffer>
+#include <QSet>
+#include <QtEndian>
 #include <QFuture>
 #include <QtConcurrent>
+#include <QThread>
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <climits>
 
 #include "yuvfile.h"
+#include "statslinetokenizer.h"
 
-void rotateVector(float angle, float vx, float vy, float &nx, float &ny)
+// Binary statistics format (see statisticsobject.h). All values are stored little endian and are read and
+// written field by field, so the files are portable and the records need no alignment.
+#define BINARY_STATS_MAGIC          "YUVStBin"
+#define BINARY_STATS_VERSION        1
+#define BINARY_STATS_HEADER_SIZE    48
+#define BINARY_STATS_CHUNK_SIZE     24
+#define BINARY_STATS_RECORD_SIZE    24
+
+static void appendLE32(QByteArray &data, qint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<qint32>(value, bytes);
+    data.append((const char*)bytes, 4);
+}
+
+static void appendLE64(QByteArray &data, qint64 value)
+{
+    uchar bytes[8];
+    qToLittleEndian<qint64>(value, bytes);
+    data.append((const char*)bytes, 8);
+}
+
+static QByteArray serializeBinaryStatsHeader(const BinaryStatsHeader &header)
+{
+    QByteArray data(header.magic, sizeof(header.magic));
+    appendLE32(data, header.version);
+    appendLE32(data, header.numFrames);
+    appendLE64(data, header.headerTextOffset);
+    appendLE64(data, header.headerTextSize);
+    appendLE64(data, header.chunkTableOffset);
+    appendLE32(data, header.numChunks);
+    appendLE32(data, header.reserved);
+    return data;
+}
+
+static BinaryStatsHeader parseBinaryStatsHeader(const uchar *data)
 {
-    float s = sinf(angle);
-    float c = cosf(angle);
+    BinaryStatsHeader header;
+    memcpy(header.magic, data, sizeof(header.magic));
+    header.version = qFromLittleEndian<qint32>(data + 8);
+    header.numFrames = qFromLittleEndian<qint32>(data + 12);
+    header.headerTextOffset = qFromLittleEndian<qint64>(data + 16);
+    header.headerTextSize = qFromLittleEndian<qint64>(data + 24);
+    header.chunkTableOffset = qFromLittleEndian<qint64>(data + 32);
+    header.numChunks = qFromLittleEndian<qint32>(data + 40);
+    header.reserved = qFromLittleEndian<qint32>(data + 44);
+    return header;
+}
 
-    nx = c * vx + s * vy;
-    ny = -s * vx + c * vy;
+static void appendBinaryStatsChunk(QByteArray &data, const BinaryStatsChunk &chunk)
+{
+    appendLE32(data, chunk.poc);
+    appendLE32(data, chunk.typeID);
+    appendLE64(data, chunk.offset);
+    appendLE32(data, chunk.count);
+    appendLE32(data, chunk.reserved);
+}
 
-     //normalize vector
-    float n_abs = sqrtf( nx*nx + ny*ny );
-    nx /= n_abs;
-    ny /= n_abs;
+static BinaryStatsChunk parseBinaryStatsChunk(const uchar *data)
+{
+    BinaryStatsChunk chunk;
+    chunk.poc = qFromLittleEndian<qint32>(data);
+    chunk.typeID = qFromLittleEndian<qint32>(data + 4);
+    chunk.offset = qFromLittleEndian<qint64>(data + 8);
+    chunk.count = qFromLittleEndian<qint32>(data + 16);
+    chunk.reserved = qFromLittleEndian<qint32>(data + 20);
+    return chunk;
 }
 
+// Ranges of CSV files that are scanned in parallel by readFrameAndTypePositionsFromFile
+#define STATS_SCAN_MIN_RANGE_SIZE   (16*1024*1024)
+
+// start of a sequence of lines with the same POC and type
+struct StatsTypeRun
+{
+    int poc;
+    int typeID;
+    qint64 startPos;
+};
+
+QCache<StatisticsCacheIdx, StatisticsItemList> StatisticsObject::statisticsCache;
+int StatisticsObject::statisticsCacheEvictions = 0;
+QMutex StatisticsObject::statisticsCacheMutex;
+int StatisticsObject::prefetchDepth = 8;
+
 StatisticsObject::StatisticsObject(const QString& srcFileName, QObject* parent) : DisplayObject(parent)
 {
     // get some more information from file
@@ -58,6 +136,8 @@ StatisticsObject::StatisticsObject(const QString& srcFileName, QObject* parent)
     p_status = "OK";
     p_info = "";
     bFileSortedByPOC = false;
+    p_binaryFormat = isBinaryStatisticsFile(srcFileName);
+    p_binaryData = NULL;
     int bitDepth;
 
     QStringList components = srcFileName.split(QDir::separator());
@@ -69,10 +149,31 @@ StatisticsObject::StatisticsObject(const QString& srcFileName, QObject* parent)
     YUVFile::formatFromFilename(srcFileName, &p_width, &p_height, &p_frameRate, &p_numberFrames, &bitDepth, false);
     readHeaderFromFile();
 
+    p_cancelPrefetch = false;
+    p_prefetchFirstPOC = INT_INVALID;
+    p_prefetchLastPOC = INT_INVALID;
+
     p_cancelBackgroundParser = false;
     p_backgroundParserFuture = QtConcurrent::run(this, &StatisticsObject::readFrameAndTypePositionsFromFile);
 }
 
+StatisticsObject::StatisticsObject(QObject* parent) : DisplayObject(parent)
+{
+    p_numBytes = 0;
+    p_status = "OK";
+    p_info = "";
+    bFileSortedByPOC = false;
+    p_binaryFormat = false;
+    p_binaryData = NULL;
+    p_numberFrames = 0;
+
+    p_cancelPrefetch = false;
+    p_prefetchFirstPOC = INT_INVALID;
+    p_prefetchLastPOC = INT_INVALID;
+
+    p_cancelBackgroundParser = false;
+}
+
 StatisticsObject::~StatisticsObject() 
 {
   // The statistics object is being deleted.
@@ -84,29 +185,33 @@ StatisticsObject::~StatisticsObject()
 
     p_backgroundParserFuture.waitForFinished();
   }
-}
 
-void StatisticsObject::setInternalScaleFactor(int internalScaleFactor)
-{
-    internalScaleFactor = clip(internalScaleFactor, 1, MAX_SCALE_FACTOR);
+  stopPrefetching();
 
-    if(p_internalScaleFactor!=internalScaleFactor)
-    {
-        p_internalScaleFactor = internalScaleFactor;
-        emit informationChanged();
-    }
+  if (p_binaryData)
+      p_binaryFile.unmap((uchar*)p_binaryData);
+
+  // the cache keys contain our address, which may be reused by another object
+  removeFromStatisticsCache();
 }
 
 void StatisticsObject::loadImage(int frameIdx)
 {
+    applyPrefetchError();
+
     if (frameIdx==INT_INVALID || frameIdx >= numFrames())
     {
         p_displayImage = QPixmap();
+        p_currentStats.clear();
         return;
     }
 
-    // create empty image
-    QImage tmpImage(internalScaleFactor()*width(), internalScaleFactor()*height(), QImage::Format_ARGB32);
+    // the running prefetch is useless after a seek
+    if (p_prefetchFuture.isRunning() && (frameIdx < p_prefetchFirstPOC || frameIdx > p_prefetchLastPOC))
+        stopPrefetching();
+
+    // create empty image (native resolution, the zoom is applied when the overlay is drawn)
+    QImage tmpImage(width(), height(), QImage::Format_ARGB32);
     tmpImage.fill(qRgba(0, 0, 0, 0));   // clear with transparent color
     p_displayImage.convertFromImage(tmpImage);
 
@@ -117,121 +222,154 @@ void StatisticsObject::loadImage(int frameIdx)
 
 void StatisticsObject::drawStatisticsImage(int frameIdx)
 {
+    p_currentStats.clear();
+
     // draw statistics (inverse order)
     for(int i=p_statsTypeList.count()-1; i>=0; i--)
     {
         if (!p_statsTypeList[i].render)
             continue;
 
+        // keep the lists of this frame for drawing the vectors and grids
         StatisticsItemList stats = getStatistics(frameIdx, p_statsTypeList[i].typeID);
-        drawStatisticsImage(stats, p_statsTypeList[i]);
+        p_currentStats[p_statsTypeList[i].typeID] = stats;
+
+        if (p_statsTypeList[i].visualizationType != vectorType)
+            drawStatisticsImage(stats, p_statsTypeList[i]);
     }
 }
 
-void StatisticsObject::drawStatisticsImage(StatisticsItemList statsList, StatisticsType statsType)
+void StatisticsObject::drawStatisticsImage(const StatisticsItemList &statsList, StatisticsType statsType)
 {
+    // block fills, one pixel per sample
     QPainter painter(&p_displayImage);
 
-    StatisticsItemList::iterator it;
-    for (it = statsList.begin(); it != statsList.end(); it++)
+    for (int i = 0; i < statsList.count(); i++)
     {
-        StatisticsItem anItem = *it;
-
-        switch (anItem.type)
-        {
-        case arrowType:
-        {
-            QRect aRect = anItem.positionRect;
-            QRect displayRect = QRect(aRect.left()*internalScaleFactor(), aRect.top()*internalScaleFactor(), aRect.width()*internalScaleFactor(), aRect.height()*internalScaleFactor());
+        QRect aRect = statsList.rect(i);
 
-            int x,y;
+        // the colors are not stored with the blocks
+        QColor rectColor = statsType.blockColor(statsList.value1[i], aRect.width() * aRect.height());
+        rectColor.setAlpha( rectColor.alpha()*((float)statsType.alphaFactor / 100.0) );
 
-            // start vector at center of the block
-            x = displayRect.left()+displayRect.width()/2;
-            y = displayRect.top()+displayRect.height()/2;
-
-            QPoint startPoint = QPoint(x,y);
-
-            float vx = anItem.vector[0];
-            float vy = anItem.vector[1];
+        painter.fillRect(aRect, rectColor);
+    }
+}
 
-            QPoint arrowBase = QPoint(x+internalScaleFactor()*vx, y+internalScaleFactor()*vy);
-            QColor arrowColor = anItem.color;
-            //arrowColor.setAlpha( arrowColor.alpha()*((float)statsType.alphaFactor / 100.0) );
+void StatisticsObject::drawOverlay(QPainter *painter, const QRect &displayRect, const QRect &clipRect)
+{
+    if (p_displayImage.isNull() || width() <= 0 || height() <= 0)
+        return;
 
-            QPen arrowPen(arrowColor);
-            painter.setPen(arrowPen);
-            painter.drawLine(startPoint, arrowBase);
+    // the part of the frame which is visible in clipRect
+    const QRect visibleRect = clipRect & displayRect;
+    if (visibleRect.isEmpty())
+        return;
+    const double zoom = (double)displayRect.width() / (double)width();
+    const int x0 = clip((int)floor((visibleRect.left() - displayRect.left()) / zoom), 0, width());
+    const int y0 = clip((int)floor((visibleRect.top() - displayRect.top()) / zoom), 0, height());
+    const int x1 = clip((int)ceil((visibleRect.right() + 1 - displayRect.left()) / zoom), 0, width());
+    const int y1 = clip((int)ceil((visibleRect.bottom() + 1 - displayRect.top()) / zoom), 0, height());
+    const QRect srcVisible(x0, y0, x1-x0, y1-y0);
 
-            if( vx == 0 && vy == 0 )
-            {
-                // nothing to draw...
-            }
-            else
-            {
-                // draw an arrow
-                float nx, ny;
+    painter->save();
+    painter->setClipRect(clipRect, Qt::IntersectClip);
 
-                // TODO: scale arrow head with
-                float a = internalScaleFactor()*4;    // length of arrow
-                float b = internalScaleFactor()*2;    // base width of arrow
+    // scale the visible part of the block layer
+    QRectF targetRect(displayRect.left() + x0*zoom, displayRect.top() + y0*zoom, (x1-x0)*zoom, (y1-y0)*zoom);
+    painter->drawPixmap(targetRect, p_displayImage, QRectF(srcVisible));
 
-                float n_abs = sqrtf( vx*vx + vy*vy );
-                float vxf = (float) vx / n_abs;
-                float vyf = (float) vy / n_abs;
+    // vectors and grids depend on the zoom, they are drawn for the visible blocks only (inverse order)
+    for(int i=p_statsTypeList.count()-1; i>=0; i--)
+    {
+        if (!p_statsTypeList[i].render || !p_currentStats.contains(p_statsTypeList[i].typeID))
+            continue;
+        if (p_statsTypeList[i].visualizationType == vectorType || p_statsTypeList[i].renderGrid)
+            drawVectorsAndGrid(painter, p_currentStats[p_statsTypeList[i].typeID], p_statsTypeList[i], displayRect.topLeft(), zoom, srcVisible);
+    }
 
-                QPoint arrowTip = arrowBase + QPoint(vxf*a+0.5,vyf*a+0.5);
+    painter->restore();
+}
 
-                // arrow head right
-                rotateVector(-M_PI_2, -vx, -vy, nx, ny);
-                QPoint offsetRight = QPoint(nx*b+0.5, ny*b+0.5);
-                QPoint arrowHeadRight = arrowBase + offsetRight;
+void StatisticsObject::drawVectorsAndGrid(QPainter *painter, const StatisticsItemList &statsList, StatisticsType statsType, QPoint origin, double zoom, const QRect &srcVisible)
+{
+    // The geometry is collected in one path per color and drawn with one call per path.
+    // All vectors of a type have the same color, the grid uses the block colors if it has no color of its own.
+    const bool isVectorType = (statsType.visualizationType == vectorType);
+    QPainterPath vectorPath;
+    vectorPath.setFillRule(Qt::WindingFill);    // all arrow heads have the same orientation
+    QHash<QRgb, QPainterPath> gridPaths;
 
-                // arrow head left
-                rotateVector(M_PI_2, -vx, -vy, nx, ny);
-                QPoint offsetLeft = QPoint(nx*b+0.5, ny*b+0.5);
-                QPoint arrowHeadLeft = arrowBase + offsetLeft;
+    const float a = zoom*4;    // length of arrow
+    const float b = zoom*2;    // base width of arrow
 
-                // draw arrow head
-                QPoint points[3] = {arrowTip, arrowHeadRight, arrowHeadLeft};
-                painter.setBrush(arrowColor);
-                painter.drawPolygon(points, 3);
-            }
+    for (int i = 0; i < statsList.count(); i++)
+    {
+        QRect aRect = statsList.rect(i);
 
-            break;
-        }
-        case blockType:
+        float vx = 0, vy = 0;
+        if (isVectorType)
         {
-            //draw a rectangle
-            QColor rectColor = anItem.color;
-            rectColor.setAlpha( rectColor.alpha()*((float)statsType.alphaFactor / 100.0) );
-            painter.setBrush(rectColor);
+            // calculate the vector size
+            vx = (float)statsList.value1[i] / statsType.vectorSampling;
+            vy = (float)statsList.value2[i] / statsType.vectorSampling;
+        }
 
-            QRect aRect = anItem.positionRect;
-            QRect displayRect = QRect(aRect.left()*internalScaleFactor(), aRect.top()*internalScaleFactor(), aRect.width()*internalScaleFactor(), aRect.height()*internalScaleFactor());
+        // skip blocks (and their vectors) outside of the visible area
+        QRectF srcBounds = QRectF(aRect).united(QRectF(aRect.center().x() + vx, aRect.center().y() + vy, 1, 1));
+        if (!srcBounds.intersects(QRectF(srcVisible)))
+            continue;
 
-            painter.fillRect(displayRect, rectColor);
+        QRectF displayRect = QRectF(origin.x() + aRect.left()*zoom, origin.y() + aRect.top()*zoom, aRect.width()*zoom, aRect.height()*zoom);
 
-            break;
-        }
+        // vectors shorter than a pixel at this zoom are not visible
+        const float lengthSquared = vx*vx + vy*vy;
+        if (isVectorType && lengthSquared * zoom * zoom >= 1.0f)
+        {
+            // start vector at center of the block
+            QPointF startPoint = displayRect.center();
+            QPointF arrowBase = startPoint + QPointF(zoom*vx, zoom*vy);
+            vectorPath.moveTo(startPoint);
+            vectorPath.lineTo(arrowBase);
+
+            // arrow head: the tip in the direction of the vector, the base corners perpendicular to it
+            const float invLength = 1.0f / sqrtf(lengthSquared);
+            const float ux = vx * invLength;
+            const float uy = vy * invLength;
+            vectorPath.moveTo(arrowBase + QPointF(ux*a, uy*a));
+            vectorPath.lineTo(arrowBase + QPointF(uy*b, -ux*b));
+            vectorPath.lineTo(arrowBase + QPointF(-uy*b, ux*b));
+            vectorPath.closeSubpath();
         }
 
         // optionally, draw a grid around the region
-        if (statsType.renderGrid) {
-            //draw a rectangle
-            QColor gridColor = anItem.gridColor;
-            QPen gridPen(gridColor);
-            gridPen.setWidth(1);
-            painter.setPen(gridPen);
-            painter.setBrush(QBrush(QColor(Qt::color0), Qt::NoBrush));  // no fill color
-
-            QRect aRect = anItem.positionRect;
-            QRect displayRect = QRect(aRect.left()*internalScaleFactor(), aRect.top()*internalScaleFactor(), aRect.width()*internalScaleFactor(), aRect.height()*internalScaleFactor());
-
-            painter.drawRect(displayRect);
+        if (statsType.renderGrid)
+        {
+            // if the grid color is unset for this type, use color of type for grid, too
+            QColor gridColor = statsType.gridColor.isValid() ? statsType.gridColor :
+                               (isVectorType ? statsType.vectorColor : statsType.blockColor(statsList.value1[i], aRect.width() * aRect.height()));
+            gridPaths[gridColor.rgba()].addRect(displayRect);
         }
     }
 
+    if (!vectorPath.isEmpty())
+    {
+        QColor arrowColor = statsType.vectorColor;
+        //arrowColor.setAlpha( arrowColor.alpha()*((float)statsType.alphaFactor / 100.0) );
+        painter->setPen(QPen(arrowColor));
+        painter->setBrush(arrowColor);
+        painter->drawPath(vectorPath);
+    }
+
+    painter->setBrush(QBrush(QColor(Qt::color0), Qt::NoBrush));  // no fill color
+    QHash<QRgb, QPainterPath>::const_iterator it;
+    for (it = gridPaths.constBegin(); it != gridPaths.constEnd(); it++)
+    {
+        QPen gridPen(QColor::fromRgba(it.key()));
+        gridPen.setWidth(1);
+        painter->setPen(gridPen);
+        painter->drawPath(it.value());
+    }
 }
 
 // return raw(!) value of frontmost, active statistic item at given position
@@ -246,42 +384,31 @@ ValuePairList StatisticsObject::getValuesAt(int x, int y)
             int typeID = p_statsTypeList[i].typeID;
             StatisticsItemList statsList = getStatistics(p_lastIdx, typeID);
 
-            if( statsList.size() == 0 && typeID == INT_INVALID ) // no active statistics
+            if( statsList.count() == 0 && typeID == INT_INVALID ) // no active statistics
                 continue;
 
             StatisticsType* aType = getStatisticsType(typeID);
             Q_ASSERT(aType->typeID != INT_INVALID && aType->typeID == typeID);
 
-            // find item of this type at requested position
-            StatisticsItemList::iterator it;
+            // find items of this type at requested position (spatial index lookup)
+            QVector<int> items = statsList.itemsAt(x, y);
             bool foundStats = false;
-            for (it = statsList.begin(); it != statsList.end(); it++)
+            foreach (int j, items)
             {
-                StatisticsItem anItem = *it;
-
-                QRect aRect = anItem.positionRect;
-
-                int rawValue1 = anItem.rawValues[0];
-                int rawValue2 = anItem.rawValues[1];
-
-                float vectorValue1 = anItem.vector[0];
-                float vectorValue2 = anItem.vector[1];
-
-                if( aRect.contains(x,y) )
+                if( aType->visualizationType != vectorType )
                 {
-                    if( anItem.type == blockType )
-                    {
-                        valueList.append( ValuePair(aType->typeName, QString::number(rawValue1)) );
-                    }
-                    else if( anItem.type == arrowType )
-                    {
-                        // TODO: do we also want to show the raw values?
-                        valueList.append( ValuePair(QString("%1[x]").arg(aType->typeName), QString::number(vectorValue1)) );
-                        valueList.append( ValuePair(QString("%1[y]").arg(aType->typeName), QString::number(vectorValue2)) );
-                    }
-
-                    foundStats = true;
+                    valueList.append( ValuePair(aType->typeName, QString::number(statsList.value1[j])) );
+                }
+                else
+                {
+                    // TODO: do we also want to show the raw values?
+                    float vectorValue1 = (float)statsList.value1[j] / aType->vectorSampling;
+                    float vectorValue2 = (float)statsList.value2[j] / aType->vectorSampling;
+                    valueList.append( ValuePair(QString("%1[x]").arg(aType->typeName), QString::number(vectorValue1)) );
+                    valueList.append( ValuePair(QString("%1[y]").arg(aType->typeName), QString::number(vectorValue2)) );
                 }
+
+                foundStats = true;
             }
 
             if(!foundStats)
@@ -292,123 +419,354 @@ ValuePairList StatisticsObject::getValuesAt(int x, int y)
     return valueList;
 }
 
+bool StatisticsObject::hasStatistics(int frameIdx, int typeID)
+{
+    return p_pocTypeStartList.contains(frameIdx) && p_pocTypeStartList[frameIdx].contains(typeID);
+}
+
 StatisticsItemList StatisticsObject::getStatistics(int frameIdx, int typeID)
 {
     // check if the requested statistics are in the file
-    if (!p_pocTypeStartList.contains(frameIdx) || !p_pocTypeStartList[frameIdx].contains(typeID))
+    if (!hasStatistics(frameIdx, typeID))
     {
         // No information for the given POC/type in the file. Return an empty list.
         return StatisticsItemList();
     }
     // if requested statistics are not in cache, read from file
-    if( !p_statsCache.contains(frameIdx) || !p_statsCache[frameIdx].contains(typeID) )
     {
-        readStatisticsFromFile(frameIdx, typeID);
+        QMutexLocker cacheLocker(&statisticsCacheMutex);
+        StatisticsItemList *cachedStats = statisticsCache.object(StatisticsCacheIdx(this, frameIdx, typeID));
+        if (cachedStats != NULL)
+            return *cachedStats;
+    }
+
+    return loadStatistics(frameIdx, typeID, loadContext());
+}
+
+StatisticsLoadContext StatisticsObject::loadContext()
+{
+    StatisticsLoadContext context;
+    context.width = p_width;
+    context.height = p_height;
+    for (int i = 0; i < p_statsTypeList.count(); i++)
+        context.isVectorType.insert(p_statsTypeList.at(i).typeID, p_statsTypeList.at(i).visualizationType == vectorType);
+    context.sourceFiles[0] = NULL;
+    context.sourceFiles[1] = NULL;
+    context.sourceBitDepth = 0;
+    return context;
+}
+
+void StatisticsObject::prefetchStatistics(int frameIdx, int step)
+{
+    applyPrefetchError();
+
+    if (prefetchDepth <= 0 || p_prefetchFuture.isRunning() || p_backgroundParserFuture.isRunning())
+        return;
+
+    QList<int> typeList;
+    for (int i = 0; i < p_statsTypeList.count(); i++)
+        if (p_statsTypeList[i].render)
+            typeList.append(p_statsTypeList[i].typeID);
+    if (typeList.isEmpty())
+        return;
+
+    // collect the POC/types ahead of the play head with rendered types which are not cached yet
+    // (hasStatistics is only called here, it may read the parameters of the object)
+    step = qMax(1, step);
+    QList< QPair<int,int> > loadList;
+    {
+        QMutexLocker cacheLocker(&statisticsCacheMutex);
+        for (int i = 1; i <= prefetchDepth; i++)
+        {
+            const int poc = frameIdx + i*step;
+            if (poc >= numFrames())
+                break;
+
+            foreach (int typeID, typeList)
+            {
+                if (hasStatistics(poc, typeID) && !statisticsCache.contains(StatisticsCacheIdx(this, poc, typeID)))
+                    loadList.append(QPair<int,int>(poc, typeID));
+            }
+        }
+    }
+
+    if (loadList.isEmpty())
+        return;
+
+    p_prefetchFirstPOC = frameIdx;
+    p_prefetchLastPOC = loadList.last().first;
+    p_cancelPrefetch = false;
+    p_prefetchFuture = QtConcurrent::run(this, &StatisticsObject::prefetchWorker, loadList, loadContext());
+}
+
+void StatisticsObject::stopPrefetching()
+{
+    if (p_prefetchFuture.isRunning())
+    {
+        // signal to background thread that we want to cancel the processing
+        p_cancelPrefetch = true;
+        p_prefetchFuture.waitForFinished();
+    }
+}
+
+void StatisticsObject::prefetchWorker(QList< QPair<int,int> > loadList, StatisticsLoadContext context)
+{
+    // the parameters of the object (e.g. the type list, which is shared with the GUI thread) are only read from the context
+    for (int i = 0; i < loadList.count(); i++)
+    {
+        if (p_cancelPrefetch)
+            return;
+
+        // interleaved files cache all types of a POC at once
+        const int poc = loadList[i].first;
+        const int typeID = loadList[i].second;
+        bool cached;
+        {
+            QMutexLocker cacheLocker(&statisticsCacheMutex);
+            cached = statisticsCache.contains(StatisticsCacheIdx(this, poc, typeID));
+        }
+        if (!cached)
+            loadStatistics(poc, typeID, context);
+    }
+}
+
+int StatisticsObject::statisticsCacheCost(const StatisticsItemList &statsList)
+{
+    qint64 sizeInBytes = statsList.memorySize() * sizeof(int);
+
+    // QCache costs are int, so account in KiB (rounded up, so even empty lists are not for free)
+    return qMax(1, (int)((sizeInBytes + 1023) >> 10));
+}
+
+void StatisticsObject::insertIntoStatisticsCache(int frameIdx, int typeID, const StatisticsItemList &statsList)
+{
+    QMutexLocker cacheLocker(&statisticsCacheMutex);
+    const StatisticsCacheIdx cIdx(this, frameIdx, typeID);
+    const int countBefore = statisticsCache.count() + (statisticsCache.contains(cIdx) ? 0 : 1);
+
+    // the least recently used lists are evicted if the cache is full. The arrays are shared with statsList.
+    statisticsCache.insert(cIdx, new StatisticsItemList(statsList), statisticsCacheCost(statsList));
+
+    statisticsCacheEvictions += countBefore - statisticsCache.count();
+}
+
+void StatisticsObject::removeFromStatisticsCache()
+{
+    QMutexLocker cacheLocker(&statisticsCacheMutex);
+    foreach (const StatisticsCacheIdx &cIdx, statisticsCache.keys())
+        if (cIdx.object == this)
+            statisticsCache.remove(cIdx);
+}
+
+void StatisticsObject::setStatisticsCacheSizeInMB(unsigned int sizeInMB)
+{
+    QMutexLocker cacheLocker(&statisticsCacheMutex);
+    const int countBefore = statisticsCache.count();
+    statisticsCache.setMaxCost(sizeInMB << 10);
+    statisticsCacheEvictions += countBefore - statisticsCache.count();
+}
+
+QString StatisticsObject::statisticsCacheStatus()
+{
+    QMutexLocker cacheLocker(&statisticsCacheMutex);
+    return QString("Statistics cache: %1 of %2 MB, %3 lists, %4 evictions").arg(statisticsCache.totalCost() / 1024.0, 0, 'f', 1).arg(statisticsCache.maxCost() >> 10).arg(statisticsCache.count()).arg(statisticsCacheEvictions);
+}
+
+// Scan the lines of a statistics file that start in [start, end[ and append an entry for every line where
+// the POC or type differs from the previous line (and for the first line of the range).
+// Returns false if a data line has too few values.
+static bool scanStatsRange(const QString &filePath, qint64 start, qint64 end, const bool *cancel, QVector<StatsTypeRun> &runs)
+{
+    QFile inputFile(filePath);
+    if (!inputFile.open(QIODevice::ReadOnly))
+        return true;
+
+    char lineBuffer[STATS_LINE_BUFFER_SIZE];
+    StatsLineFields fields;
+
+    // the line that contains start belongs to the previous range
+    if (start > 0)
+    {
+        inputFile.seek(start - 1);
+        readStatsLine(&inputFile, lineBuffer);
+    }
+
+    int lastPOC = INT_INVALID;
+    int lastType = INT_INVALID;
+    bool firstLine = true;
+    while (inputFile.pos() < end && !*cancel)
+    {
+        qint64 lineStartPos = inputFile.pos();
+
+        // read one line
+        qint64 lineLength = readStatsLine(&inputFile, lineBuffer);
+        if (lineLength < 0)
+            break;
+
+        // get components of this line
+        tokenizeStatsLine(lineBuffer, lineLength, fields);
+
+        // ignore empty lines and headers
+        if (fields.isEmpty() || fields.isHeader())
+            continue;
+
+        if (fields.count < 6)
+            return false;
+
+        int poc = fields.toInt(0);
+        int typeID = fields.toInt(5);
+        if (firstLine || poc != lastPOC || typeID != lastType)
+        {
+            StatsTypeRun run;
+            run.poc = poc;
+            run.typeID = typeID;
+            run.startPos = lineStartPos;
+            runs.append(run);
+
+            lastPOC = poc;
+            lastType = typeID;
+            firstLine = false;
+        }
     }
 
-    return p_statsCache[frameIdx][typeID];
+    return true;
 }
 
 void StatisticsObject::readFrameAndTypePositionsFromFile()
 {
+    // binary files contain a chunk table, there is nothing to parse
+    if (p_binaryFormat)
+    {
+        if (readChunkTableFromBinary())
+        {
+            p_status = "OK";
+            emit informationChanged();
+        }
+        else
+            setErrorState("The binary statistics file is invalid.");
+        return;
+    }
+
+    // parsing large files takes minutes, so try the index of the last parse first
+    if (readIndexFromSidecar())
+    {
+        p_status = "OK";
+        emit informationChanged();
+        return;
+    }
+
     try {
         QFile inputFile(p_srcFilePath);
 
         if(inputFile.open(QIODevice::ReadOnly) == false)
             return;
+        const qint64 fileSize = inputFile.size();
+        inputFile.close();
+
+        // The file is split into ranges that are scanned in parallel. Each range yields the list of positions
+        // where the POC/type changes, so the merge below sees exactly the same sequence of POC/type changes
+        // as a scan of the whole file.
+        const int numThreads = qMax(1, QThread::idealThreadCount());
+        qint64 rangeSize = qMax((qint64)STATS_SCAN_MIN_RANGE_SIZE, fileSize / (numThreads * 16) + 1);
+        int numRanges = (int)((fileSize + rangeSize - 1) / rangeSize);
+
+        QVector< QVector<StatsTypeRun> > rangeRuns(numRanges);
+        QVector<char> rangeValid(numRanges, 1);
+        QVector<StatsTypeRun> *runs = rangeRuns.data();
+        char *valid = rangeValid.data();
+        QString filePath = p_srcFilePath;
+        bool *cancel = &p_cancelBackgroundParser;
+
+        // scan one range per thread at a time, so that the progress can be reported in between
+        for (int batchStart = 0; batchStart < numRanges && !p_cancelBackgroundParser; batchStart += numThreads)
+        {
+            int batchEnd = qMin(batchStart + numThreads, numRanges);
+            int i;
+#pragma omp parallel for default(none) private(i) shared(runs,valid,filePath,cancel,rangeSize,batchStart,batchEnd) schedule(dynamic)
+            for (i = batchStart; i < batchEnd; i++)
+                valid[i] = scanStatsRange(filePath, i*rangeSize, (i+1)*rangeSize, cancel, runs[i]) ? 1 : 0;
+
+            for (i = batchStart; i < batchEnd; i++)
+                if (!valid[i])
+                    throw "A line of the statistics file has too few values.";
+
+            // Set progress text
+            int percent = (int)((double)qMin(batchEnd*rangeSize, fileSize) * 100 / (double)fileSize);
+            p_status = QString("Parsing (") + QString::number(percent) + QString("%) ...");
+            emit informationChanged();
+        }
 
         int lastPOC = INT_INVALID;
         int lastType = INT_INVALID;
         int numFrames = 0;
-        qint64 nextSignalAtByte = 0;
-        while (!inputFile.atEnd() && !p_cancelBackgroundParser)
+        for (int r = 0; r < numRanges && !p_cancelBackgroundParser; r++)
         {
-            qint64 lineStartPos = inputFile.pos();
-
-            // read one line
-            QByteArray aLineByteArray = inputFile.readLine();
-            QString aLine(aLineByteArray);
-
-            // get components of this line
-            QStringList rowItemList = parseCSVLine(aLine, ';');
-
-            // ignore empty stuff
-            if (rowItemList[0].isEmpty())
-                continue;
-
-            // ignore headers
-            if (rowItemList[0][0] == '%')
-                continue;
-
-            // check for POC/type information
-            int poc = rowItemList[0].toInt();
-            int typeID = rowItemList[5].toInt();
-
-            if (lastType == -1 && lastPOC == -1)
-            {
-              // First POC/type line
-              p_pocTypeStartList[poc][typeID] = lineStartPos;
-              lastType = typeID;
-              lastPOC = poc;
-              numFrames++;
-              p_numberFrames=numFrames;
-            }
-            else if (typeID != lastType && poc == lastPOC)
-            {
-                // we found a new type but the POC stayed the same.
-                // This seems to be an interleaved file
-                // Check if we already collected a start position for this type
-                bFileSortedByPOC = true;
-                lastType = typeID;
-                if (p_pocTypeStartList[poc].contains(typeID))
-                    // POC/type start position already collected
-                    continue;
-                p_pocTypeStartList[poc][typeID] = lineStartPos;
-            }
-            else if (poc != lastPOC)
+            for (int j = 0; j < rangeRuns[r].count(); j++)
             {
-                // We found a new POC
-                lastPOC = poc;
-                lastType = typeID;
-                if (bFileSortedByPOC)
-                {
-                    // There must not be a start position for any type with this POC already.
-                    if (p_pocTypeStartList.contains(poc))
-                        throw "The data for each POC must be continuous in an interleaved statistics file.";
-                }
-                else
+                int poc = rangeRuns[r][j].poc;
+                int typeID = rangeRuns[r][j].typeID;
+                qint64 lineStartPos = rangeRuns[r][j].startPos;
+
+                if (lastType == -1 && lastPOC == -1)
                 {
-                    // There must not be a start position for this POC/type already.
-                    if (p_pocTypeStartList.contains(poc) && p_pocTypeStartList[poc].contains(typeID))
-                        throw "The data for each typeID must be continuous in an non interleaved statistics file.";
+                  // First POC/type line
+                  p_pocTypeStartList[poc][typeID] = lineStartPos;
+                  lastType = typeID;
+                  lastPOC = poc;
+                  numFrames++;
+                  p_numberFrames=numFrames;
                 }
-                p_pocTypeStartList[poc][typeID] = lineStartPos;
-
-                // update number of frames
-                if( poc+1 > numFrames )
+                else if (typeID != lastType && poc == lastPOC)
                 {
-                    numFrames = poc+1;
-                    p_numberFrames = numFrames;
-                    p_endFrame = p_numberFrames - 1;   
+                    // we found a new type but the POC stayed the same.
+                    // This seems to be an interleaved file
+                    // Check if we already collected a start position for this type
+                    bFileSortedByPOC = true;
+                    lastType = typeID;
+                    if (p_pocTypeStartList[poc].contains(typeID))
+                        // POC/type start position already collected
+                        continue;
+                    p_pocTypeStartList[poc][typeID] = lineStartPos;
                 }
-                // Update after parsing 5Mb of the file
-                if( lineStartPos > nextSignalAtByte )
+                else if (poc != lastPOC)
                 {
-                    // Set progress text
-                    int percent = (int)((double)lineStartPos * 100 / (double)p_numBytes);
-                    p_status = QString("Parsing (") + QString::number(percent) + QString("%) ...");
-                    emit informationChanged();
-                    nextSignalAtByte = lineStartPos + 5000000;
+                    // We found a new POC
+                    lastPOC = poc;
+                    lastType = typeID;
+                    if (bFileSortedByPOC)
+                    {
+                        // There must not be a start position for any type with this POC already.
+                        if (p_pocTypeStartList.contains(poc))
+                            throw "The data for each POC must be continuous in an interleaved statistics file.";
+                    }
+                    else
+                    {
+                        // There must not be a start position for this POC/type already.
+                        if (p_pocTypeStartList.contains(poc) && p_pocTypeStartList[poc].contains(typeID))
+                            throw "The data for each typeID must be continuous in an non interleaved statistics file.";
+                    }
+                    p_pocTypeStartList[poc][typeID] = lineStartPos;
+
+                    // update number of frames
+                    if( poc+1 > numFrames )
+                    {
+                        numFrames = poc+1;
+                        p_numberFrames = numFrames;
+                        p_endFrame = p_numberFrames - 1;
+                    }
                 }
+                // typeID and POC stayed the same (at the start of a range)
+                // do nothing
             }
-            // typeID and POC stayed the same
-            // do nothing
         }
+
+        // an interrupted parse must not be stored
+        if (!p_cancelBackgroundParser)
+            writeIndexToSidecar();
+
         p_status = "OK";
         emit informationChanged();
 
-        inputFile.close();
-
     } // try
     catch ( const char * str ) {
         std::cerr << "Error while parsing meta data: " << str << '\n';
@@ -424,14 +782,142 @@ void StatisticsObject::readFrameAndTypePositionsFromFile()
     return;
 }
 
+// Layout of the index sidecar file (host byte order, it is only a cache):
+// SidecarIndexHeader followed by numEntries SidecarIndexEntry
+#define SIDECAR_INDEX_MAGIC     "YUVStIdx"
+#define SIDECAR_INDEX_VERSION   1
+#define SIDECAR_INDEX_SUFFIX    ".yuviewidx"
+
+struct SidecarIndexHeader
+{
+    char magic[8];
+    qint32 version;
+    qint32 sortedByPOC;
+    qint64 csvSize;         // size and modification time of the statistics file the index belongs to
+    qint64 csvModified;     // ms since epoch
+    qint32 numFrames;
+    qint32 numEntries;
+};
+
+struct SidecarIndexEntry
+{
+    qint32 poc;
+    qint32 typeID;
+    qint64 startPos;
+};
+
+QString StatisticsObject::sidecarIndexPath()
+{
+    return p_srcFilePath + SIDECAR_INDEX_SUFFIX;
+}
+
+bool StatisticsObject::readIndexFromSidecar()
+{
+    QFile indexFile(sidecarIndexPath());
+    if (!indexFile.open(QIODevice::ReadOnly) || indexFile.size() < (qint64)sizeof(SidecarIndexHeader))
+        return false;
+
+    const qint64 indexSize = indexFile.size();
+    uchar *indexData = indexFile.map(0, indexSize);
+    if (indexData == NULL)
+        return false;
+
+    // the index is only valid for exactly the statistics file it was created from
+    const SidecarIndexHeader *header = (const SidecarIndexHeader*)indexData;
+    const QFileInfo csvInfo(p_srcFilePath);
+    bool valid = memcmp(header->magic, SIDECAR_INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == SIDECAR_INDEX_VERSION &&
+                 header->csvSize == csvInfo.size() &&
+                 header->csvModified == csvInfo.lastModified().toMSecsSinceEpoch() &&
+                 header->numEntries > 0 &&
+                 indexSize == (qint64)sizeof(SidecarIndexHeader) + (qint64)header->numEntries * (qint64)sizeof(SidecarIndexEntry);
+
+    if (valid)
+    {
+        const SidecarIndexEntry *entries = (const SidecarIndexEntry*)(indexData + sizeof(SidecarIndexHeader));
+        for (int i = 0; i < header->numEntries; i++)
+            p_pocTypeStartList[entries[i].poc][entries[i].typeID] = entries[i].startPos;
+
+        bFileSortedByPOC = header->sortedByPOC != 0;
+        p_numberFrames = header->numFrames;
+        p_endFrame = p_numberFrames - 1;
+    }
+
+    indexFile.unmap(indexData);
+    return valid;
+}
+
+void StatisticsObject::writeIndexToSidecar()
+{
+    SidecarIndexHeader header;
+    memcpy(header.magic, SIDECAR_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SIDECAR_INDEX_VERSION;
+    header.sortedByPOC = bFileSortedByPOC ? 1 : 0;
+    const QFileInfo csvInfo(p_srcFilePath);
+    header.csvSize = csvInfo.size();
+    header.csvModified = csvInfo.lastModified().toMSecsSinceEpoch();
+    header.numFrames = p_numberFrames;
+
+    QByteArray entries;
+    QMap<int,QMap<int,qint64> >::const_iterator pocIt;
+    for (pocIt = p_pocTypeStartList.constBegin(); pocIt != p_pocTypeStartList.constEnd(); pocIt++)
+    {
+        QMap<int,qint64>::const_iterator typeIt;
+        for (typeIt = pocIt.value().constBegin(); typeIt != pocIt.value().constEnd(); typeIt++)
+        {
+            SidecarIndexEntry entry;
+            entry.poc = pocIt.key();
+            entry.typeID = typeIt.key();
+            entry.startPos = typeIt.value();
+            entries.append((const char*)&entry, sizeof(entry));
+        }
+    }
+    header.numEntries = entries.size() / sizeof(SidecarIndexEntry);
+    if (header.numEntries == 0)
+        return;
+
+    // the index is optional, so it is no error if the directory is not writable
+    QFile indexFile(sidecarIndexPath());
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+
+    if (indexFile.write((const char*)&header, sizeof(header)) != (qint64)sizeof(header) || indexFile.write(entries) != entries.size())
+    {
+        indexFile.close();
+        indexFile.remove();
+    }
+}
+
 void StatisticsObject::readHeaderFromFile()
 {
-    try {
-        QFile inputFile(p_srcFilePath);
+    QFile inputFile(p_srcFilePath);
 
-        if(inputFile.open(QIODevice::ReadOnly) == false)
-            return;
+    if(inputFile.open(QIODevice::ReadOnly) == false)
+        return;
+
+    if (!p_binaryFormat)
+    {
+        readHeaderFromDevice(&inputFile);
+        return;
+    }
 
+    // the header lines of the CSV file are embedded in the binary file
+    uchar headerData[BINARY_STATS_HEADER_SIZE];
+    if (inputFile.read((char*)headerData, BINARY_STATS_HEADER_SIZE) != BINARY_STATS_HEADER_SIZE)
+        return;
+    BinaryStatsHeader header = parseBinaryStatsHeader(headerData);
+    if (header.headerTextOffset < BINARY_STATS_HEADER_SIZE || header.headerTextSize < 0 || header.headerTextOffset + header.headerTextSize > inputFile.size() || !inputFile.seek(header.headerTextOffset))
+        return;
+
+    QByteArray headerText = inputFile.read(header.headerTextSize);
+    QBuffer headerBuffer(&headerText);
+    headerBuffer.open(QIODevice::ReadOnly);
+    readHeaderFromDevice(&headerBuffer);
+}
+
+void StatisticsObject::readHeaderFromDevice(QIODevice *device)
+{
+    try {
         // cleanup old types
         p_statsTypeList.clear();
 
@@ -441,10 +927,10 @@ void StatisticsObject::readHeaderFromFile()
         bool typeParsingActive = false;
         StatisticsType aType;
 
-        while (!inputFile.atEnd())
+        while (!device->atEnd())
         {
             // read one line
-            QByteArray aLineByteArray = inputFile.readLine();
+            QByteArray aLineByteArray = device->readLine();
             QString aLine(aLineByteArray);
 
             // get components of this line
@@ -489,10 +975,12 @@ void StatisticsObject::readHeaderFromFile()
             else if (rowItemList[1] == "range")
             {
                 aType.colorRange = new ColorRange(rowItemList);
+                aType.colorRange->buildLUT();
             }
             else if (rowItemList[1] == "defaultRange")
             {
                 aType.colorRange = new DefaultColorRange(rowItemList);
+                aType.colorRange->buildLUT();
             }
             else if (rowItemList[1] == "vectorColor")
             {
@@ -533,7 +1021,9 @@ void StatisticsObject::readHeaderFromFile()
             }
         }
 
-        inputFile.close();
+        // the header text of a binary file ends with the last type
+        if (typeParsingActive)
+            p_statsTypeList.append(aType);
 
     } // try
     catch ( const char * str ) {
@@ -550,17 +1040,23 @@ void StatisticsObject::readHeaderFromFile()
     return;
 }
 
-void StatisticsObject::readStatisticsFromFile(int frameIdx, int typeID)
+StatisticsItemList StatisticsObject::readStatisticsFromFile(int frameIdx, int typeID, const StatisticsLoadContext &context)
 {
+    if (p_binaryFormat)
+        return readStatisticsFromBinary(frameIdx, typeID, context);
+
     try {
         QFile inputFile(p_srcFilePath);
 
         if(inputFile.open(QIODevice::ReadOnly) == false)
-            return;
+            return StatisticsItemList();
+
+        // all types that are parsed (see bFileSortedByPOC)
+        QHash<int,StatisticsItemList> pocStats;
+
+        char lineBuffer[STATS_LINE_BUFFER_SIZE];
+        StatsLineFields fields;
 
-        StatisticsItem anItem;
-        QTextStream in(&inputFile);
-        
         Q_ASSERT_X(p_pocTypeStartList.contains(frameIdx) && p_pocTypeStartList[frameIdx].contains(typeID), "StatisticsObject::readStatisticsFromFile", "POC/type not found in file. Do not call this function with POC/types that do not exist.");
         qint64 startPos = p_pocTypeStartList[frameIdx][typeID];
         if (bFileSortedByPOC)
@@ -578,21 +1074,22 @@ void StatisticsObject::readStatisticsFromFile(int frameIdx, int typeID)
         }
 
         // fast forward
-        in.seek(startPos);
+        inputFile.seek(startPos);
 
-        while (!in.atEnd())
+        qint64 lineLength;
+        while ((lineLength = readStatsLine(&inputFile, lineBuffer)) >= 0)
         {
-            // read one line
-            QString aLine = in.readLine();
-
             // get components of this line
-            QStringList rowItemList = parseCSVLine(aLine, ';');
+            tokenizeStatsLine(lineBuffer, lineLength, fields);
 
-            if (rowItemList[0].isEmpty())
+            if (fields.isEmpty())
                 continue;
 
-            int poc = rowItemList[0].toInt();
-            int type = rowItemList[5].toInt();
+            if (fields.count < 7)
+                throw "A line of the statistics file has too few values.";
+
+            int poc = fields.toInt(0);
+            int type = fields.toInt(5);
 
             // if there is a new poc, we are done here!
             if( poc != frameIdx )
@@ -601,88 +1098,313 @@ void StatisticsObject::readStatisticsFromFile(int frameIdx, int typeID)
             if ( !bFileSortedByPOC && type != typeID )
                 break;
 
-            int value1 = rowItemList[6].toInt();
-            int value2 = (rowItemList.count()>=8)?rowItemList[7].toInt():0;
+            int value1 = fields.toInt(6);
+            int value2 = (fields.count>=8)?fields.toInt(7):0;
 
-            int posX = rowItemList[1].toInt();
-            int posY = rowItemList[2].toInt();
-            unsigned int width = rowItemList[3].toUInt();
-            unsigned int height = rowItemList[4].toUInt();
+            int posX = fields.toInt(1);
+            int posY = fields.toInt(2);
+            unsigned int width = fields.toUInt(3);
+            unsigned int height = fields.toUInt(4);
 
-            // Check if block is within the image range
-            if (posX + width > p_width || posY + height > p_height) {
-              // Block not in image
-              throw("A block is outside of the specified image size in the statistics file.");
-            }
+            addStatisticsItem(pocStats[type], context, type, posX, posY, width, height, value1, value2);
+        }
+        inputFile.close();
 
-            StatisticsType *statsType = getStatisticsType(type);
-            Q_ASSERT_X(statsType != NULL, "StatisticsObject::readStatisticsFromFile", "Stat type not found.");
-            anItem.type = ((statsType->visualizationType == colorMapType) || (statsType->visualizationType == colorRangeType)) ? blockType : arrowType;
+        QHash<int,StatisticsItemList>::iterator it;
+        for (it = pocStats.begin(); it != pocStats.end(); it++)
+        {
+            it.value().buildIndex(context.width, context.height);
+            insertIntoStatisticsCache(frameIdx, it.key(), it.value());
+        }
 
-            anItem.positionRect = QRect(posX, posY, width, height);
+        return pocStats.value(typeID);
 
-            anItem.rawValues[0] = value1;
-            anItem.rawValues[1] = value2;
-            anItem.color = QColor();
+    } // try
+    catch ( const char * str ) {
+        std::cerr << "Error while parsing: " << str << '\n';
+        reportLoadError(QString("Error while parsing meta data: ") + QString(str));
+        return StatisticsItemList();
+    }
+    catch (...) {
+        std::cerr << "Error while parsing.";
+        reportLoadError(QString("Error while parsing meta data."));
+        return StatisticsItemList();
+    }
+}
 
-            if (statsType->visualizationType == colorMapType)
-            {
-                ColorMap colorMap = statsType->colorMap;
-                anItem.color = colorMap[value1];
-            }
-            else if (statsType->visualizationType == colorRangeType)
+void StatisticsObject::addStatisticsItem(StatisticsItemList &statsList, const StatisticsLoadContext &context, int type, int posX, int posY, unsigned int width, unsigned int height, int value1, int value2)
+{
+    // Check if block is within the image range
+    if (posX + width > (unsigned int)context.width || posY + height > (unsigned int)context.height) {
+      // Block not in image
+      throw("A block is outside of the specified image size in the statistics file.");
+    }
+
+    Q_ASSERT_X(context.isVectorType.contains(type), "StatisticsObject::addStatisticsItem", "Stat type not found.");
+
+    // the second value is only used by vectors
+    statsList.append(posX, posY, width, height, value1, value2, context.isVectorType.value(type));
+}
+
+bool StatisticsObject::readChunkTableFromBinary()
+{
+    p_binaryFile.setFileName(p_srcFilePath);
+    if (!p_binaryFile.open(QIODevice::ReadOnly) || p_binaryFile.size() < BINARY_STATS_HEADER_SIZE)
+        return false;
+
+    const qint64 fileSize = p_binaryFile.size();
+    uchar *data = p_binaryFile.map(0, fileSize);
+    if (data == NULL)
+        return false;
+
+    BinaryStatsHeader header = parseBinaryStatsHeader(data);
+    bool valid = memcmp(header.magic, BINARY_STATS_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == BINARY_STATS_VERSION &&
+                 header.numChunks >= 0 &&
+                 header.chunkTableOffset >= BINARY_STATS_HEADER_SIZE &&
+                 header.chunkTableOffset + (qint64)header.numChunks * BINARY_STATS_CHUNK_SIZE <= fileSize;
+
+    QVector<BinaryStatsChunk> chunks;
+    if (valid)
+        chunks.resize(header.numChunks);
+
+    for (int i = 0; valid && i < header.numChunks; i++)
+    {
+        chunks[i] = parseBinaryStatsChunk(data + header.chunkTableOffset + (qint64)i * BINARY_STATS_CHUNK_SIZE);
+        valid = chunks[i].count >= 0 && chunks[i].offset >= BINARY_STATS_HEADER_SIZE &&
+                chunks[i].offset + (qint64)chunks[i].count * BINARY_STATS_RECORD_SIZE <= fileSize;
+    }
+
+    if (!valid)
+    {
+        p_binaryFile.unmap(data);
+        p_binaryFile.close();
+        return false;
+    }
+
+    p_binaryChunks = chunks;
+    p_binaryData = data;
+    for (int i = 0; i < chunks.count(); i++)
+        p_pocTypeStartList[chunks[i].poc][chunks[i].typeID] = i;
+
+    p_numberFrames = header.numFrames;
+    p_endFrame = p_numberFrames - 1;
+
+    return true;
+}
+
+StatisticsItemList StatisticsObject::readStatisticsFromBinary(int frameIdx, int typeID, const StatisticsLoadContext &context)
+{
+    try {
+        Q_ASSERT_X(p_pocTypeStartList.contains(frameIdx) && p_pocTypeStartList[frameIdx].contains(typeID), "StatisticsObject::readStatisticsFromBinary", "POC/type not found in file. Do not call this function with POC/types that do not exist.");
+        if (p_binaryData == NULL)
+            return StatisticsItemList();
+
+        const BinaryStatsChunk &chunk = p_binaryChunks[p_pocTypeStartList[frameIdx][typeID]];
+
+        Q_ASSERT_X(context.isVectorType.contains(typeID), "StatisticsObject::readStatisticsFromBinary", "Stat type not found.");
+        StatisticsItemList statsList;
+        statsList.reserve(chunk.count, context.isVectorType.value(typeID));
+
+        const uchar *record = p_binaryData + chunk.offset;
+        for (int i = 0; i < chunk.count; i++, record += BINARY_STATS_RECORD_SIZE)
+        {
+            int posX = qFromLittleEndian<qint32>(record);
+            int posY = qFromLittleEndian<qint32>(record + 4);
+            int width = qFromLittleEndian<qint32>(record + 8);
+            int height = qFromLittleEndian<qint32>(record + 12);
+            int value1 = qFromLittleEndian<qint32>(record + 16);
+            int value2 = qFromLittleEndian<qint32>(record + 20);
+
+            addStatisticsItem(statsList, context, typeID, posX, posY, width, height, value1, value2);
+        }
+
+        statsList.buildIndex(context.width, context.height);
+        insertIntoStatisticsCache(frameIdx, typeID, statsList);
+        return statsList;
+
+    } // try
+    catch ( const char * str ) {
+        std::cerr << "Error while parsing: " << str << '\n';
+        reportLoadError(QString("Error while parsing meta data: ") + QString(str));
+        return StatisticsItemList();
+    }
+    catch (...) {
+        std::cerr << "Error while parsing.";
+        reportLoadError(QString("Error while parsing meta data."));
+        return StatisticsItemList();
+    }
+}
+
+bool StatisticsObject::isBinaryStatisticsFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    return file.read(8) == QByteArray(BINARY_STATS_MAGIC);
+}
+
+// Write the buffered records of one POC as one chunk per type
+static void flushBinaryStatsChunks(QFile &binaryFile, int poc, QMap<int,QByteArray> &pendingRecords, QVector<BinaryStatsChunk> &chunks, QSet<qint64> &convertedPOCTypes, qint64 &filePos)
+{
+    QMap<int,QByteArray>::const_iterator it;
+    for (it = pendingRecords.constBegin(); it != pendingRecords.constEnd(); it++)
+    {
+        const qint64 pocTypeKey = ((qint64)poc << 32) | (quint32)it.key();
+        if (convertedPOCTypes.contains(pocTypeKey))
+            throw "The data for each POC/type must be continuous in the statistics file.";
+        convertedPOCTypes.insert(pocTypeKey);
+
+        BinaryStatsChunk chunk;
+        chunk.poc = poc;
+        chunk.typeID = it.key();
+        chunk.offset = filePos;
+        chunk.count = it.value().size() / BINARY_STATS_RECORD_SIZE;
+        chunk.reserved = 0;
+        chunks.append(chunk);
+
+        if (binaryFile.write(it.value()) != it.value().size())
+            throw "Error writing the binary statistics file.";
+        filePos += it.value().size();
+    }
+    pendingRecords.clear();
+}
+
+bool StatisticsObject::convertCSVToBinary(const QString &csvPath, const QString &binaryPath, QString *error, const bool *cancel, int *progress)
+{
+    QFile csvFile(csvPath);
+    if (!csvFile.open(QIODevice::ReadOnly))
+    {
+        *error = QString("Could not open %1.").arg(csvPath);
+        return false;
+    }
+
+    QFile binaryFile(binaryPath);
+    if (!binaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        *error = QString("Could not create %1.").arg(binaryPath);
+        return false;
+    }
+
+    BinaryStatsHeader header;
+    memcpy(header.magic, BINARY_STATS_MAGIC, sizeof(header.magic));
+    header.version = BINARY_STATS_VERSION;
+    header.numFrames = 0;
+    header.headerTextOffset = 0;
+    header.headerTextSize = 0;
+    header.chunkTableOffset = 0;
+    header.numChunks = 0;
+    header.reserved = 0;
+
+    try {
+        // the header is written again with the final offsets when all records are written
+        QByteArray headerData = serializeBinaryStatsHeader(header);
+        if (binaryFile.write(headerData) != headerData.size())
+            throw "Error writing the binary statistics file.";
+        qint64 filePos = headerData.size();
+
+        // the records of each POC are collected per type, so every POC/type is stored in one chunk
+        // even if the types are interleaved within a POC
+        QByteArray headerText;
+        bool headerComplete = false;
+        QMap<int,QByteArray> pendingRecords;
+        QVector<BinaryStatsChunk> chunks;
+        QSet<qint64> convertedPOCTypes;
+        int currentPOC = INT_INVALID;
+
+        char lineBuffer[STATS_LINE_BUFFER_SIZE];
+        StatsLineFields fields;
+        const qint64 fileSize = qMax((qint64)1, csvFile.size());
+        int lineCount = 0;
+        while (!csvFile.atEnd())
+        {
+            if ((++lineCount & 0xFFF) == 0)
             {
-                if (statsType->scaleToBlockSize)
-                    anItem.color = statsType->colorRange->getColor((float)value1 / (float)(anItem.positionRect.width() * anItem.positionRect.height()));
-                else
-                    anItem.color = statsType->colorRange->getColor((float)value1);
+                if (cancel != NULL && *cancel)
+                    throw "The conversion was canceled.";
+                if (progress != NULL)
+                    *progress = (int)(csvFile.pos() * 100 / fileSize);
             }
-            else if (statsType->visualizationType == vectorType)
+
+            // header lines may be longer than the line buffer
+            if (!headerComplete)
             {
-                // find color
-                anItem.color = statsType->vectorColor;
+                QByteArray aLineByteArray = csvFile.readLine();
+                tokenizeStatsLine(aLineByteArray.constData(), aLineByteArray.size(), fields);
+                if (fields.isEmpty())
+                    continue;
 
-                // calculate the vector size
-                anItem.vector[0] = (float)value1 / statsType->vectorSampling;
-                anItem.vector[1] = (float)value2 / statsType->vectorSampling;
+                // keep the header lines, they describe the types
+                if (fields.isHeader())
+                {
+                    headerText.append(aLineByteArray);
+                    continue;
+                }
+                headerComplete = true;
             }
-
-            // set grid color. if unset for this type, use color of type for grid, too
-            if (statsType->gridColor.isValid())
+            else
             {
-                anItem.gridColor = statsType->gridColor;
+                qint64 lineLength = readStatsLine(&csvFile, lineBuffer);
+                if (lineLength < 0)
+                    break;
+                tokenizeStatsLine(lineBuffer, lineLength, fields);
+                if (fields.isEmpty() || fields.isHeader())
+                    continue;
             }
-            else
+
+            if (fields.count < 7)
+                throw "A line of the statistics file has too few values.";
+
+            int poc = fields.toInt(0);
+            int type = fields.toInt(5);
+
+            if (poc != currentPOC)
             {
-                anItem.gridColor = anItem.color;
+                flushBinaryStatsChunks(binaryFile, currentPOC, pendingRecords, chunks, convertedPOCTypes, filePos);
+                currentPOC = poc;
+                header.numFrames = qMax(header.numFrames, poc+1);
             }
 
-            p_statsCache[poc][type].append(anItem);
+            QByteArray &records = pendingRecords[type];
+            appendLE32(records, fields.toInt(1));
+            appendLE32(records, fields.toInt(2));
+            appendLE32(records, fields.toUInt(3));
+            appendLE32(records, fields.toUInt(4));
+            appendLE32(records, fields.toInt(6));
+            appendLE32(records, (fields.count>=8)?fields.toInt(7):0);
         }
-        inputFile.close();
+        flushBinaryStatsChunks(binaryFile, currentPOC, pendingRecords, chunks, convertedPOCTypes, filePos);
+
+        header.headerTextOffset = filePos;
+        header.headerTextSize = headerText.size();
+        header.chunkTableOffset = filePos + headerText.size();
+        header.numChunks = chunks.count();
+
+        QByteArray chunkTable;
+        for (int i = 0; i < chunks.count(); i++)
+            appendBinaryStatsChunk(chunkTable, chunks[i]);
+
+        headerData = serializeBinaryStatsHeader(header);
+        if (binaryFile.write(headerText) != headerText.size() || binaryFile.write(chunkTable) != chunkTable.size() ||
+            !binaryFile.seek(0) || binaryFile.write(headerData) != headerData.size())
+            throw "Error writing the binary statistics file.";
 
     } // try
     catch ( const char * str ) {
-        std::cerr << "Error while parsing: " << str << '\n';
-        setErrorState(QString("Error while parsing meta data: ") + QString(str));
-        return;
-    }
-    catch (...) {
-        std::cerr << "Error while parsing.";
-        setErrorState(QString("Error while parsing meta data."));
-        return;
+        *error = QString(str);
+        binaryFile.close();
+        binaryFile.remove();
+        return false;
     }
 
-    return;
+    binaryFile.close();
+    return true;
 }
 
 QStringList StatisticsObject::parseCSVLine(QString line, char delimiter)
 {
-    // first, trim newline and whitespaces from both ends of line
-    line = line.trimmed().replace(" ", "");
-
-    // now split string with delimiter
-    return line.split(delimiter);
+    return parseStatsCSVLine(line, delimiter);
 }
 
 StatisticsType* StatisticsObject::getStatisticsType(int typeID)
@@ -698,6 +1420,9 @@ StatisticsType* StatisticsObject::getStatisticsType(int typeID)
 
 void StatisticsObject::setStatisticsTypeList(StatisticsTypeList typeList)
 {
+    // the prefetch thread reads the types, and it may load types which are not rendered anymore
+    stopPrefetching();
+
     // we do not overwrite our statistics type, we just change their parameters
     foreach(StatisticsType aType, typeList)
     {
@@ -714,9 +1439,36 @@ void StatisticsObject::setStatisticsTypeList(StatisticsTypeList typeList)
 
 void StatisticsObject::setErrorState(QString sError)
 {
+    // the prefetch thread reads the POC/type positions
+    stopPrefetching();
+
     // The statistics file is invalid. Set the error message.
     p_numberFrames = 0;
     p_pocTypeStartList.clear();
     p_status = sError;
     emit informationChanged();
 }
+
+void StatisticsObject::reportLoadError(QString sError)
+{
+    if (QThread::currentThread() == thread())
+    {
+        setErrorState(sError);
+        return;
+    }
+
+    // prefetch thread: the GUI thread may be reading the POC/type positions
+    if (p_prefetchError.isEmpty())
+        p_prefetchError = sError;
+    p_cancelPrefetch = true;
+}
+
+void StatisticsObject::applyPrefetchError()
+{
+    if (p_prefetchFuture.isRunning() || p_prefetchError.isEmpty())
+        return;
+
+    QString sError = p_prefetchError;
+    p_prefetchError.clear();
+    setErrorState(sError);
+}
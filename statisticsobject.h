@@ -27,10 +27,84 @@
 #include <QMap>
 #include <QHash>
 #include <QFuture>
+#include <QCache>
+#include <QMutex>
+#include <QPainter>
+#include <QFile>
+#include <QIODevice>
+#include <QPair>
+
+class YUVFile;
 
-typedef QList<StatisticsItem> StatisticsItemList;
 typedef QVector<StatisticsType> StatisticsTypeList;
 
+// What loading the statistics of a POC/type needs to know. It is taken in the GUI thread (see loadContext),
+// so the prefetch thread does not read members which the GUI thread may change while it is running.
+struct StatisticsLoadContext
+{
+    int width;
+    int height;
+    QHash<int,bool> isVectorType;   // for every type of the file: is it a vector type?
+
+    // the two frames of computed statistics (QualityMapObject), NULL for statistics files
+    YUVFile *sourceFiles[2];
+    int sourceBitDepth;
+};
+
+class StatisticsCacheIdx
+{
+public:
+    StatisticsCacheIdx(const void *obj, int frameIdx, int type) { object=obj; poc=frameIdx; typeID=type; }
+
+    const void *object;     // the StatisticsObject the statistics belong to
+    int poc;
+    int typeID;
+};
+
+inline bool operator==(const StatisticsCacheIdx &e1, const StatisticsCacheIdx &e2)
+{
+    return e1.object == e2.object && e1.poc == e2.poc && e1.typeID == e2.typeID;
+}
+
+inline uint qHash(const StatisticsCacheIdx &cIdx)
+{
+    return qHash(cIdx.object) ^ qHash(cIdx.poc) ^ qHash(cIdx.typeID << 16);
+}
+
+// Binary statistics format (*.yuvstats, little endian). Layout:
+// BinaryStatsHeader, the records of all chunks, the header lines of the CSV file ('%' lines, UTF-8)
+// and the chunk table (numChunks BinaryStatsChunk). Every POC/type of the CSV file is stored in exactly one chunk.
+struct BinaryStatsHeader
+{
+    char magic[8];
+    qint32 version;
+    qint32 numFrames;
+    qint64 headerTextOffset;
+    qint64 headerTextSize;
+    qint64 chunkTableOffset;
+    qint32 numChunks;
+    qint32 reserved;
+};
+
+struct BinaryStatsChunk
+{
+    qint32 poc;
+    qint32 typeID;
+    qint64 offset;      // file position of the first record
+    qint32 count;       // number of records
+    qint32 reserved;
+};
+
+struct BinaryStatsRecord
+{
+    qint32 x;
+    qint32 y;
+    qint32 width;
+    qint32 height;
+    qint32 value1;
+    qint32 value2;
+};
+
 class StatisticsObject : public DisplayObject
 {
 public:
@@ -45,7 +119,12 @@ public:
 
     ValuePairList getValuesAt(int x, int y);
 
-    void setInternalScaleFactor(int internalScaleFactor);
+    // the block fills are rendered at native resolution, vectors and grids are drawn by drawOverlay at the zoom
+    void setInternalScaleFactor(int) {}
+
+    //! Draw the statistics of the loaded frame, with the frame mapped to displayRect. Only the part within
+    //! clipRect is drawn: the scaled block layer (displayImage()) and the vectors and grids of the visible blocks.
+    void drawOverlay(QPainter *painter, const QRect &displayRect, const QRect &clipRect);
 
     StatisticsType* getStatisticsType(int typeID);
 
@@ -53,48 +132,127 @@ public:
     StatisticsTypeList getStatisticsTypeList() { return p_statsTypeList; }
 
     int numFrames() { return p_numberFrames; }
-    int nrBytes() { return p_numBytes; }
-    
+    qint64 nrBytes() { return p_numBytes; }
+
+    //! Is the given file in the binary statistics format?
+    static bool isBinaryStatisticsFile(const QString &filePath);
+    // The parsed statistics of all statistics objects (least recently used lists are evicted).
+    // The cost of a list is its memory footprint in KiB.
+    static QCache<StatisticsCacheIdx, StatisticsItemList> statisticsCache;
+    static void setStatisticsCacheSizeInMB(unsigned int sizeInMB);
+    // current usage, number of lists and evictions of the statistics cache
+    static QString statisticsCacheStatus();
+
+    // number of POCs the prefetch thread reads ahead of the play head (0 disables prefetching)
+    static int prefetchDepth;
+
+    // start loading the rendered types of the next prefetchDepth POCs after frameIdx (in steps of step) in the background
+    void prefetchStatistics(int frameIdx, int step);
+    void stopPrefetching();
+
+    //! Convert a CSV statistics file to the binary statistics format in a single pass.
+    //! Returns false and sets error if the CSV file could not be converted. The conversion may run in a
+    //! background thread: it stops when *cancel is set and writes the percentage of the file read to *progress.
+    static bool convertCSVToBinary(const QString &csvPath, const QString &binaryPath, QString *error, const bool *cancel = NULL, int *progress = NULL);
+
+protected:
+    //! Statistics which are not read from a file (e.g. QualityMapObject). The subclass sets the types and
+    //! provides the statistics with hasStatistics() and loadStatistics().
+    explicit StatisticsObject(QObject* parent);
+
+    //! Are there statistics for the POC/type? By default: is the POC/type in the file?
+    virtual bool hasStatistics(int frameIdx, int typeID);
+    //! Load statistics which are not in the cache and put them into the cache. By default they are read from the file.
+    //! Called from the prefetch thread as well, so only the context may be used for the parameters of the object.
+    virtual StatisticsItemList loadStatistics(int frameIdx, int typeID, const StatisticsLoadContext &context) { return readStatisticsFromFile(frameIdx, typeID, context); }
+    //! The context of loadStatistics with the current parameters (GUI thread)
+    virtual StatisticsLoadContext loadContext();
+
+    //! Get statistics. Try cache first, or load (using loadStatistics())
+    StatisticsItemList getStatistics(int frameIdx, int type);
+
+    void insertIntoStatisticsCache(int frameIdx, int typeID, const StatisticsItemList &statsList);
+    // remove all lists of this object from the statistics cache
+    void removeFromStatisticsCache();
+
+    StatisticsTypeList p_statsTypeList;
+    int p_numberFrames;
+
 private:
     //! Scan the header: What types are saved in this file?
     void readHeaderFromFile();
+    void readHeaderFromDevice(QIODevice *device);
     //! Parser the whole file and get the positions where a new POC/type starts. Save this position in p_pocTypeStartList.
     //! This is performed in the background
     void readFrameAndTypePositionsFromFile();
-    //! Load the statistics with frameIdx/type from file and put it into the cache.
+    //! The POC/type start positions are saved in a binary sidecar file next to the statistics file. On the next
+    //! open the (memory mapped) index is used if size and modification time of the statistics file did not change.
+    QString sidecarIndexPath();
+    bool readIndexFromSidecar();
+    void writeIndexToSidecar();
+    //! Load the statistics with frameIdx/type from file, put it into the cache and return it.
     //! If the statistics file is in an interleaved format (types are mixed within one POC) this function also parses
     //! types which were not requested by the given 'type'.
-    void readStatisticsFromFile(int frameIdx, int type);
+    StatisticsItemList readStatisticsFromFile(int frameIdx, int type, const StatisticsLoadContext &context);
 
-    //! Get statistics. Try cache first, or load (using readStatisticsFromFile())
-    StatisticsItemList getStatistics(int frameIdx, int type);
+    //! Binary files: map the file and read the chunk table. p_pocTypeStartList holds the chunk index of each POC/type.
+    bool readChunkTableFromBinary();
+    StatisticsItemList readStatisticsFromBinary(int frameIdx, int type, const StatisticsLoadContext &context);
+
+    //! Append one block of the statistics file to statsList
+    void addStatisticsItem(StatisticsItemList &statsList, const StatisticsLoadContext &context, int type, int posX, int posY, unsigned int width, unsigned int height, int value1, int value2);
+
+    void prefetchWorker(QList< QPair<int,int> > loadList, StatisticsLoadContext context);
 
     void drawStatisticsImage(int frameIdx);
-    void drawStatisticsImage(StatisticsItemList statsList, StatisticsType statsType);
+    void drawStatisticsImage(const StatisticsItemList &statsList, StatisticsType statsType);
+    void drawVectorsAndGrid(QPainter *painter, const StatisticsItemList &statsList, StatisticsType statsType, QPoint origin, double zoom, const QRect &srcVisible);
 
     //! Error while parsing. Set the error message that will be returned by status(). Also set p_numberFrames to 0, clear p_pocStartList.
     void setErrorState(QString sError);
+    //! Error while loading a POC/type. The prefetch thread only records the error and stops, the error state is
+    //! set by applyPrefetchError in the GUI thread when the prefetch is finished.
+    void reportLoadError(QString sError);
+    void applyPrefetchError();
 
-    QStringList parseCSVLine(QString line, char delimiter);
+    static QStringList parseCSVLine(QString line, char delimiter);
 
-    QHash< int,QHash< int,StatisticsItemList > > p_statsCache; // 2D map of type StatisticsItemList with indexing: [POC][statsTypeID]
-    StatisticsTypeList p_statsTypeList;
+    // the prefetch thread and the GUI thread both access the cache
+    static QMutex statisticsCacheMutex;
+    static int statisticsCacheCost(const StatisticsItemList &statsList);
+    // number of lists that were pushed out of the statistics cache because it was full
+    static int statisticsCacheEvictions;
 
     QFuture<void> p_backgroundParserFuture;
     bool p_cancelBackgroundParser;
 
+    // the lists of the loaded frame per type (drawn by drawOverlay)
+    QHash<int,StatisticsItemList> p_currentStats;
+
+    QFuture<void> p_prefetchFuture;
+    bool p_cancelPrefetch;
+    // the POCs the running prefetch was started for
+    int p_prefetchFirstPOC;
+    int p_prefetchLastPOC;
+    // error of the last prefetch, written by the prefetch thread (see reportLoadError)
+    QString p_prefetchError;
+
     QMap<int,QMap<int,qint64> > p_pocTypeStartList;
 
     QString p_srcFilePath;
     QString p_createdTime;
     QString p_modifiedTime;
-    int     p_numBytes;
-
-    int p_numberFrames;
+    qint64  p_numBytes;
 
     // Set if the file is sorted by POC and the types are 'random' within this POC (true)
     // or if the file is sorted by typeID and the POC is 'random'
     bool bFileSortedByPOC;
+
+    // binary statistics file (mapped while the object exists)
+    bool p_binaryFormat;
+    QFile p_binaryFile;
+    const uchar *p_binaryData;
+    QVector<BinaryStatsChunk> p_binaryChunks;
 };
 
 #endif // STATISTICSMODEL_H
@@ -0,0 +1,138 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STATSLINETOKENIZER_H
+#define STATSLINETOKENIZER_H
+
+#include <QIODevice>
+#include <QStringList>
+#include <climits>
+#include <cstring>
+
+// Tokenizer for the data lines of CSV statistics files. The fields point into the line buffer and the
+// integers are parsed directly from the bytes, so a line is handled without any allocation.
+// The header lines are few and are still parsed with parseStatsCSVLine.
+#define STATS_MAX_FIELDS        16
+#define STATS_LINE_BUFFER_SIZE  4096
+
+inline bool isStatsWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+struct StatsLineFields
+{
+    const char *begin[STATS_MAX_FIELDS];
+    const char *end[STATS_MAX_FIELDS];
+    int count;
+
+    bool isEmpty() const { return count == 0 || begin[0] == end[0]; }
+    bool isHeader() const { return !isEmpty() && *begin[0] == '%'; }
+
+    // Same result as QString::toInt on the field with all spaces removed: 0 if the field is no valid number
+    int toInt(int i) const
+    {
+        if (i >= count)
+            return 0;
+
+        const char *c = begin[i];
+        bool negative = false;
+        while (c != end[i] && *c == ' ')
+            c++;
+        if (c != end[i] && (*c == '-' || *c == '+'))
+            negative = (*c++ == '-');
+
+        qint64 value = 0;
+        bool haveDigits = false;
+        for (; c != end[i]; c++)
+        {
+            if (*c >= '0' && *c <= '9')
+            {
+                value = value*10 + (*c - '0');
+                if (value > (qint64)INT_MAX + 1)
+                    return 0;
+                haveDigits = true;
+            }
+            else if (*c != ' ')
+                return 0;
+        }
+        if (negative)
+            value = -value;
+        return (haveDigits && value >= INT_MIN && value <= INT_MAX) ? (int)value : 0;
+    }
+    unsigned int toUInt(int i) const { int value = toInt(i); return (value < 0) ? 0 : value; }
+};
+
+inline void tokenizeStatsLine(const char *line, qint64 length, StatsLineFields &fields)
+{
+    const char *lineEnd = line + length;
+    fields.count = 0;
+    while (fields.count < STATS_MAX_FIELDS)
+    {
+        const char *fieldEnd = (const char*)memchr(line, ';', lineEnd - line);
+        if (fieldEnd == NULL)
+            fieldEnd = lineEnd;
+
+        // trim whitespaces from both ends of the field
+        const char *b = line;
+        const char *e = fieldEnd;
+        while (b != e && isStatsWhitespace(*b))
+            b++;
+        while (e != b && isStatsWhitespace(*(e-1)))
+            e--;
+        fields.begin[fields.count] = b;
+        fields.end[fields.count] = e;
+        fields.count++;
+
+        if (fieldEnd == lineEnd)
+            break;
+        line = fieldEnd + 1;
+    }
+}
+
+// Read one line into buffer (of size STATS_LINE_BUFFER_SIZE). The rest of lines which do not fit into the
+// buffer is skipped, only header lines can be that long. Returns the length of the line or -1 at the end.
+inline qint64 readStatsLine(QIODevice *device, char *buffer)
+{
+    if (device->atEnd())
+        return -1;
+
+    qint64 length = device->readLine(buffer, STATS_LINE_BUFFER_SIZE);
+    if (length <= 0)
+        return -1;
+    if (length == STATS_LINE_BUFFER_SIZE-1 && buffer[length-1] != '\n')
+    {
+        char c;
+        while (device->getChar(&c) && c != '\n')
+            ;
+    }
+    return length;
+}
+
+// The line parser of the header lines (and of the data lines before the tokenizer): the line is trimmed,
+// all spaces are removed and it is split at delimiter.
+inline QStringList parseStatsCSVLine(QString line, char delimiter)
+{
+    // first, trim newline and whitespaces from both ends of line
+    line = line.trimmed().replace(" ", "");
+
+    // now split string with delimiter
+    return line.split(delimiter);
+}
+
+#endif // STATSLINETOKENIZER_H
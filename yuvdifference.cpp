@@ -0,0 +1,189 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "yuvdifference.h"
+#include "cpufeatures.h"
+
+/////////////////////////////////////////////////////////////////////////////
+// scalar reference
+
+static void difference8_c(const unsigned char *srcA, const unsigned char *srcB, unsigned char *dst, int n, const YUVDifferenceParameters &params)
+{
+    for (int i = 0; i < n; ++i) {
+        int diff = (int)srcA[i] - (int)srcB[i];
+        if (params.absolute && diff < 0)
+            diff = -diff;
+        const int value = params.offset + params.scale * diff;
+        dst[i] = (value<0 ? 0 : (value>255 ? 255 : value));
+    }
+}
+
+static void difference16_c(const unsigned short *srcA, const unsigned short *srcB, unsigned short *dst, int n, const YUVDifferenceParameters &params, int bps)
+{
+    const int maxValue = (1<<bps)-1;
+
+    for (int i = 0; i < n; ++i) {
+        int diff = (int)srcA[i] - (int)srcB[i];
+        if (params.absolute && diff < 0)
+            diff = -diff;
+        const int value = params.offset + params.scale * diff;
+        dst[i] = (value<0 ? 0 : (value>maxValue ? maxValue : value));
+    }
+}
+
+#if YUVIEW_X86_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// SSE4.1 - 16 samples (8 bit) or 8 samples (16 bit) per iteration
+
+// offset + scale * (a-b) for 16 bit lanes (no overflow for 8 bit samples and scale <= YUV_DIFFERENCE_MAX_SCALE)
+YUVIEW_TARGET_SSE41 static inline __m128i difference16Lanes_sse41(__m128i a, __m128i b, __m128i offset, __m128i scale, bool absolute)
+{
+    __m128i diff = _mm_sub_epi16(a, b);
+    if (absolute)
+        diff = _mm_abs_epi16(diff);
+    return _mm_add_epi16(offset, _mm_mullo_epi16(diff, scale));
+}
+
+YUVIEW_TARGET_SSE41 static void difference8_sse41(const unsigned char *srcA, const unsigned char *srcB, unsigned char *dst, int n, const YUVDifferenceParameters &params)
+{
+    const __m128i offset = _mm_set1_epi16((short)params.offset);
+    const __m128i scale = _mm_set1_epi16((short)params.scale);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(srcA + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(srcB + i));
+        const __m128i lo = difference16Lanes_sse41(_mm_cvtepu8_epi16(a), _mm_cvtepu8_epi16(b), offset, scale, params.absolute);
+        const __m128i hi = difference16Lanes_sse41(_mm_cvtepu8_epi16(_mm_srli_si128(a, 8)), _mm_cvtepu8_epi16(_mm_srli_si128(b, 8)), offset, scale, params.absolute);
+
+        // the saturating pack clips to [0, 255]
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    difference8_c(srcA + i, srcB + i, dst + i, n - i, params);
+}
+
+YUVIEW_TARGET_SSE41 static inline __m128i difference32Lanes_sse41(__m128i a, __m128i b, __m128i offset, __m128i scale, __m128i maxValue, bool absolute)
+{
+    __m128i diff = _mm_sub_epi32(a, b);
+    if (absolute)
+        diff = _mm_abs_epi32(diff);
+    const __m128i value = _mm_add_epi32(offset, _mm_mullo_epi32(diff, scale));
+    return _mm_min_epi32(_mm_max_epi32(value, _mm_setzero_si128()), maxValue);
+}
+
+YUVIEW_TARGET_SSE41 static void difference16_sse41(const unsigned short *srcA, const unsigned short *srcB, unsigned short *dst, int n, const YUVDifferenceParameters &params, int bps)
+{
+    const __m128i offset = _mm_set1_epi32(params.offset);
+    const __m128i scale = _mm_set1_epi32(params.scale);
+    const __m128i maxValue = _mm_set1_epi32((1<<bps)-1);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(srcA + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(srcB + i));
+        const __m128i lo = difference32Lanes_sse41(_mm_cvtepu16_epi32(a), _mm_cvtepu16_epi32(b), offset, scale, maxValue, params.absolute);
+        const __m128i hi = difference32Lanes_sse41(_mm_cvtepu16_epi32(_mm_srli_si128(a, 8)), _mm_cvtepu16_epi32(_mm_srli_si128(b, 8)), offset, scale, maxValue, params.absolute);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi32(lo, hi));
+    }
+    difference16_c(srcA + i, srcB + i, dst + i, n - i, params, bps);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// AVX2 - 32 samples (8 bit) or 16 samples (16 bit) per iteration
+
+YUVIEW_TARGET_AVX2 static inline __m256i difference16Lanes_avx2(__m256i a, __m256i b, __m256i offset, __m256i scale, bool absolute)
+{
+    __m256i diff = _mm256_sub_epi16(a, b);
+    if (absolute)
+        diff = _mm256_abs_epi16(diff);
+    return _mm256_add_epi16(offset, _mm256_mullo_epi16(diff, scale));
+}
+
+YUVIEW_TARGET_AVX2 static void difference8_avx2(const unsigned char *srcA, const unsigned char *srcB, unsigned char *dst, int n, const YUVDifferenceParameters &params)
+{
+    const __m256i offset = _mm256_set1_epi16((short)params.offset);
+    const __m256i scale = _mm256_set1_epi16((short)params.scale);
+
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i lo = difference16Lanes_avx2(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcA + i))), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcB + i))), offset, scale, params.absolute);
+        const __m256i hi = difference16Lanes_avx2(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcA + i + 16))), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcB + i + 16))), offset, scale, params.absolute);
+
+        // the pack works per 128 bit lane, restore the order of the samples
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+    }
+    difference8_c(srcA + i, srcB + i, dst + i, n - i, params);
+}
+
+YUVIEW_TARGET_AVX2 static inline __m256i difference32Lanes_avx2(__m256i a, __m256i b, __m256i offset, __m256i scale, __m256i maxValue, bool absolute)
+{
+    __m256i diff = _mm256_sub_epi32(a, b);
+    if (absolute)
+        diff = _mm256_abs_epi32(diff);
+    const __m256i value = _mm256_add_epi32(offset, _mm256_mullo_epi32(diff, scale));
+    return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), maxValue);
+}
+
+YUVIEW_TARGET_AVX2 static void difference16_avx2(const unsigned short *srcA, const unsigned short *srcB, unsigned short *dst, int n, const YUVDifferenceParameters &params, int bps)
+{
+    const __m256i offset = _mm256_set1_epi32(params.offset);
+    const __m256i scale = _mm256_set1_epi32(params.scale);
+    const __m256i maxValue = _mm256_set1_epi32((1<<bps)-1);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i lo = difference32Lanes_avx2(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(srcA + i))), _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(srcB + i))), offset, scale, maxValue, params.absolute);
+        const __m256i hi = difference32Lanes_avx2(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(srcA + i + 8))), _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(srcB + i + 8))), offset, scale, maxValue, params.absolute);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8));
+    }
+    difference16_c(srcA + i, srcB + i, dst + i, n - i, params, bps);
+}
+
+#endif // YUVIEW_X86_SIMD
+
+/////////////////////////////////////////////////////////////////////////////
+// dispatch
+
+static const YUVDifferenceKernels g_kernelsScalar = { difference8_c, difference16_c, "scalar" };
+#if YUVIEW_X86_SIMD
+static const YUVDifferenceKernels g_kernelsSSE41 = { difference8_sse41, difference16_sse41, "SSE4.1" };
+static const YUVDifferenceKernels g_kernelsAVX2 = { difference8_avx2, difference16_avx2, "AVX2" };
+#endif
+
+static const YUVDifferenceKernels &selectKernels()
+{
+#if YUVIEW_X86_SIMD
+    if (cpuSupportsAVX2())
+        return g_kernelsAVX2;
+    if (cpuSupportsSSE41())
+        return g_kernelsSSE41;
+#endif
+    return g_kernelsScalar;
+}
+
+const YUVDifferenceKernels &yuvDifferenceKernels()
+{
+    static const YUVDifferenceKernels &kernels = selectKernels();
+    return kernels;
+}
+
+const YUVDifferenceKernels &yuvDifferenceKernelsScalar()
+{
+    return g_kernelsScalar;
+}
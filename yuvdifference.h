@@ -0,0 +1,50 @@
+/*  YUView - YUV player with advanced analytics toolset
+*   Copyright (C) 2015  Institut für Nachrichtentechnik
+*                       RWTH Aachen University, GERMANY
+*
+*   YUView is free software; you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation; either version 2 of the License, or
+*   (at your option) any later version.
+*
+*   YUView is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with YUView.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef YUVDIFFERENCE_H
+#define YUVDIFFERENCE_H
+
+// largest factor of the amplified difference (the 8 bit SIMD kernels calculate in 16 bit)
+#define YUV_DIFFERENCE_MAX_SCALE 64
+
+// An output sample is offset + scale*(a-b) or offset + scale*|a-b| (absolute), clipped to [0, (1<<bps)-1]
+struct YUVDifferenceParameters
+{
+    int offset;
+    int scale;      // [0, YUV_DIFFERENCE_MAX_SCALE]
+    bool absolute;
+};
+
+// Kernels computing the difference of n samples of two planes.
+// All implementations produce bit identical results. The scalar versions are the reference.
+struct YUVDifferenceKernels
+{
+    void (*difference8)(const unsigned char *srcA, const unsigned char *srcB, unsigned char *dst, int n, const YUVDifferenceParameters &params);
+    // samples with bps in ]8, 16]
+    void (*difference16)(const unsigned short *srcA, const unsigned short *srcB, unsigned short *dst, int n, const YUVDifferenceParameters &params, int bps);
+
+    const char *name;
+};
+
+// kernels for the best instruction set supported by this CPU (selected once at first call)
+const YUVDifferenceKernels &yuvDifferenceKernels();
+
+// scalar reference kernels
+const YUVDifferenceKernels &yuvDifferenceKernelsScalar();
+
+#endif // YUVDIFFERENCE_H
@@ -17,12 +17,14 @@
 */
 
 #include "yuvfile.h"
+#include "chromaupsampling.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QtEndian>
 #include "math.h"
 #include <cfloat>
 #include <assert.h>
+#include <limits>
 #if _WIN32
 #include <windows.h>
 #else
@@ -116,14 +118,28 @@ candMode_t candidateModes[] = {
 };
 
 std::map<YUVCPixelFormatType,PixelFormat> YUVFile::g_pixelFormatList = std::map<YUVCPixelFormatType,PixelFormat>();
+QCache<SourceFrameIdx, QByteArray> YUVFile::sourceFrameCache;
+QMutex YUVFile::sourceFrameCacheMutex;
 
 YUVFile::YUVFile(const QString &fname, QObject *parent) : QObject(parent)
 {
     p_srcFile = NULL;
+    p_mappedFile = NULL;
+    p_mappedSize = 0;
 
     // open file for reading
     p_srcFile = new QFile(fname);
-    p_srcFile->open(QIODevice::ReadOnly);
+    if( p_srcFile->open(QIODevice::ReadOnly) )
+    {
+        // try to map the whole file. If this fails (e.g. address space exhausted), fall back to seek/read.
+        qint64 fileSize = p_srcFile->size();
+        if( fileSize > 0 && (quint64)fileSize <= (quint64)std::numeric_limits<size_t>::max() )
+        {
+            p_mappedFile = p_srcFile->map(0, fileSize);
+            if( p_mappedFile != NULL )
+                p_mappedSize = fileSize;
+        }
+    }
 
     // get some more information from file
     QFileInfo fileInfo(p_srcFile->fileName());
@@ -140,6 +156,8 @@ YUVFile::YUVFile(const QString &fname, QObject *parent) : QObject(parent)
 
 YUVFile::~YUVFile()
 {
+    if( p_mappedFile != NULL )
+        p_srcFile->unmap(p_mappedFile);
     delete p_srcFile;
 }
 
@@ -220,19 +238,21 @@ int YUVFile::getNumberFrames(int width, int height)
 {
     qint64 fileSize = getFileSize();
 
-    if(width > 0 && height > 0)
-        return fileSize / bytesPerFrame(width, height, p_srcPixelFormat);
+    qint64 bpf = bytesPerFrame(width, height, p_srcPixelFormat);
+    if(width > 0 && height > 0 && bpf > 0)
+        return (int)(fileSize / bpf);
     else
         return -1;
 }
 
-int YUVFile::readFrame( QByteArray *targetBuffer, unsigned int frameIdx, int width, int height )
+qint64 YUVFile::readFrame( QByteArray *targetBuffer, unsigned int frameIdx, int width, int height )
 {
     if(p_srcFile == NULL)
         return 0;
 
-    int bpf = bytesPerFrame(width, height, p_srcPixelFormat);
-    int startPos = frameIdx * bpf;
+    // frame offsets easily exceed 4 GB for UHD sequences, so do all offset math in 64 bit
+    qint64 bpf = bytesPerFrame(width, height, p_srcPixelFormat);
+    qint64 startPos = (qint64)frameIdx * bpf;
 
     // check if our buffer is big enough
     if( targetBuffer->size() != bpf )
@@ -244,14 +264,34 @@ int YUVFile::readFrame( QByteArray *targetBuffer, unsigned int frameIdx, int wid
     return bpf;
 }
 
-void YUVFile::readBytes( char *targetBuffer, unsigned int startPos, unsigned int length )
+const char* YUVFile::mappedFrame( unsigned int frameIdx, int width, int height )
+{
+    if(p_mappedFile == NULL)
+        return NULL;
+
+    qint64 bpf = bytesPerFrame(width, height, p_srcPixelFormat);
+    qint64 startPos = (qint64)frameIdx * bpf;
+
+    // only hand out frames which are completely inside of the mapping
+    if( bpf <= 0 || startPos + bpf > p_mappedSize )
+        return NULL;
+
+    return (const char*)(p_mappedFile + startPos);
+}
+
+void YUVFile::readBytes( char *targetBuffer, qint64 startPos, qint64 length )
 {
     if(p_srcFile == NULL)
         return;
 
+    if( p_mappedFile != NULL && startPos + length <= p_mappedSize )
+    {
+        memcpy(targetBuffer, p_mappedFile + startPos, length);
+        return;
+    }
+
     p_srcFile->seek(startPos);
     p_srcFile->read(targetBuffer, length);
-    //targetBuffer->setRawData( (const char*)p_srcFile->map(startPos, length, QFile::NoOptions), length );
 }
 
 float computeMSE( unsigned char *ptr, unsigned char *ptr2, int numPixels )
@@ -342,11 +382,11 @@ void YUVFile::formatFromFilename(QString filePath, int* width, int* height, doub
         qint64 fileSize = fileInfo.size();
         if (*bitDepth==8)
         {
-        *numFrames = fileSize / YUVFile::bytesPerFrame(*width, *height, YUVC_420YpCbCr8PlanarPixelFormat); // assume 4:2:0, 8bit
+        *numFrames = (int)(fileSize / YUVFile::bytesPerFrame(*width, *height, YUVC_420YpCbCr8PlanarPixelFormat)); // assume 4:2:0, 8bit
         }
         else if (*bitDepth==10)
         {
-        *numFrames = fileSize / YUVFile::bytesPerFrame(*width, *height, YUVC_420YpCbCr10LEPlanarPixelFormat); // assume 4:2:0, 10bit
+        *numFrames = (int)(fileSize / YUVFile::bytesPerFrame(*width, *height, YUVC_420YpCbCr10LEPlanarPixelFormat)); // assume 4:2:0, 10bit
         }
         else
         {
@@ -439,7 +479,7 @@ void YUVFile::formatFromCorrelation(int* width, int* height, YUVCPixelFormatType
         *width  = candidateModes[bestMode].width;
         *height = candidateModes[bestMode].height;
         *cFormat = candidateModes[bestMode].pixelFormat;
-        *numFrames = fileSize / bytesPerFrame(*width, *height, *cFormat);
+        *numFrames = (int)(fileSize / bytesPerFrame(*width, *height, *cFormat));
     }
 
 }
@@ -465,8 +505,8 @@ qint64 YUVFile::getFileSize()
 QString YUVFile::getStatus(int width, int height)
 {
   qint64 nrBytes = getFileSize();
-  int nrBytesPerFrame = bytesPerFrame(width, height, p_srcPixelFormat);
-  if (nrBytes % nrBytesPerFrame != 0)
+  qint64 nrBytesPerFrame = bytesPerFrame(width, height, p_srcPixelFormat);
+  if (nrBytesPerFrame <= 0 || nrBytes % nrBytesPerFrame != 0)
   {
     // Division is with residual
     return QString("Error: File Size and resolution do not match.");
@@ -476,23 +516,364 @@ QString YUVFile::getStatus(int width, int height)
 
 void YUVFile::getOneFrame(QByteArray* targetByteArray, unsigned int frameIdx, int width, int height )
 {
+    // the source frame comes from the mapped file or the source frame cache if possible
+    QByteArray sourceFrame;
+    const char *srcFrame = getRawFrame(&sourceFrame, frameIdx, width, height);
+
     // check if we need to do chroma upsampling
     if(p_srcPixelFormat != YUVC_444YpCbCr8PlanarPixelFormat && p_srcPixelFormat != YUVC_444YpCbCr12NativePlanarPixelFormat && p_srcPixelFormat != YUVC_444YpCbCr16NativePlanarPixelFormat && p_srcPixelFormat != YUVC_24RGBPixelFormat )
     {
-        // read one frame into temporary buffer
-        readFrame( &p_tmpBufferYUV, frameIdx, width, height);
-        //use dummy data to check
         // convert original data format into YUV444 planar format
-        convert2YUV444(&p_tmpBufferYUV, width, height, targetByteArray);
+        convert2YUV444(srcFrame, width, height, targetByteArray);
+    }
+    else if( srcFrame == sourceFrame.constData() )
+    {
+        // source and target format are identical --> no conversion necessary (and no copy of a cached frame)
+        *targetByteArray = sourceFrame;
+    }
+    else
+    {
+        // copy the frame out of the mapping
+        const qint64 bpf = bytesPerFrame(width, height, p_srcPixelFormat);
+        if( targetByteArray->size() != bpf )
+            targetByteArray->resize(bpf);
+        memcpy(targetByteArray->data(), srcFrame, bpf);
+    }
+}
+
+const char* YUVFile::getRawFrame( QByteArray* buffer, unsigned int frameIdx, int width, int height )
+{
+    // mapped frames are served from the mapping (and the page cache of the OS)
+    const char *srcFrame = mappedFrame(frameIdx, width, height);
+    if( srcFrame != NULL )
+        return srcFrame;
+
+    SourceFrameIdx sIdx(p_srcFile->fileName(), frameIdx, p_srcPixelFormat, width, height);
+    {
+        QMutexLocker cacheLocker(&sourceFrameCacheMutex);
+        QByteArray *cachedFrame = sourceFrameCache.object(sIdx);
+        if( cachedFrame != NULL )
+        {
+            // implicitly shared, the caller gets its own copy only if it modifies the buffer
+            *buffer = *cachedFrame;
+            return buffer->constData();
+        }
+    }
+
+    // read into a new buffer, so that a buffer which is shared with the cache is not copied before it is overwritten
+    QByteArray frame;
+    {
+        QMutexLocker locker(&p_readMutex);
+        readFrame( &frame, frameIdx, width, height);
+    }
+    *buffer = frame;
+
+    if( !frame.isEmpty() )
+    {
+        QMutexLocker cacheLocker(&sourceFrameCacheMutex);
+        sourceFrameCache.insert(sIdx, new QByteArray(frame), (frame.size() + 1023) >> 10);
+    }
+
+    return buffer->constData();
+}
+
+void YUVFile::setSourceFrameCacheSizeInMB(unsigned int sizeInMB)
+{
+    QMutexLocker cacheLocker(&sourceFrameCacheMutex);
+    sourceFrameCache.setMaxCost(sizeInMB << 10);
+}
+
+bool YUVFile::getSampleValues( unsigned int frameIdx, int width, int height, int x, int y, int *valY, int *valU, int *valV )
+{
+    if( x < 0 || y < 0 || x >= width || y >= height )
+        return false;
+
+    // O(1) for mapped and cached frames, only the first query of a frame which is not mapped reads it
+    QByteArray sourceFrame;
+    const char *srcFrame = getRawFrame(&sourceFrame, frameIdx, width, height);
+    if( srcFrame == NULL || (srcFrame == sourceFrame.constData() && sourceFrame.isEmpty()) )
+        return false;
+
+    const int componentLength = width*height;
+    const int horiSubsampling = horizontalSubSampling(p_srcPixelFormat);
+    const int vertSubsampling = verticalSubSampling(p_srcPixelFormat);
+
+    if( isPlanar(p_srcPixelFormat) && bitsPerSample(p_srcPixelFormat) == 8 )
+    {
+        const unsigned char *src = (const unsigned char*)srcFrame;
+        *valY = src[y*width+x];
+        if( horiSubsampling == 0 || vertSubsampling == 0 )
+        {
+            // 4:0:0
+            *valU = *valV = 128;
+            return true;
+        }
+
+        // the chroma samples before upsampling
+        const bool reverseUV = (p_srcPixelFormat == YUVC_444YpCrCb8PlanarPixelFormat) || (p_srcPixelFormat == YUVC_422YpCrCb8PlanarPixelFormat);
+        const int chromaWidth = width / horiSubsampling;
+        const int chromaHeight = height / vertSubsampling;
+        const int chromaLength = chromaWidth * chromaHeight;
+        const int chromaPos = MIN(y/vertSubsampling, chromaHeight-1)*chromaWidth + MIN(x/horiSubsampling, chromaWidth-1);
+        *valU = src[componentLength + (reverseUV?chromaLength:0) + chromaPos];
+        *valV = src[componentLength + (reverseUV?0:chromaLength) + chromaPos];
+        return true;
+    }
+    else if( p_srcPixelFormat == YUVC_420YpCbCr10LEPlanarPixelFormat )
+    {
+        const quint16 *src = (const quint16*)srcFrame;
+        const int chromaWidth = width / 2;
+        const int chromaHeight = height / 2;
+        const int chromaLength = chromaWidth * chromaHeight;
+        const int chromaPos = MIN(y/2, chromaHeight-1)*chromaWidth + MIN(x/2, chromaWidth-1);
+        *valY = qFromLittleEndian(src[y*width+x]);
+        *valU = qFromLittleEndian(src[componentLength + chromaPos]);
+        *valV = qFromLittleEndian(src[componentLength + chromaLength + chromaPos]);
+        return true;
+    }
+    else if(   p_srcPixelFormat == YUVC_444YpCbCr12LEPlanarPixelFormat || p_srcPixelFormat == YUVC_444YpCbCr16LEPlanarPixelFormat
+            || p_srcPixelFormat == YUVC_444YpCbCr12BEPlanarPixelFormat || p_srcPixelFormat == YUVC_444YpCbCr16BEPlanarPixelFormat )
+    {
+        const quint16 *src = (const quint16*)srcFrame;
+        const bool littleEndian = (p_srcPixelFormat == YUVC_444YpCbCr12LEPlanarPixelFormat || p_srcPixelFormat == YUVC_444YpCbCr16LEPlanarPixelFormat);
+        const int pos = y*width+x;
+        *valY = littleEndian ? qFromLittleEndian(src[pos])                   : qFromBigEndian(src[pos]);
+        *valU = littleEndian ? qFromLittleEndian(src[componentLength+pos])   : qFromBigEndian(src[componentLength+pos]);
+        *valV = littleEndian ? qFromLittleEndian(src[2*componentLength+pos]) : qFromBigEndian(src[2*componentLength+pos]);
+        return true;
+    }
+    else if( p_srcPixelFormat == YUVC_UYVY422PixelFormat )
+    {
+        const unsigned char *src = (const unsigned char*)srcFrame;
+        *valY = src[((x+y*width)<<1)+1];
+        *valU = src[((((x>>1)<<1)+y*width)<<1)];
+        *valV = src[((((x>>1)<<1)+y*width)<<1)+2];
+        return true;
+    }
+    else if( p_srcPixelFormat == YUVC_24RGBPixelFormat )
+    {
+        // R, G and B
+        const unsigned char *src = (const unsigned char*)srcFrame + 3*(y*width+x);
+        *valY = src[0];
+        *valU = src[1];
+        *valV = src[2];
+        return true;
+    }
+    else if( p_srcPixelFormat == YUVC_422YpCbCr10PixelFormat || p_srcPixelFormat == YUVC_UYVY422YpCbCr10PixelFormat )
+    {
+        // Groups of 6 pixels are packed in 4 32 bit words (16 bytes), the layout is the same as in convert2YUV444.
+        // {word, shift} of the 10 bit samples: Y of the 6 pixels, U and V of the 3 pixel pairs
+        static const int v210Y[6][2] = { {0,10}, {1, 0}, {1,20}, {2,10}, {3, 0}, {3,20} };
+        static const int v210U[3][2] = { {0, 0}, {1,10}, {2,20} };
+        static const int v210V[3][2] = { {0,20}, {2, 0}, {3,10} };
+        static const int uyvyY[6][2] = { {0,12}, {1,22}, {1, 2}, {2,12}, {3,22}, {3, 2} };
+        static const int uyvyU[3][2] = { {0, 2}, {2,22}, {3,12} };
+        static const int uyvyV[3][2] = { {0,22}, {1,12}, {2, 2} };
+
+        const bool v210 = (p_srcPixelFormat == YUVC_422YpCbCr10PixelFormat);
+        const int (*posY)[2] = v210 ? v210Y : uyvyY;
+        const int (*posU)[2] = v210 ? v210U : uyvyU;
+        const int (*posV)[2] = v210 ? v210V : uyvyV;
+
+        const int pos = y*width+x;
+        const int pixel = pos % 6;
+        const quint32 *group = (const quint32*)srcFrame + (pos / 6)*4;
+        quint32 words[4];
+        for (int i = 0; i < 4; i++)
+            words[i] = v210 ? SwapInt32LittleToHost(group[i]) : SwapInt32BigToHost(group[i]);
+
+        *valY = (words[posY[pixel][0]]   >> posY[pixel][1])   & 0x3ff;
+        *valU = (words[posU[pixel/2][0]] >> posU[pixel/2][1]) & 0x3ff;
+        *valV = (words[posV[pixel/2][0]] >> posV[pixel/2][1]) & 0x3ff;
+        return true;
+    }
+
+    // other formats are converted with the rest of the frame
+    QByteArray yuv444Frame;
+    getOneFrame(&yuv444Frame, frameIdx, width, height);
+    if( yuv444Frame.size() < 3*componentLength*2 )
+        return false;
+    const quint16 *src = (const quint16*)yuv444Frame.constData();
+    *valY = src[y*width+x];
+    *valU = src[componentLength+y*width+x];
+    *valV = src[2*componentLength+y*width+x];
+    return true;
+}
+
+bool YUVFile::getPlanes( QByteArray* buffer, unsigned int frameIdx, int width, int height, YUVPlanes *planes )
+{
+    const int bps = bitsPerSample(p_srcPixelFormat);
+    const int horiSubsampling = horizontalSubSampling(p_srcPixelFormat);
+    const int vertSubsampling = verticalSubSampling(p_srcPixelFormat);
+
+    bool usePlanes = isPlanar(p_srcPixelFormat) && bps == 8;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    usePlanes = usePlanes || p_srcPixelFormat == YUVC_420YpCbCr10LEPlanarPixelFormat || p_srcPixelFormat == YUVC_444YpCbCr12LEPlanarPixelFormat || p_srcPixelFormat == YUVC_444YpCbCr16LEPlanarPixelFormat;
+#endif
+
+    if( usePlanes )
+    {
+        const char *srcFrame = getRawFrame(buffer, frameIdx, width, height);
+        if( srcFrame == NULL || (srcFrame == buffer->constData() && buffer->isEmpty()) )
+            return false;
+
+        planes->bytesPerSample = (bps > 8) ? 2 : 1;
+        planes->data[0] = srcFrame;
+        planes->width[0] = width;
+        planes->height[0] = height;
+        if( horiSubsampling == 0 || vertSubsampling == 0 )
+        {
+            // 4:0:0
+            planes->data[1] = planes->data[2] = NULL;
+            planes->width[1] = planes->width[2] = planes->height[1] = planes->height[2] = 0;
+            return true;
+        }
+
+        const bool reverseUV = (p_srcPixelFormat == YUVC_444YpCrCb8PlanarPixelFormat) || (p_srcPixelFormat == YUVC_422YpCrCb8PlanarPixelFormat);
+        const int chromaWidth = width / horiSubsampling;
+        const int chromaHeight = height / vertSubsampling;
+        const char *firstChroma = srcFrame + width*height*planes->bytesPerSample;
+        const char *secondChroma = firstChroma + chromaWidth*chromaHeight*planes->bytesPerSample;
+        planes->data[1] = reverseUV ? secondChroma : firstChroma;
+        planes->data[2] = reverseUV ? firstChroma : secondChroma;
+        planes->width[1] = planes->width[2] = chromaWidth;
+        planes->height[1] = planes->height[2] = chromaHeight;
+        return true;
     }
-    else    // source and target format are identical --> no conversion necessary
+
+    getOneFrame(buffer, frameIdx, width, height);
+    planes->bytesPerSample = (bps > 8) ? 2 : 1;
+    const int componentLength = width*height*planes->bytesPerSample;
+    if( buffer->size() < 3*componentLength )
+        return false;
+
+    for( int c = 0; c < 3; c++ )
     {
-        // read one frame into cached frame (already in YUV444 format)
-        readFrame( targetByteArray, frameIdx, width, height);
+        planes->data[c] = buffer->constData() + c*componentLength;
+        planes->width[c] = width;
+        planes->height[c] = height;
     }
+    return true;
+}
+
+// bilinear and interstitial interpolation use the chroma rows above and below, nearest neighbour only one
+static bool interpolatesChromaRows(YUVCPixelFormatType pixelFormat, InterpolationMode interpolationMode)
+{
+    return pixelFormat == YUVC_420YpCbCr8PlanarPixelFormat && interpolationMode != NearestNeighborInterpolation;
 }
 
-void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, QByteArray *targetBuffer)
+bool YUVFile::canUpsampleChromaBands(int width, int height)
+{
+    if( width < 2 || height < 2 || (width & 1) || (height & 1) )
+        return false;
+
+    if( p_srcPixelFormat == YUVC_420YpCbCr8PlanarPixelFormat )
+        return true;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if( p_srcPixelFormat == YUVC_420YpCbCr10LEPlanarPixelFormat )
+        return true;
+#endif
+    return false;
+}
+
+int YUVFile::chromaBandCount(int height)
+{
+    // interpolated: the first and last luma row and one band between each two chroma rows
+    // nearest neighbour: one band per chroma row
+    return interpolatesChromaRows(p_srcPixelFormat, p_interpolationMode) ? height/2+1 : height/2;
+}
+
+void YUVFile::chromaBandRows(int band, int height, int *firstRow, int *numRows)
+{
+    if( interpolatesChromaRows(p_srcPixelFormat, p_interpolationMode) )
+    {
+        *firstRow = MAX(0, 2*band-1);
+        *numRows = (band == 0 || band == height/2) ? 1 : 2;
+    }
+    else
+    {
+        *firstRow = 2*band;
+        *numRows = 2;
+    }
+}
+
+// horizontal interpolation of the first and last chroma row (same as in convert2YUV444)
+static void interpolateChromaRow8(const unsigned char *src, unsigned char *dst, int chromaWidth, int componentWidth, InterpolationMode interpolationMode)
+{
+    dst[0] = src[0];
+    if (interpolationMode == InterstitialInterpolation) {
+        for (int i = 0; i < chromaWidth-1; i++) {
+            dst[2*i+1] = ((3*(int)(src[i]) +   (int)(src[i+1]) + 2)>>2);
+            dst[2*i+2] = ((  (int)(src[i]) + 3*(int)(src[i+1]) + 2)>>2);
+        }
+        dst[componentWidth-1] = src[chromaWidth-1];
+    } else {
+        for (int i = 0; i < chromaWidth-1; i++) {
+            dst[i*2+1] = (( (int)(src[i]) + (int)(src[i+1]) + 1 ) >> 1);
+            dst[i*2+2] = src[i+1];
+        }
+        dst[componentWidth-1] = dst[componentWidth-2];
+    }
+}
+
+void YUVFile::upsampleChromaBand(const char *sourceBuffer, int lumaWidth, int lumaHeight, int band, char *dstU, char *dstV)
+{
+    const int componentWidth = lumaWidth;
+    const int componentLength = lumaWidth*lumaHeight;
+    const int chromaWidth = lumaWidth / 2;
+    const int chromaHeight = lumaHeight / 2;
+    const int chromaLength = chromaWidth * chromaHeight;
+    const ChromaUpsamplingKernels *kernels = &chromaUpsamplingKernels();
+
+    if (p_srcPixelFormat == YUVC_420YpCbCr10LEPlanarPixelFormat) {
+        const unsigned short *srcU = (const unsigned short*)sourceBuffer + componentLength;
+        const unsigned short *srcV = srcU + chromaLength;
+        unsigned short *dstUV[2] = {(unsigned short*)dstU, (unsigned short*)dstV};
+        const unsigned short *srcUV[2] = {srcU + band*chromaWidth, srcV + band*chromaWidth};
+
+        for (int c = 0; c < 2; c++) {
+            kernels->holdRow16(srcUV[c], dstUV[c], chromaWidth);
+            memcpy(dstUV[c] + componentWidth, dstUV[c], componentWidth*sizeof(unsigned short));
+        }
+        return;
+    }
+
+    const unsigned char *srcU = (const unsigned char*)sourceBuffer + componentLength;
+    const unsigned char *srcV = srcU + chromaLength;
+    const unsigned char *srcUV[2] = {srcU, srcV};
+    unsigned char *dstUV[2] = {(unsigned char*)dstU, (unsigned char*)dstV};
+
+    for (int c = 0; c < 2; c++) {
+        if (!interpolatesChromaRows(p_srcPixelFormat, p_interpolationMode)) {
+            // sample and hold
+            kernels->holdRow8(&srcUV[c][band*chromaWidth], dstUV[c], chromaWidth);
+            memcpy(dstUV[c] + componentWidth, dstUV[c], componentWidth);
+        } else if (band == 0) {
+            interpolateChromaRow8(srcUV[c], dstUV[c], chromaWidth, componentWidth, p_interpolationMode);
+        } else if (band == chromaHeight) {
+            interpolateChromaRow8(&srcUV[c][(chromaHeight-1)*chromaWidth], dstUV[c], chromaWidth, componentWidth, p_interpolationMode);
+        } else {
+            // two rows between the chroma rows band-1 and band
+            const unsigned char *top = &srcUV[c][(band-1)*chromaWidth];
+            const unsigned char *bot = &srcUV[c][band*chromaWidth];
+            unsigned char *dstTop = dstUV[c];
+            unsigned char *dstBot = dstUV[c] + componentWidth;
+            dstTop[0] = (( 3*(int)(top[0]) +   (int)(bot[0]) + 2 ) >> 2);
+            dstBot[0] = ((   (int)(top[0]) + 3*(int)(bot[0]) + 2 ) >> 2);
+            if (p_interpolationMode == InterstitialInterpolation) {
+                kernels->interstitialRows8(top, bot, dstTop+1, dstBot+1, chromaWidth-1);
+                dstTop[componentWidth-1] = (( 3*(int)(top[chromaWidth-1]) +   (int)(bot[chromaWidth-1]) + 2 ) >> 2);
+                dstBot[componentWidth-1] = ((   (int)(top[chromaWidth-1]) + 3*(int)(bot[chromaWidth-1]) + 2 ) >> 2);
+            } else {
+                kernels->bilinearRows8(top, bot, dstTop+1, dstBot+1, chromaWidth-1);
+                dstTop[componentWidth-1] = dstTop[componentWidth-2];
+                dstBot[componentWidth-1] = dstBot[componentWidth-2];
+            }
+        }
+    }
+}
+
+void YUVFile::convert2YUV444(const char *sourceBuffer, int lumaWidth, int lumaHeight, QByteArray *targetBuffer)
 {
     const int componentWidth = lumaWidth;
     const int componentHeight = lumaHeight;
@@ -503,6 +884,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
     const int chromaWidth = horiSubsampling==0 ? 0 : lumaWidth / horiSubsampling;
     const int chromaHeight = vertSubsampling == 0 ? 0 : lumaHeight / vertSubsampling;
     const int chromaLength = chromaWidth * chromaHeight; // number of bytes per chroma frame
+    const ChromaUpsamplingKernels *kernels = &chromaUpsamplingKernels();
 
     // make sure target buffer is big enough (YUV444 means 3 byte per sample)
     int targetBufferLength = 3*componentWidth*componentHeight*bytePerComponent(p_srcPixelFormat);
@@ -511,13 +893,13 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
 
     // TODO: keep unsigned char for 10bit? use short?
     if (chromaLength == 0) {
-        const unsigned char *srcY = (unsigned char*)sourceBuffer->data();
+        const unsigned char *srcY = (const unsigned char*)sourceBuffer;
         unsigned char *dstY = (unsigned char*)targetBuffer->data();
         unsigned char *dstU = dstY + componentLength;
         memcpy(dstY, srcY, componentLength);
         memset(dstU, 128, 2*componentLength);
     } else if (p_srcPixelFormat == YUVC_UYVY422PixelFormat) {
-        const unsigned char *srcY = (unsigned char*)sourceBuffer->data();
+        const unsigned char *srcY = (const unsigned char*)sourceBuffer;
         unsigned char *dstY = (unsigned char*)targetBuffer->data();
         unsigned char *dstU = dstY + componentLength;
         unsigned char *dstV = dstU + componentLength;
@@ -532,7 +914,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
             }
         }
     } else if (p_srcPixelFormat == YUVC_UYVY422YpCbCr10PixelFormat) {
-        const quint32 *srcY = (quint32*)sourceBuffer->data();
+        const quint32 *srcY = (const quint32*)sourceBuffer;
         quint16 *dstY = (quint16*)targetBuffer->data();
         quint16 *dstU = dstY + componentLength;
         quint16 *dstV = dstU + componentLength;
@@ -562,7 +944,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
             dstY[dstPos+5] =                  (srcVal&0x00000ffc)<<(BIT_INCREASE-2);
         }
     } else if (p_srcPixelFormat == YUVC_422YpCbCr10PixelFormat) {
-        const quint32 *srcY = (quint32*)sourceBuffer->data();
+        const quint32 *srcY = (const quint32*)sourceBuffer;
         quint16 *dstY = (quint16*)targetBuffer->data();
         quint16 *dstU = dstY + componentLength;
         quint16 *dstV = dstU + componentLength;
@@ -593,7 +975,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
         }
     } else if (p_srcPixelFormat == YUVC_420YpCbCr8PlanarPixelFormat && p_interpolationMode == BiLinearInterpolation) {
         // vertically midway positioning - unsigned rounding
-        const unsigned char *srcY = (unsigned char*)sourceBuffer->data();
+        const unsigned char *srcY = (const unsigned char*)sourceBuffer;
         const unsigned char *srcU = srcY + componentLength;
         const unsigned char *srcV = srcU + chromaLength;
         const unsigned char *srcUV[2] = {srcU, srcV};
@@ -621,7 +1003,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
             dstUV[c][componentWidth-1] = dstUV[c][componentWidth-2];
 
             int j;
-#pragma omp parallel for default(none) shared(dstUV,srcUV) firstprivate(c)
+#pragma omp parallel for default(none) shared(dstUV,srcUV,kernels) firstprivate(c)
             for (j = 0; j < chromaHeight-1; j++) {
                 const int dstTop = (j*2+1)*componentWidth;
                 const int dstBot = (j*2+2)*componentWidth;
@@ -629,16 +1011,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
                 const int srcBot = (j+1)*chromaWidth;
                 dstUV[c][dstTop] = (( 3*(int)(srcUV[c][srcTop]) +   (int)(srcUV[c][srcBot]) + 2 ) >> 2);
                 dstUV[c][dstBot] = ((   (int)(srcUV[c][srcTop]) + 3*(int)(srcUV[c][srcBot]) + 2 ) >> 2);
-                for (int i = 0; i < chromaWidth-1; i++) {
-                    const int tl = srcUV[c][srcTop+i];
-                    const int tr = srcUV[c][srcTop+i+1];
-                    const int bl = srcUV[c][srcBot+i];
-                    const int br = srcUV[c][srcBot+i+1];
-                    dstUV[c][dstTop+i*2+1] = (( 6*tl + 6*tr + 2*bl + 2*br + 8 ) >> 4);
-                    dstUV[c][dstBot+i*2+1] = (( 2*tl + 2*tr + 6*bl + 6*br + 8 ) >> 4);
-                    dstUV[c][dstTop+i*2+2] = ((        3*tr +          br + 2 ) >> 2);
-                    dstUV[c][dstBot+i*2+2] = ((          tr +        3*br + 2 ) >> 2);
-                }
+                kernels->bilinearRows8(&srcUV[c][srcTop], &srcUV[c][srcBot], &dstUV[c][dstTop+1], &dstUV[c][dstBot+1], chromaWidth-1);
                 dstUV[c][dstTop+componentWidth-1] = dstUV[c][dstTop+componentWidth-2];
                 dstUV[c][dstBot+componentWidth-1] = dstUV[c][dstBot+componentWidth-2];
             }
@@ -653,7 +1026,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
         }
     } else if (p_srcPixelFormat == YUVC_420YpCbCr8PlanarPixelFormat && p_interpolationMode == InterstitialInterpolation) {
         // interstitial positioning - unsigned rounding, takes 2 times as long as nearest neighbour
-        const unsigned char *srcY = (unsigned char*)sourceBuffer->data();
+        const unsigned char *srcY = (const unsigned char*)sourceBuffer;
         const unsigned char *srcU = srcY + componentLength;
         const unsigned char *srcV = srcU + chromaLength;
         const unsigned char *srcUV[2] = {srcU, srcV};
@@ -681,7 +1054,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
             dstUV[c][componentWidth-1] = srcUV[c][chromaWidth-1];
 
             int j;
-#pragma omp parallel for default(none) shared(dstUV,srcUV) firstprivate(c)
+#pragma omp parallel for default(none) shared(dstUV,srcUV,kernels) firstprivate(c)
             for (j = 0; j < chromaHeight-1; j++) {
                 const int dstTop = (j*2+1)*componentWidth;
                 const int dstBot = (j*2+2)*componentWidth;
@@ -689,16 +1062,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
                 const int srcBot = (j+1)*chromaWidth;
                 dstUV[c][dstTop] = (( 3*(int)(srcUV[c][srcTop]) +   (int)(srcUV[c][srcBot]) + 2 ) >> 2);
                 dstUV[c][dstBot] = ((   (int)(srcUV[c][srcTop]) + 3*(int)(srcUV[c][srcBot]) + 2 ) >> 2);
-                for (int i = 0; i < chromaWidth-1; i++) {
-                    const int tl = srcUV[c][srcTop+i];
-                    const int tr = srcUV[c][srcTop+i+1];
-                    const int bl = srcUV[c][srcBot+i];
-                    const int br = srcUV[c][srcBot+i+1];
-                    dstUV[c][dstTop+i*2+1] = (9*tl + 3*tr + 3*bl +   br + 8) >> 4;
-                    dstUV[c][dstBot+i*2+1] = (3*tl +   tr + 9*bl + 3*br + 8) >> 4;
-                    dstUV[c][dstTop+i*2+2] = (3*tl + 9*tr +   bl + 3*br + 8) >> 4;
-                    dstUV[c][dstBot+i*2+2] = (  tl + 3*tr + 3*bl + 9*br + 8) >> 4;
-                }
+                kernels->interstitialRows8(&srcUV[c][srcTop], &srcUV[c][srcBot], &dstUV[c][dstTop+1], &dstUV[c][dstBot+1], chromaWidth-1);
                 dstUV[c][dstTop+componentWidth-1] = (( 3*(int)(srcUV[c][srcTop+chromaWidth-1]) +   (int)(srcUV[c][srcBot+chromaWidth-1]) + 2 ) >> 2);
                 dstUV[c][dstBot+componentWidth-1] = ((   (int)(srcUV[c][srcTop+chromaWidth-1]) + 3*(int)(srcUV[c][srcBot+chromaWidth-1]) + 2 ) >> 2);
             }
@@ -713,7 +1077,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
         }
     } /*else if (pixelFormatType == YUVC_420YpCbCr8PlanarPixelFormat && self.chromaInterpolation == 3) {
            // interstitial positioning - correct signed rounding - takes 6/5 times as long as unsigned rounding
-           const unsigned char *srcY = (unsigned char*)sourceBuffer->data();
+           const unsigned char *srcY = (const unsigned char*)sourceBuffer;
            const unsigned char *srcU = srcY + componentLength;
            const unsigned char *srcV = srcU + chromaLength;
            unsigned char *dstY = (unsigned char*)targetBuffer->data();
@@ -777,7 +1141,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
          }*/ else if (isPlanar(p_srcPixelFormat) && bitsPerSample(p_srcPixelFormat) == 8) {
         // sample and hold interpolation
         const bool reverseUV = (p_srcPixelFormat == YUVC_444YpCrCb8PlanarPixelFormat) || (p_srcPixelFormat == YUVC_422YpCrCb8PlanarPixelFormat);
-        const unsigned char *srcY = (unsigned char*)sourceBuffer->data();
+        const unsigned char *srcY = (const unsigned char*)sourceBuffer;
         const unsigned char *srcU = srcY + componentLength + (reverseUV?chromaLength:0);
         const unsigned char *srcV = srcY + componentLength + (reverseUV?0:chromaLength);
         unsigned char *dstY = (unsigned char*)targetBuffer->data();
@@ -794,12 +1158,10 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
 
         if (2 == horiSubsampling && 2 == vertSubsampling) {
             int y;
-#pragma omp parallel for default(none) shared(dstV,dstU,srcV,srcU)
+#pragma omp parallel for default(none) shared(dstV,dstU,srcV,srcU,kernels)
             for (y = 0; y < chromaHeight; y++) {
-                for (int x = 0; x < chromaWidth; x++) {
-                    dstU[2*x + 2*y*componentWidth] = dstU[2*x+1 + 2*y*componentWidth] = srcU[x + y*chromaWidth];
-                    dstV[2*x + 2*y*componentWidth] = dstV[2*x+1 + 2*y*componentWidth] = srcV[x + y*chromaWidth];
-                }
+                kernels->holdRow8(&srcU[y*chromaWidth], &dstU[2*y*componentWidth], chromaWidth);
+                kernels->holdRow8(&srcV[y*chromaWidth], &dstV[2*y*componentWidth], chromaWidth);
                 memcpy(&dstU[(2*y+1)*componentWidth], &dstU[(2*y)*componentWidth], componentWidth);
                 memcpy(&dstV[(2*y+1)*componentWidth], &dstV[(2*y)*componentWidth], componentWidth);
             }
@@ -826,7 +1188,7 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
         }
     } else if (p_srcPixelFormat == YUVC_420YpCbCr10LEPlanarPixelFormat) {
         // TODO: chroma interpolation for 4:2:0 10bit planar
-        const unsigned short *srcY = (unsigned short*)sourceBuffer->data();
+        const unsigned short *srcY = (const unsigned short*)sourceBuffer;
         const unsigned short *srcU = srcY + componentLength;
         const unsigned short *srcV = srcU + chromaLength;
         unsigned short *dstY = (unsigned short*)targetBuffer->data();
@@ -834,24 +1196,34 @@ void YUVFile::convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHe
         unsigned short *dstV = dstU + componentLength;
 
         int y;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        // samples are already in host order, so luma is a copy and chroma can use the sample and hold kernel
+#pragma omp parallel for default(none) shared(dstY,dstV,dstU,srcY,srcV,srcU,kernels)
+        for (y = 0; y < componentHeight; y++) {
+            memcpy(&dstY[y*componentWidth], &srcY[y*componentWidth], componentWidth*sizeof(unsigned short));
+            kernels->holdRow16(&srcU[(y/2)*chromaWidth], &dstU[y*componentWidth], chromaWidth);
+            kernels->holdRow16(&srcV[(y/2)*chromaWidth], &dstV[y*componentWidth], chromaWidth);
+            if (componentWidth & 1) {
+                dstU[componentWidth-1 + y*componentWidth] = srcU[(componentWidth-1)/2 + (y/2)*chromaWidth];
+                dstV[componentWidth-1 + y*componentWidth] = srcV[(componentWidth-1)/2 + (y/2)*chromaWidth];
+            }
+        }
+#else
 #pragma omp parallel for default(none) shared(dstY,dstV,dstU,srcY,srcV,srcU)
         for (y = 0; y < componentHeight; y++) {
             for (int x = 0; x < componentWidth; x++) {
                 //dstY[x + y*componentWidth] = MIN(1023, CFSwapInt16LittleToHost(srcY[x + y*componentWidth])) << 6; // clip value for data which exceeds the 2^10-1 range
-           //     dstY[x + y*componentWidth] = SwapInt16LittleToHost(srcY[x + y*componentWidth])<<6;
-            //    dstU[x + y*componentWidth] = SwapInt16LittleToHost(srcU[x/2 + (y/2)*chromaWidth])<<6;
-            //    dstV[x + y*componentWidth] = SwapInt16LittleToHost(srcV[x/2 + (y/2)*chromaWidth])<<6;
-                dstY[x + y*componentWidth] = qFromLittleEndian(srcY[x + y*componentWidth]);
                 dstY[x + y*componentWidth] = qFromLittleEndian(srcY[x + y*componentWidth]);
                 dstU[x + y*componentWidth] = qFromLittleEndian(srcU[x/2 + (y/2)*chromaWidth]);
                 dstV[x + y*componentWidth] = qFromLittleEndian(srcV[x/2 + (y/2)*chromaWidth]);
             }
         }
+#endif
     }
     else if (   p_srcPixelFormat == YUVC_444YpCbCr12SwappedPlanarPixelFormat
                   || p_srcPixelFormat == YUVC_444YpCbCr16SwappedPlanarPixelFormat)
     {
-        swab((char*)sourceBuffer->data(), (char*)targetBuffer->data(), bytesPerFrame(componentWidth,componentHeight,p_srcPixelFormat));
+        swab((char*)sourceBuffer, (char*)targetBuffer->data(), bytesPerFrame(componentWidth,componentHeight,p_srcPixelFormat));
     } else {
         printf("Unhandled pixel format: %d\n", p_srcPixelFormat);
     }
@@ -864,14 +1236,14 @@ int YUVFile::verticalSubSampling(YUVCPixelFormatType pixelFormat)  { return pixe
 int YUVFile::horizontalSubSampling(YUVCPixelFormatType pixelFormat) { return pixelFormatList().count(pixelFormat)?pixelFormatList()[pixelFormat].subsamplingHorizontal():0; }
 int YUVFile::bitsPerSample(YUVCPixelFormatType pixelFormat)  { return pixelFormatList().count(pixelFormat)?pixelFormatList()[pixelFormat].bitsPerSample():0; }
 int YUVFile::bytePerComponent(YUVCPixelFormatType pixelFormat) {return pixelFormatList().count(pixelFormat)?pixelFormatList()[pixelFormat].bytePerComponent():0;}
-int YUVFile::bytesPerFrame(int width, int height, YUVCPixelFormatType cFormat)
+qint64 YUVFile::bytesPerFrame(int width, int height, YUVCPixelFormatType cFormat)
 {
-    if(pixelFormatList().count(cFormat) == 0)
+    if(pixelFormatList().count(cFormat) == 0 || pixelFormatList()[cFormat].bitsPerPixelDenominator() == 0)
         return 0;
 
-    unsigned numSamples = width*height;
-    unsigned remainder = numSamples % pixelFormatList()[cFormat].bitsPerPixelDenominator();
-    unsigned bits = numSamples / pixelFormatList()[cFormat].bitsPerPixelDenominator();
+    qint64 numSamples = (qint64)width*height;
+    qint64 remainder = numSamples % pixelFormatList()[cFormat].bitsPerPixelDenominator();
+    qint64 bits = numSamples / pixelFormatList()[cFormat].bitsPerPixelDenominator();
     if (remainder == 0) {
         bits *= pixelFormatList()[cFormat].bitsPerPixelNominator();
     } else {
@@ -26,6 +26,7 @@
 #include <QString>
 #include <QDateTime>
 #include <QCache>
+#include <QMutex>
 #include "typedef.h"
 #include <map>
 
@@ -82,6 +83,37 @@ private:
 
 typedef std::map<YUVCPixelFormatType,PixelFormat> PixelFormatMapType;
 
+class SourceFrameIdx
+{
+public:
+    SourceFrameIdx(const QString &name, unsigned int idx, YUVCPixelFormatType format, int frameWidth, int frameHeight) { filePath=name; frameIdx=idx; pixelFormat=format; width=frameWidth; height=frameHeight; }
+
+    QString filePath;
+    unsigned int frameIdx;
+    YUVCPixelFormatType pixelFormat;
+    int width;
+    int height;
+};
+
+inline bool operator==(const SourceFrameIdx &e1, const SourceFrameIdx &e2)
+{
+    return e1.filePath == e2.filePath && e1.frameIdx == e2.frameIdx && e1.pixelFormat == e2.pixelFormat && e1.width == e2.width && e1.height == e2.height;
+}
+
+inline uint qHash(const SourceFrameIdx &sIdx)
+{
+    return qHash(sIdx.filePath) ^ qHash(sIdx.frameIdx) ^ qHash((int)sIdx.pixelFormat) ^ qHash((sIdx.width << 16) ^ sIdx.height);
+}
+
+// the Y, U and V planes of a frame (see YUVFile::getPlanes). Samples with more than 8 bit are quint16 in host order.
+struct YUVPlanes
+{
+    const char *data[3];
+    int width[3];
+    int height[3];
+    int bytesPerSample;
+};
+
 class YUVFile : public QObject
 {
     Q_OBJECT
@@ -97,6 +129,32 @@ public:
     // reads one frame in YUV444 into target byte array
     virtual void getOneFrame( QByteArray* targetByteArray, unsigned int frameIdx, int width, int height );
 
+    // returns the frame in the source format: a pointer into the mapped file or, if the frame is not mapped, into buffer.
+    // Frames which are not mapped are kept in the source frame cache, so a frame is only read from disk once.
+    const char* getRawFrame( QByteArray* buffer, unsigned int frameIdx, int width, int height );
+
+    // Sample values of a pixel in the source frame. The chroma values are the samples before upsampling and
+    // samples with more than 8 bit are returned with their full precision. Returns false if the values are not available.
+    bool getSampleValues( unsigned int frameIdx, int width, int height, int x, int y, int *valY, int *valU, int *valV );
+
+    // The planes of a frame without chroma upsampling for planar formats that can be used directly (8 bit and little
+    // endian formats with more than 8 bit). Other formats are converted to YUV444. The planes point into the mapped
+    // file or into buffer. 4:0:0 frames have no chroma planes (NULL). Returns false if the frame could not be read.
+    bool getPlanes( QByteArray* buffer, unsigned int frameIdx, int width, int height, YUVPlanes *planes );
+
+    // Second cache tier below the frame cache of the FrameObject: frames in their source format (before
+    // upsampling and conversion to RGB) of files that can not be mapped. The cost is the frame size in KiB.
+    static void setSourceFrameCacheSizeInMB(unsigned int sizeInMB);
+
+    // Row based chroma upsampling of 4:2:0 planar frames (8 bit and 10 bit little endian) with even dimensions.
+    // A frame is upsampled in bands of one or two luma rows which depend on the same chroma rows, so it can be
+    // converted to RGB without a 4:4:4 frame buffer. The luma rows are used directly from the source frame.
+    bool canUpsampleChromaBands(int width, int height);
+    int chromaBandCount(int height);
+    void chromaBandRows(int band, int height, int *firstRow, int *numRows);
+    // writes the upsampled chroma rows of the band to dstU and dstV (numRows rows of width samples each)
+    void upsampleChromaBand(const char *sourceBuffer, int lumaWidth, int lumaHeight, int band, char *dstU, char *dstV);
+
     virtual QString fileName();
 
     //  methods for querying file information
@@ -109,6 +167,9 @@ public:
     void setSrcPixelFormat(YUVCPixelFormatType newFormat) { p_srcPixelFormat = newFormat; emit yuvInformationChanged(); }
     void setInterpolationMode(InterpolationMode newMode) { p_interpolationMode = newMode; emit yuvInformationChanged(); }
 
+    // true if the source file could be memory mapped. Frames are then converted directly from the mapped pages.
+    bool isMapped() { return p_mappedFile != NULL; }
+
     YUVCPixelFormatType pixelFormat() { return p_srcPixelFormat; }
     InterpolationMode interpolationMode() { return p_interpolationMode; }
 
@@ -116,7 +177,7 @@ public:
     static int verticalSubSampling(YUVCPixelFormatType pixelFormat);
     static int horizontalSubSampling(YUVCPixelFormatType pixelFormat);
     static int bitsPerSample(YUVCPixelFormatType pixelFormat);
-    static int bytesPerFrame(int width, int height, YUVCPixelFormatType cFormat);
+    static qint64 bytesPerFrame(int width, int height, YUVCPixelFormatType cFormat);
     static bool isPlanar(YUVCPixelFormatType pixelFormat);
     static int  bytePerComponent(YUVCPixelFormatType pixelFormat);
 
@@ -126,11 +187,16 @@ private:
 
     QFile *p_srcFile;
 
+    // memory mapping of the complete source file (NULL if mapping is not possible, e.g. on 32 bit systems)
+    uchar *p_mappedFile;
+    qint64 p_mappedSize;
+
     QString p_path;
     QString p_createdtime;
     QString p_modifiedtime;
 
-    QByteArray p_tmpBufferYUV;
+    // serializes access to p_srcFile if frames are read from several threads
+    QMutex p_readMutex;
 
     // YUV to RGB conversion
     YUVCPixelFormatType p_srcPixelFormat;
@@ -138,16 +204,22 @@ private:
 
     virtual qint64 getFileSize();
 
-    void convert2YUV444(QByteArray *sourceBuffer, int lumaWidth, int lumaHeight, QByteArray *targetBuffer);
+    void convert2YUV444(const char *sourceBuffer, int lumaWidth, int lumaHeight, QByteArray *targetBuffer);
 
     static PixelFormatMapType g_pixelFormatList;
 
-    int readFrame( QByteArray *targetBuffer, unsigned int frameIdx, int width, int height );
+    static QCache<SourceFrameIdx, QByteArray> sourceFrameCache;
+    static QMutex sourceFrameCacheMutex;    // the cache is used by the prefetch threads as well
+
+    qint64 readFrame( QByteArray *targetBuffer, unsigned int frameIdx, int width, int height );
+
+    // returns a pointer to the frame inside of the mapped file or NULL if the frame is not mapped
+    const char* mappedFrame( unsigned int frameIdx, int width, int height );
 
     // method tries to guess format information, returns 'true' on success
     void formatFromCorrelation(int* width, int* height, YUVCPixelFormatType* cFormat, int* numFrames);
 
-    void readBytes( char* targetBuffer, unsigned int startPos, unsigned int length );
+    void readBytes( char* targetBuffer, qint64 startPos, qint64 length );
 
 signals:
     void yuvInformationChanged();